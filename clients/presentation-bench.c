@@ -0,0 +1,720 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <time.h>
+
+#include <wayland-client.h>
+#include "../shared/os-compatibility.h"
+#include "presentation_timing-client-protocol.h"
+
+/* Commit-to-present latency benchmark.
+ *
+ * Drives a configurable workload of top-level surfaces with sub-surfaces,
+ * requests presentation feedback for every commit, and prints percentile
+ * statistics of the commit to presentation latency and of the jitter of
+ * the frame interval, along with missed and discarded frames, as one
+ * JSON object.
+ *
+ * For reproducible numbers run it against the headless backend with
+ * --frame-mode=virtual and pass --virtual-clock. The presentation clock
+ * then has nothing to do with the client's, so latency is measured from
+ * the last presentation the client had seen when it committed.
+ */
+
+#define NSEC_PER_SEC 1000000000
+#define NUM_BUFFERS 4
+
+enum damage_pattern {
+	DAMAGE_FULL,
+	DAMAGE_BAND,
+	DAMAGE_SPARSE,
+};
+
+static const char * const damage_name[] = {
+	[DAMAGE_FULL] = "full",
+	[DAMAGE_BAND] = "band",
+	[DAMAGE_SPARSE] = "sparse",
+};
+
+struct options {
+	int width, height;
+	int surfaces;
+	int subsurfaces;
+	bool desync;
+	enum damage_pattern damage;
+	int frames;
+	bool virtual_clock;
+};
+
+struct display {
+	struct wl_display *display;
+	struct wl_registry *registry;
+	struct wl_compositor *compositor;
+	struct wl_subcompositor *subcompositor;
+	struct wl_shell *shell;
+	struct wl_shm *shm;
+	struct presentation *presentation;
+	clockid_t clk_id;
+
+	/* Most recent presentation timestamp seen on any surface. */
+	struct timespec last_present;
+};
+
+struct buffer {
+	struct wl_buffer *buffer;
+	void *shm_data;
+	int busy;
+};
+
+struct bench_surface {
+	struct wl_surface *surface;
+	struct wl_subsurface *subsurface;
+	struct buffer buffers[NUM_BUFFERS];
+	int stride;
+
+	/* Only tracked on the main surface of the first window. */
+	bool timed;
+	bool have_prev;
+	struct timespec prev_present;
+	uint64_t prev_seq;
+};
+
+struct window {
+	struct wl_shell_surface *shell_surface;
+	struct bench_surface *surfaces; /* [0] is the parent */
+	int n_surfaces;
+};
+
+struct feedback {
+	struct bench *bench;
+	struct bench_surface *bs;
+	struct presentation_feedback *feedback;
+	struct timespec commit;
+};
+
+struct stats {
+	int64_t *values;
+	int count, size;
+};
+
+struct bench {
+	struct options opt;
+	struct display display;
+	struct window *windows;
+	struct wl_callback *callback;
+	int frame;
+	int pending;
+
+	struct stats latency;
+	struct stats jitter;
+	uint32_t refresh_nsec;
+	int missed;
+	int discarded;
+};
+
+static int running = 1;
+
+static void
+stats_add(struct stats *s, int64_t value)
+{
+	if (s->count == s->size) {
+		s->size = s->size ? s->size * 2 : 1024;
+		s->values = realloc(s->values, s->size * sizeof s->values[0]);
+		assert(s->values);
+	}
+
+	s->values[s->count++] = value;
+}
+
+static int
+compare_int64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a;
+	int64_t y = *(const int64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int64_t
+stats_percentile(struct stats *s, int percent)
+{
+	int i;
+
+	if (s->count == 0)
+		return 0;
+
+	i = (s->count - 1) * percent / 100;
+
+	return s->values[i];
+}
+
+static void
+stats_print(struct stats *s, const char *name)
+{
+	qsort(s->values, s->count, sizeof s->values[0], compare_int64);
+
+	printf("\"%s_usec\":{ \"p50\":%.1f, \"p90\":%.1f, \"p99\":%.1f, "
+	       "\"max\":%.1f }", name,
+	       stats_percentile(s, 50) / 1000.0,
+	       stats_percentile(s, 90) / 1000.0,
+	       stats_percentile(s, 99) / 1000.0,
+	       stats_percentile(s, 100) / 1000.0);
+}
+
+static int64_t
+timespec_sub_to_nsec(const struct timespec *a, const struct timespec *b)
+{
+	return (int64_t)(a->tv_sec - b->tv_sec) * NSEC_PER_SEC +
+	       a->tv_nsec - b->tv_nsec;
+}
+
+static void
+timespec_from_proto(struct timespec *tm, uint32_t tv_sec_hi,
+		    uint32_t tv_sec_lo, uint32_t tv_nsec)
+{
+	tm->tv_sec = ((uint64_t)tv_sec_hi << 32) + tv_sec_lo;
+	tm->tv_nsec = tv_nsec;
+}
+
+static void
+buffer_release(void *data, struct wl_buffer *buffer)
+{
+	struct buffer *mybuf = data;
+
+	mybuf->busy = 0;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+	buffer_release
+};
+
+static void
+create_buffers(struct display *display, struct bench_surface *bs,
+	       int width, int height)
+{
+	struct wl_shm_pool *pool;
+	int fd, size, i;
+	void *data;
+
+	bs->stride = width * 4;
+	size = bs->stride * height * NUM_BUFFERS;
+
+	fd = os_create_anonymous_file(size);
+	if (fd < 0) {
+		fprintf(stderr, "creating a buffer file for %d B failed: %m\n",
+			size);
+		exit(1);
+	}
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "mmap failed: %m\n");
+		exit(1);
+	}
+
+	pool = wl_shm_create_pool(display->shm, fd, size);
+	for (i = 0; i < NUM_BUFFERS; i++) {
+		bs->buffers[i].buffer =
+			wl_shm_pool_create_buffer(pool,
+						  i * bs->stride * height,
+						  width, height, bs->stride,
+						  WL_SHM_FORMAT_XRGB8888);
+		wl_buffer_add_listener(bs->buffers[i].buffer,
+				       &buffer_listener, &bs->buffers[i]);
+		bs->buffers[i].shm_data =
+			(char *)data + i * bs->stride * height;
+	}
+	wl_shm_pool_destroy(pool);
+	close(fd);
+}
+
+static void
+fill_rect(struct bench_surface *bs, struct buffer *buf,
+	  int x, int y, int w, int h, uint32_t color)
+{
+	uint32_t *row;
+	int i, j;
+
+	for (j = y; j < y + h; j++) {
+		row = (uint32_t *)((char *)buf->shm_data + j * bs->stride);
+		for (i = x; i < x + w; i++)
+			row[i] = color;
+	}
+}
+
+/* Draws the frame into a free buffer, attaches and damages it. */
+static void
+bench_surface_draw(struct bench *bench, struct bench_surface *bs)
+{
+	const struct options *opt = &bench->opt;
+	struct buffer *buf = NULL;
+	uint32_t color = 0xff000000 | (bench->frame * 0x010305);
+	int i, x, y, band;
+
+	for (i = 0; i < NUM_BUFFERS; i++) {
+		if (!bs->buffers[i].busy) {
+			buf = &bs->buffers[i];
+			break;
+		}
+	}
+
+	/* The compositor holds all of them; draw over one anyway. */
+	if (!buf)
+		buf = &bs->buffers[bench->frame % NUM_BUFFERS];
+
+	switch (opt->damage) {
+	case DAMAGE_FULL:
+		fill_rect(bs, buf, 0, 0, opt->width, opt->height, color);
+		wl_surface_damage(bs->surface, 0, 0, opt->width, opt->height);
+		break;
+	case DAMAGE_BAND:
+		band = opt->height / 8 > 0 ? opt->height / 8 : 1;
+		y = (bench->frame * band) % (opt->height - band + 1);
+		fill_rect(bs, buf, 0, y, opt->width, band, color);
+		wl_surface_damage(bs->surface, 0, y, opt->width, band);
+		break;
+	case DAMAGE_SPARSE:
+		for (i = 0; i < 16; i++) {
+			x = ((bench->frame + i) * 37) % (opt->width - 7);
+			y = ((bench->frame + i) * 61) % (opt->height - 7);
+			fill_rect(bs, buf, x, y, 8, 8, color);
+			wl_surface_damage(bs->surface, x, y, 8, 8);
+		}
+		break;
+	}
+
+	wl_surface_attach(bs->surface, buf->buffer, 0, 0);
+	buf->busy = 1;
+}
+
+static void
+feedback_sync_output(void *data,
+		     struct presentation_feedback *presentation_feedback,
+		     struct wl_output *output)
+{
+}
+
+static void
+feedback_destroy(struct feedback *fb)
+{
+	fb->bench->pending--;
+	presentation_feedback_destroy(fb->feedback);
+	free(fb);
+}
+
+static void
+feedback_presented(void *data,
+		   struct presentation_feedback *presentation_feedback,
+		   uint32_t tv_sec_hi,
+		   uint32_t tv_sec_lo,
+		   uint32_t tv_nsec,
+		   uint32_t refresh_nsec,
+		   uint32_t seq_hi,
+		   uint32_t seq_lo,
+		   uint32_t flags)
+{
+	struct feedback *fb = data;
+	struct bench *bench = fb->bench;
+	struct bench_surface *bs = fb->bs;
+	uint64_t seq = ((uint64_t)seq_hi << 32) + seq_lo;
+	struct timespec present;
+	int64_t interval;
+
+	timespec_from_proto(&present, tv_sec_hi, tv_sec_lo, tv_nsec);
+	bench->refresh_nsec = refresh_nsec;
+
+	stats_add(&bench->latency, timespec_sub_to_nsec(&present,
+							&fb->commit));
+
+	if (bs->timed) {
+		if (bs->have_prev) {
+			interval = timespec_sub_to_nsec(&present,
+							&bs->prev_present);
+			stats_add(&bench->jitter,
+				  llabs(interval - refresh_nsec));
+			if (seq > bs->prev_seq + 1)
+				bench->missed += seq - bs->prev_seq - 1;
+		}
+		bs->have_prev = true;
+		bs->prev_present = present;
+		bs->prev_seq = seq;
+	}
+
+	if (timespec_sub_to_nsec(&present, &bench->display.last_present) > 0)
+		bench->display.last_present = present;
+
+	feedback_destroy(fb);
+}
+
+static void
+feedback_discarded(void *data,
+		   struct presentation_feedback *presentation_feedback)
+{
+	struct feedback *fb = data;
+
+	fb->bench->discarded++;
+	feedback_destroy(fb);
+}
+
+static const struct presentation_feedback_listener feedback_listener = {
+	feedback_sync_output,
+	feedback_presented,
+	feedback_discarded
+};
+
+static void
+bench_surface_commit(struct bench *bench, struct bench_surface *bs)
+{
+	struct feedback *fb;
+
+	fb = calloc(1, sizeof *fb);
+	assert(fb);
+	fb->bench = bench;
+	fb->bs = bs;
+	fb->feedback = presentation_feedback(bench->display.presentation,
+					     bs->surface);
+	presentation_feedback_add_listener(fb->feedback,
+					   &feedback_listener, fb);
+
+	if (bench->opt.virtual_clock)
+		fb->commit = bench->display.last_present;
+	else
+		clock_gettime(bench->display.clk_id, &fb->commit);
+
+	wl_surface_commit(bs->surface);
+	bench->pending++;
+}
+
+static const struct wl_callback_listener frame_listener;
+
+static void
+redraw(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct bench *bench = data;
+	struct window *window;
+	int i, j;
+
+	if (callback)
+		wl_callback_destroy(callback);
+	bench->callback = NULL;
+
+	if (bench->frame == bench->opt.frames) {
+		running = 0;
+		return;
+	}
+
+	for (i = 0; i < bench->opt.surfaces; i++) {
+		window = &bench->windows[i];
+
+		/* Children first; synchronized ones only take effect with
+		 * the parent's commit. */
+		for (j = window->n_surfaces - 1; j >= 0; j--) {
+			bench_surface_draw(bench, &window->surfaces[j]);
+
+			if (i == 0 && j == 0) {
+				bench->callback =
+					wl_surface_frame(window->surfaces[0].surface);
+				wl_callback_add_listener(bench->callback,
+							 &frame_listener,
+							 bench);
+			}
+
+			bench_surface_commit(bench, &window->surfaces[j]);
+		}
+	}
+
+	bench->frame++;
+}
+
+static const struct wl_callback_listener frame_listener = {
+	redraw
+};
+
+static void
+handle_ping(void *data, struct wl_shell_surface *shell_surface,
+	    uint32_t serial)
+{
+	wl_shell_surface_pong(shell_surface, serial);
+}
+
+static void
+handle_configure(void *data, struct wl_shell_surface *shell_surface,
+		 uint32_t edges, int32_t width, int32_t height)
+{
+}
+
+static void
+handle_popup_done(void *data, struct wl_shell_surface *shell_surface)
+{
+}
+
+static const struct wl_shell_surface_listener shell_surface_listener = {
+	handle_ping,
+	handle_configure,
+	handle_popup_done
+};
+
+static void
+create_window(struct bench *bench, struct window *window)
+{
+	struct display *d = &bench->display;
+	struct bench_surface *bs;
+	int i;
+
+	window->n_surfaces = 1 + bench->opt.subsurfaces;
+	window->surfaces = calloc(window->n_surfaces,
+				  sizeof window->surfaces[0]);
+	assert(window->surfaces);
+
+	for (i = 0; i < window->n_surfaces; i++) {
+		bs = &window->surfaces[i];
+		bs->surface = wl_compositor_create_surface(d->compositor);
+		create_buffers(d, bs, bench->opt.width, bench->opt.height);
+
+		if (i == 0)
+			continue;
+
+		bs->subsurface =
+			wl_subcompositor_get_subsurface(d->subcompositor,
+							bs->surface,
+							window->surfaces[0].surface);
+		wl_subsurface_set_position(bs->subsurface, 8 * i, 8 * i);
+		if (bench->opt.desync)
+			wl_subsurface_set_desync(bs->subsurface);
+	}
+
+	window->shell_surface =
+		wl_shell_get_shell_surface(d->shell, window->surfaces[0].surface);
+	wl_shell_surface_add_listener(window->shell_surface,
+				      &shell_surface_listener, window);
+	wl_shell_surface_set_title(window->shell_surface,
+				   "presentation-bench");
+	wl_shell_surface_set_toplevel(window->shell_surface);
+}
+
+static void
+presentation_clock_id(void *data, struct presentation *presentation,
+		      uint32_t clk_id)
+{
+	struct display *d = data;
+
+	d->clk_id = clk_id;
+}
+
+static const struct presentation_listener presentation_listener = {
+	presentation_clock_id
+};
+
+static void
+registry_handle_global(void *data, struct wl_registry *registry,
+		       uint32_t name, const char *interface, uint32_t version)
+{
+	struct display *d = data;
+
+	if (strcmp(interface, "wl_compositor") == 0) {
+		d->compositor =
+			wl_registry_bind(registry,
+					 name, &wl_compositor_interface, 1);
+	} else if (strcmp(interface, "wl_subcompositor") == 0) {
+		d->subcompositor =
+			wl_registry_bind(registry,
+					 name, &wl_subcompositor_interface, 1);
+	} else if (strcmp(interface, "wl_shell") == 0) {
+		d->shell = wl_registry_bind(registry,
+					    name, &wl_shell_interface, 1);
+	} else if (strcmp(interface, "wl_shm") == 0) {
+		d->shm = wl_registry_bind(registry,
+					  name, &wl_shm_interface, 1);
+	} else if (strcmp(interface, "presentation") == 0) {
+		d->presentation =
+			wl_registry_bind(registry,
+					 name, &presentation_interface, 1);
+		presentation_add_listener(d->presentation,
+					  &presentation_listener, d);
+	}
+}
+
+static void
+registry_handle_global_remove(void *data, struct wl_registry *registry,
+			      uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+	registry_handle_global,
+	registry_handle_global_remove
+};
+
+static void
+connect_display(struct display *d)
+{
+	d->display = wl_display_connect(NULL);
+	if (!d->display) {
+		fprintf(stderr, "failed to connect to the display: %m\n");
+		exit(1);
+	}
+
+	d->clk_id = CLOCK_MONOTONIC;
+	d->registry = wl_display_get_registry(d->display);
+	wl_registry_add_listener(d->registry, &registry_listener, d);
+	wl_display_roundtrip(d->display);
+	wl_display_roundtrip(d->display);
+
+	if (!d->compositor || !d->subcompositor || !d->shell || !d->shm ||
+	    !d->presentation) {
+		fprintf(stderr, "missing a required global\n");
+		exit(1);
+	}
+}
+
+static void
+signal_int(int signum)
+{
+	running = 0;
+}
+
+static void
+print_results(struct bench *bench)
+{
+	const struct options *opt = &bench->opt;
+
+	printf("{ \"frames\":%d, \"width\":%d, \"height\":%d, "
+	       "\"surfaces\":%d, \"subsurfaces\":%d, \"desync\":%s, "
+	       "\"damage\":\"%s\", \"clock\":\"%s\", \"refresh_nsec\":%u, "
+	       "\"missed\":%d, \"discarded\":%d, ",
+	       bench->frame, opt->width, opt->height, opt->surfaces,
+	       opt->subsurfaces, opt->desync ? "true" : "false",
+	       damage_name[opt->damage],
+	       opt->virtual_clock ? "virtual" : "real",
+	       bench->refresh_nsec, bench->missed, bench->discarded);
+	stats_print(&bench->latency, "latency");
+	printf(", ");
+	stats_print(&bench->jitter, "jitter");
+	printf(" }\n");
+}
+
+static void
+usage(int error_code)
+{
+	fprintf(stderr, "Usage: weston-presentation-bench [options]\n\n"
+		"  --width=WIDTH\t\tBuffer width (default 256)\n"
+		"  --height=HEIGHT\tBuffer height (default 256)\n"
+		"  --surfaces=N\t\tNumber of top-level surfaces (default 1)\n"
+		"  --subsurfaces=N\tSub-surfaces per surface (default 0)\n"
+		"  --desync\t\tMake sub-surfaces desynchronized\n"
+		"  --damage=PATTERN\tfull (default), band or sparse\n"
+		"  --frames=N\t\tNumber of frames to draw (default 600)\n"
+		"  --virtual-clock\tThe compositor runs a virtual clock, e.g.\n"
+		"\t\t\theadless with --frame-mode=virtual\n"
+		"  --help\t\tThis help text\n\n");
+
+	exit(error_code);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct sigaction sigint;
+	struct bench bench;
+	struct options *opt = &bench.opt;
+	char damage[16];
+	int i, ret = 0;
+
+	memset(&bench, 0, sizeof bench);
+	opt->width = 256;
+	opt->height = 256;
+	opt->surfaces = 1;
+	opt->frames = 600;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--help") == 0)
+			usage(EXIT_SUCCESS);
+		else if (sscanf(argv[i], "--width=%d", &opt->width) > 0)
+			;
+		else if (sscanf(argv[i], "--height=%d", &opt->height) > 0)
+			;
+		else if (sscanf(argv[i], "--surfaces=%d", &opt->surfaces) > 0)
+			;
+		else if (sscanf(argv[i], "--subsurfaces=%d",
+				&opt->subsurfaces) > 0)
+			;
+		else if (strcmp(argv[i], "--desync") == 0)
+			opt->desync = true;
+		else if (sscanf(argv[i], "--damage=%15s", damage) > 0) {
+			if (strcmp(damage, "full") == 0)
+				opt->damage = DAMAGE_FULL;
+			else if (strcmp(damage, "band") == 0)
+				opt->damage = DAMAGE_BAND;
+			else if (strcmp(damage, "sparse") == 0)
+				opt->damage = DAMAGE_SPARSE;
+			else
+				usage(EXIT_FAILURE);
+		} else if (sscanf(argv[i], "--frames=%d", &opt->frames) > 0)
+			;
+		else if (strcmp(argv[i], "--virtual-clock") == 0)
+			opt->virtual_clock = true;
+		else
+			usage(EXIT_FAILURE);
+	}
+
+	if (opt->width < 8 || opt->height < 8 || opt->surfaces < 1 ||
+	    opt->subsurfaces < 0 || opt->frames < 1)
+		usage(EXIT_FAILURE);
+
+	connect_display(&bench.display);
+
+	bench.windows = calloc(opt->surfaces, sizeof bench.windows[0]);
+	assert(bench.windows);
+	for (i = 0; i < opt->surfaces; i++)
+		create_window(&bench, &bench.windows[i]);
+	bench.windows[0].surfaces[0].timed = true;
+
+	sigint.sa_handler = signal_int;
+	sigemptyset(&sigint.sa_mask);
+	sigint.sa_flags = SA_RESETHAND;
+	sigaction(SIGINT, &sigint, NULL);
+
+	redraw(&bench, NULL, 0);
+
+	while (running && ret != -1)
+		ret = wl_display_dispatch(bench.display.display);
+
+	/* Collect the feedback of the last frames. */
+	while (bench.pending > 0 && ret != -1)
+		ret = wl_display_dispatch(bench.display.display);
+
+	print_results(&bench);
+
+	wl_display_disconnect(bench.display.display);
+
+	return ret == -1 ? 1 : 0;
+}
@@ -699,6 +699,7 @@ create_focus_surface(struct weston_compositor *ec,
 {
 	struct focus_surface *fsurf = NULL;
 	struct weston_surface *surface = NULL;
+	pixman_region32_t input;
 
 	fsurf = malloc(sizeof *fsurf);
 	if (!fsurf)
@@ -730,8 +731,9 @@ create_focus_surface(struct weston_compositor *ec,
 	pixman_region32_fini(&surface->opaque);
 	pixman_region32_init_rect(&surface->opaque, output->x, output->y,
 				  output->width, output->height);
-	pixman_region32_fini(&surface->input);
-	pixman_region32_init(&surface->input);
+	pixman_region32_init(&input);
+	weston_surface_set_input_region(surface, &input);
+	pixman_region32_fini(&input);
 
 	wl_list_init(&fsurf->workspace_transform.link);
 
@@ -2819,6 +2821,7 @@ create_black_surface(struct weston_compositor *ec,
 {
 	struct weston_surface *surface = NULL;
 	struct weston_view *view;
+	pixman_region32_t input;
 
 	surface = weston_surface_create(ec);
 	if (surface == NULL) {
@@ -2838,8 +2841,9 @@ create_black_surface(struct weston_compositor *ec,
 	weston_surface_set_color(surface, 0.0, 0.0, 0.0, 1);
 	pixman_region32_fini(&surface->opaque);
 	pixman_region32_init_rect(&surface->opaque, 0, 0, w, h);
-	pixman_region32_fini(&surface->input);
-	pixman_region32_init_rect(&surface->input, 0, 0, w, h);
+	pixman_region32_init_rect(&input, 0, 0, w, h);
+	weston_surface_set_input_region(surface, &input);
+	pixman_region32_fini(&input);
 
 	weston_surface_set_size(surface, w, h);
 	weston_view_set_position(view, x, y);
@@ -3584,6 +3588,7 @@ handle_resource_destroy(struct wl_listener *listener, void *data)
 	struct shell_surface *shsurf =
 		container_of(listener, struct shell_surface,
 			     resource_destroy_listener);
+	pixman_region32_t input;
 
 	if (!weston_surface_is_mapped(shsurf->surface))
 		return;
@@ -3592,8 +3597,9 @@ handle_resource_destroy(struct wl_listener *listener, void *data)
 
 	pixman_region32_fini(&shsurf->surface->pending.input);
 	pixman_region32_init(&shsurf->surface->pending.input);
-	pixman_region32_fini(&shsurf->surface->input);
-	pixman_region32_init(&shsurf->surface->input);
+	pixman_region32_init(&input);
+	weston_surface_set_input_region(shsurf->surface, &input);
+	pixman_region32_fini(&input);
 	if (shsurf->shell->win_close_animation_type == ANIMATION_FADE) {
 		weston_fade_run(shsurf->view, 1.0, 0.0, 300.0,
 				fade_out_done, shsurf);
@@ -5237,6 +5243,7 @@ shell_fade_create_surface(struct desktop_shell *shell)
 	struct weston_compositor *compositor = shell->compositor;
 	struct weston_surface *surface;
 	struct weston_view *view;
+	pixman_region32_t input;
 
 	surface = weston_surface_create(compositor);
 	if (!surface)
@@ -5253,7 +5260,9 @@ shell_fade_create_surface(struct desktop_shell *shell)
 	weston_surface_set_color(surface, 0.0, 0.0, 0.0, 1.0);
 	weston_layer_entry_insert(&compositor->fade_layer.view_list,
 				  &view->layer_link);
-	pixman_region32_init(&surface->input);
+	pixman_region32_init(&input);
+	weston_surface_set_input_region(surface, &input);
+	pixman_region32_fini(&input);
 
 	return view;
 }
@@ -88,6 +88,7 @@ struct hmi_server_setting {
 	int32_t     panel_height;
 	uint32_t    transition_duration;
 	char       *ivi_homescreen;
+	char       *scene_snapshot;
 };
 
 struct ui_setting {
@@ -115,6 +116,9 @@ struct hmi_controller {
 	struct wl_array                     ui_widgets;
 	int32_t                             is_initialized;
 
+	/* ivi_surfaces filled by switch_mode, reused across calls */
+	struct wl_array                     surfaces;
+
 	struct weston_compositor           *compositor;
 	struct wl_listener                  destroy_listener;
 
@@ -209,17 +213,12 @@ mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
 	int32_t surface_x = 0;
 	int32_t surface_y = 0;
 	struct ivi_layout_surface *ivisurf  = NULL;
-	struct ivi_layout_surface **surfaces;
-	struct ivi_layout_surface **new_order;
 	const uint32_t duration = hmi_ctrl->hmi_setting->transition_duration;
 
 	int32_t i = 0;
 	int32_t surf_num = 0;
 	uint32_t num = 1;
 
-	surfaces = MEM_ALLOC(sizeof(*surfaces) * surface_length);
-	new_order = MEM_ALLOC(sizeof(*surfaces) * surface_length);
-
 	for (i = 0; i < surface_length; i++) {
 		ivisurf = pp_surface[i];
 
@@ -227,12 +226,7 @@ mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
 		if (is_surf_in_ui_widget(hmi_ctrl, ivisurf))
 			continue;
 
-		surfaces[surf_num++] = ivisurf;
-	}
-
-	for (i = 0; i < surf_num; i++) {
-		ivisurf = surfaces[i];
-		new_order[i] = ivisurf;
+		surf_num++;
 
 		if (num <= 8) {
 			if (num < 5) {
@@ -263,9 +257,6 @@ mode_divided_into_tiling(struct hmi_controller *hmi_ctrl,
 				IVI_LAYOUT_TRANSITION_LAYER_VIEW_ORDER,
 				duration);
 	}
-
-	free(surfaces);
-	free(new_order);
 }
 
 static void
@@ -407,6 +398,38 @@ has_application_surface(struct hmi_controller *hmi_ctrl,
 	return 0;
 }
 
+/**
+ * Fills hmi_ctrl->surfaces with all ivi_surfaces. The array only grows
+ * when there are more ivi_surfaces than at any previous call.
+ */
+static int32_t
+get_surfaces(struct hmi_controller *hmi_ctrl,
+	     struct ivi_layout_surface ***pp_surface)
+{
+	struct wl_array *surfaces = &hmi_ctrl->surfaces;
+	int32_t capacity = surfaces->size / sizeof(**pp_surface);
+	int32_t length = 0;
+	size_t size;
+
+	for (;;) {
+		length = ivi_controller_interface->get_surfaces_into(
+				surfaces->data, capacity);
+		assert(length >= 0);
+
+		if (length <= capacity)
+			break;
+
+		size = (length - capacity) * sizeof(**pp_surface);
+		fail_on_null(wl_array_add(surfaces, size), size,
+			     __FILE__, __LINE__);
+		capacity = length;
+	}
+
+	*pp_surface = surfaces->data;
+
+	return length;
+}
+
 /**
  * Supports 4 example to layout of application ivi_surfaces;
  * tiling, side by side, fullscreen, and random.
@@ -418,21 +441,16 @@ switch_mode(struct hmi_controller *hmi_ctrl,
 	struct hmi_controller_layer *layer = &hmi_ctrl->application_layer;
 	struct ivi_layout_surface **pp_surface = NULL;
 	int32_t surface_length = 0;
-	int32_t ret = 0;
 
 	if (!hmi_ctrl->is_initialized)
 		return;
 
 	hmi_ctrl->layout_mode = layout_mode;
 
-	ret = ivi_controller_interface->get_surfaces(&surface_length, &pp_surface);
-	assert(!ret);
+	surface_length = get_surfaces(hmi_ctrl, &pp_surface);
 
-	if (!has_application_surface(hmi_ctrl, pp_surface, surface_length)) {
-		free(pp_surface);
-		pp_surface = NULL;
+	if (!has_application_surface(hmi_ctrl, pp_surface, surface_length))
 		return;
-	}
 
 	switch (layout_mode) {
 	case IVI_HMI_CONTROLLER_LAYOUT_MODE_TILING:
@@ -454,7 +472,6 @@ switch_mode(struct hmi_controller *hmi_ctrl,
 	}
 
 	ivi_controller_interface->commit_changes();
-	free(pp_surface);
 }
 
 /**
@@ -584,6 +601,9 @@ hmi_server_setting_create(struct weston_compositor *ec)
 					 "ivi-shell-user-interface",
 					 &setting->ivi_homescreen, NULL);
 
+	weston_config_section_get_string(shell_section, "scene-snapshot",
+					 &setting->scene_snapshot, NULL);
+
 	return setting;
 }
 
@@ -595,6 +615,11 @@ hmi_controller_destroy(struct wl_listener *listener, void *data)
 	struct hmi_controller *hmi_ctrl =
 		container_of(listener, struct hmi_controller, destroy_listener);
 
+	/* restored on the next start by controller_module_init */
+	if (hmi_ctrl->hmi_setting->scene_snapshot)
+		ivi_controller_interface->scene_save(
+			hmi_ctrl->hmi_setting->scene_snapshot);
+
 	wl_list_for_each_safe(link, next,
 			      &hmi_ctrl->workspace_fade.layer_list, link) {
 		wl_list_remove(&link->link);
@@ -602,6 +627,8 @@ hmi_controller_destroy(struct wl_listener *listener, void *data)
 	}
 
 	wl_array_release(&hmi_ctrl->ui_widgets);
+	wl_array_release(&hmi_ctrl->surfaces);
+	free(hmi_ctrl->hmi_setting->scene_snapshot);
 	free(hmi_ctrl->hmi_setting);
 	free(hmi_ctrl);
 }
@@ -634,6 +661,7 @@ hmi_controller_create(struct weston_compositor *ec)
 	struct hmi_controller *hmi_ctrl = MEM_ALLOC(sizeof(*hmi_ctrl));
 
 	wl_array_init(&hmi_ctrl->ui_widgets);
+	wl_array_init(&hmi_ctrl->surfaces);
 	hmi_ctrl->layout_mode = IVI_HMI_CONTROLLER_LAYOUT_MODE_TILING;
 	hmi_ctrl->hmi_setting = hmi_server_setting_create(ec);
 	hmi_ctrl->compositor = ec;
@@ -1724,6 +1752,13 @@ controller_module_init(struct weston_compositor *ec,
 		return -1;
 	}
 
+	/* Put the scene of the last run in place before any client
+	 * connects, so that its first frame shows the final layout. */
+	if (hmi_ctrl->hmi_setting->scene_snapshot &&
+	    access(hmi_ctrl->hmi_setting->scene_snapshot, R_OK) == 0)
+		ivi_controller_interface->scene_restore(
+			hmi_ctrl->hmi_setting->scene_snapshot);
+
 	if (wl_global_create(ec->wl_display,
 			     &ivi_hmi_controller_interface, 1,
 			     hmi_ctrl, bind_hmi_controller) == NULL) {
@@ -170,6 +170,44 @@ typedef void (*ivi_controller_surface_content_callback)(
 			int32_t content,
 			void *userdata);
 
+/* One entry per ivi_layer or ivi_surface changed by a commit. */
+struct ivi_layout_layer_change {
+	struct ivi_layout_layer *ivilayer;
+	enum ivi_layout_notification_mask mask;
+};
+
+struct ivi_layout_surface_change {
+	struct ivi_layout_surface *ivisurf;
+	enum ivi_layout_notification_mask mask;
+};
+
+struct ivi_layout_commit_summary {
+	const struct ivi_layout_layer_change *layers;
+	int32_t layer_count;
+	const struct ivi_layout_surface_change *surfaces;
+	int32_t surface_count;
+};
+
+struct ivi_layout_layer_cache_stats {
+	uint32_t hits;		/* repaints that reused the image */
+	uint32_t misses;	/* repaints that rendered it again */
+	size_t bytes;		/* size of the image */
+};
+
+typedef void (*commit_notification_func)(
+			const struct ivi_layout_commit_summary *summary,
+			void *userdata);
+
+/* Visitors for the for_each_* methods. Returning non-zero stops the
+ * iteration. */
+typedef int32_t (*ivi_layout_surface_visitor_func)(
+			struct ivi_layout_surface *ivisurf,
+			void *userdata);
+
+typedef int32_t (*ivi_layout_layer_visitor_func)(
+			struct ivi_layout_layer *ivilayer,
+			void *userdata);
+
 struct ivi_controller_interface {
 
 	/**
@@ -768,6 +806,113 @@ struct ivi_controller_interface {
 				       uint32_t is_fade_in,
 				       double start_alpha, double end_alpha);
 
+	/**
+	 * allocation-free queries
+	 *
+	 * The for_each_* methods call a visitor for each element in the
+	 * order of the matching get_* method. The visitor may remove the
+	 * visited ivi_surface or ivi_layer, but no other.
+	 *
+	 * The *_into methods copy at most size elements to a caller-owned
+	 * array, and return the total number of elements, which may be
+	 * larger than size, or IVI_FAILED.
+	 */
+	int32_t (*for_each_surface)(ivi_layout_surface_visitor_func visitor,
+				    void *userdata);
+	int32_t (*for_each_surface_on_layer)(struct ivi_layout_layer *ivilayer,
+					     ivi_layout_surface_visitor_func visitor,
+					     void *userdata);
+	int32_t (*for_each_layer)(ivi_layout_layer_visitor_func visitor,
+				  void *userdata);
+	int32_t (*for_each_layer_on_screen)(struct ivi_layout_screen *iviscrn,
+					    ivi_layout_layer_visitor_func visitor,
+					    void *userdata);
+
+	int32_t (*get_surfaces_into)(struct ivi_layout_surface **array,
+				     int32_t size);
+	int32_t (*get_surfaces_on_layer_into)(struct ivi_layout_layer *ivilayer,
+					      struct ivi_layout_surface **array,
+					      int32_t size);
+	int32_t (*get_layers_into)(struct ivi_layout_layer **array,
+				   int32_t size);
+	int32_t (*get_layers_on_screen_into)(struct ivi_layout_screen *iviscrn,
+					     struct ivi_layout_layer **array,
+					     int32_t size);
+
+	/**
+	 * \brief register/unregister for one notification per commit,
+	 * listing every changed ivi_layer and ivi_surface with its
+	 * notification mask, before the per-object property notifications.
+	 *
+	 * The summary is only valid during the callback. Changes made from
+	 * the callback are applied by the next commit, which may be made
+	 * from the callback too. An entry of an object removed by an
+	 * earlier callback is NULL.
+	 *
+	 * \return IVI_SUCCEEDED if the method call was successful
+	 * \return IVI_FAILED if the method call was failed
+	 */
+	int32_t (*add_notification_commit)(commit_notification_func callback,
+					   void *userdata);
+	void (*remove_notification_commit)(commit_notification_func callback,
+					   void *userdata);
+
+	/**
+	 * \brief Enable or disable property notifications, batched and per
+	 * object, for commits made by transitions which are still running.
+	 * The commit finishing the last transition always notifies.
+	 * Enabled by default.
+	 */
+	void (*set_transition_frame_notification)(bool enabled);
+
+	/**
+	 * \brief Render the ivi_surfaces of an ivi_layer into one offscreen
+	 * image, which is composited with the layer's opacity and
+	 * destination position. Moving or fading such a layer reuses the
+	 * image; it is rendered again only when an ivi_surface of it
+	 * changes, or the layer's size, source rectangle or orientation.
+	 * A layer whose ivi_surfaces have subsurfaces is drawn without the
+	 * image. Applied on the next commit.
+	 *
+	 * \return IVI_SUCCEEDED if the method call was successful
+	 * \return IVI_FAILED if the method call was failed, also if the
+	 * renderer cannot cache
+	 */
+	int32_t (*layer_set_cache)(struct ivi_layout_layer *ivilayer,
+				   bool enabled);
+
+	/**
+	 * \brief Get how often the image of a cached ivi_layer was reused
+	 * and rendered, and its current size. All zero for a layer which
+	 * is not cached.
+	 *
+	 * \return IVI_SUCCEEDED if the method call was successful
+	 * \return IVI_FAILED if the method call was failed
+	 */
+	int32_t (*layer_get_cache_stats)(struct ivi_layout_layer *ivilayer,
+					 struct ivi_layout_layer_cache_stats *stats);
+
+	/**
+	 * \brief Save the committed scene, the properties and render orders
+	 * of all ivi_surfaces, ivi_layers and ivi_screens, to a file.
+	 *
+	 * \return IVI_SUCCEEDED if the method call was successful
+	 * \return IVI_FAILED if the method call was failed
+	 */
+	int32_t (*scene_save)(const char *filename);
+
+	/**
+	 * \brief Restore a scene saved by scene_save in one commit. Missing
+	 * ivi_layers are created. ivi_surfaces which do not exist yet are
+	 * placed as they are created, before the create notification, and
+	 * show there from the next commit. The source rectangle of an
+	 * ivi_surface is left to its buffer.
+	 *
+	 * \return IVI_SUCCEEDED if the method call was successful
+	 * \return IVI_FAILED if the file could not be read, in which case
+	 * the scene is left unchanged
+	 */
+	int32_t (*scene_restore)(const char *filename);
 };
 
 #ifdef __cplusplus
@@ -36,6 +36,9 @@ struct ivi_layout_surface {
 	struct ivi_layout *layout;
 	struct weston_surface *surface;
 
+	/* ivi_layout::dirty.surface_list */
+	struct wl_list dirty_link;
+
 	struct wl_listener surface_destroy_listener;
 	struct weston_transform surface_rotation;
 	struct weston_transform layer_rotation;
@@ -73,6 +76,13 @@ struct ivi_layout_layer {
 
 	struct ivi_layout *layout;
 
+	/* ivi_layout::dirty.layer_list */
+	struct wl_list dirty_link;
+
+	/* Offscreen cache, see ivi_layout_layer_set_cache() */
+	struct weston_view_cache *cache;
+	int cache_enabled; /* applied on commit */
+
 	struct ivi_layout_layer_properties prop;
 	uint32_t event_mask;
 
@@ -95,6 +105,18 @@ struct ivi_layout {
 	struct wl_list layer_list;
 	struct wl_list screen_list;
 
+	/* surface_list and layer_list indexed by ID */
+	struct hash_table *surface_hash;
+	struct hash_table *layer_hash;
+
+	/* Changed since the last ivi_layout_commit_changes */
+	struct {
+		struct wl_list surface_list;
+		struct wl_list layer_list;
+		int order; /* render order or visibility */
+		uint32_t output_mask; /* outputs to repaint */
+	} dirty;
+
 	struct {
 		struct wl_signal created;
 		struct wl_signal removed;
@@ -110,16 +132,50 @@ struct ivi_layout {
 	struct wl_signal warning_signal;
 
 	struct ivi_layout_transition_set *transitions;
-	struct wl_list pending_transition_list;
+
+	/* Members of a cached ivi_layer, reused across commits */
+	struct wl_array cache_views;
+
+	/* Restored by ivi_layout_scene_restore(), kept to place the
+	 * ivi_surfaces created afterwards */
+	struct {
+		struct wl_array surfaces;	/* struct scene_surface */
+		struct wl_array layers;		/* struct scene_layer */
+		struct wl_array surface_ids;	/* uint32_t */
+	} scene;
+
+	struct {
+		struct wl_signal committed;
+		/* summary entries, reused across commits */
+		struct wl_array layers;
+		struct wl_array surfaces;
+		/* struct prop_notification, innermost commit first */
+		struct wl_list sending;
+		/* set while a transition frame commits */
+		int transition_frame;
+		int suppress_transition_frames;
+	} commit_notification;
 };
 
 struct ivi_layout *get_instance(void);
 
 struct ivi_layout_transition;
 
+/* Transitions are kept as parallel arrays indexed alike, so that a frame
+ * advances all of them in one pass. The first active_count entries are
+ * running; the rest are pending until the next commit. */
 struct ivi_layout_transition_set {
 	struct wl_event_source  *event_source;
-	struct wl_list          transition_list;
+
+	struct ivi_layout_transition **transition;
+	uint32_t *time_start;
+	uint32_t *time_duration;
+	float    *progress;
+	uint32_t *is_done;
+
+	int32_t count;
+	int32_t active_count;
+	int32_t capacity;
 };
 
 typedef void (*ivi_layout_transition_destroy_user_func)(void *user_data);
@@ -169,7 +225,7 @@ ivi_layout_surface_configure(struct ivi_layout_surface *ivisurf,
 struct ivi_layout_surface*
 ivi_layout_surface_create(struct weston_surface *wl_surface,
 			  uint32_t id_surface);
-void
+int
 ivi_layout_init_with_compositor(struct weston_compositor *ec);
 int32_t
 ivi_layout_surface_get_dimension(struct ivi_layout_surface *ivisurf,
@@ -36,24 +36,46 @@ typedef void (*ivi_layout_transition_destroy_func)(
 			struct ivi_layout_transition *transition);
 typedef int32_t (*ivi_layout_is_transition_func)(void *private_data, void *id);
 
+/* The timing of a transition lives in the columns of
+ * ivi_layout_transition_set at index. */
 struct ivi_layout_transition {
 	enum ivi_layout_transition_type type;
 	void *private_data;
 	void *user_data;
 
-	uint32_t time_start;
-	uint32_t time_duration;
-	uint32_t time_elapsed;
-	uint32_t  is_done;
+	int32_t index;
 	ivi_layout_is_transition_func is_transition_func;
 	ivi_layout_transition_frame_func frame_func;
 	ivi_layout_transition_destroy_func destroy_func;
 };
 
-struct transition_node {
-	struct ivi_layout_transition *transition;
-	struct wl_list link;
-};
+/* sin(x * pi / 2) sampled over [0, 1], interpolated linearly */
+#define EASE_STEPS 256
+static float ease_table[EASE_STEPS + 1];
+
+static void
+init_ease_table(void)
+{
+	int i;
+
+	for (i = 0; i <= EASE_STEPS; i++)
+		ease_table[i] = sin((double)i / EASE_STEPS * M_PI_2);
+}
+
+static float
+ease(uint32_t elapsed, uint32_t duration)
+{
+	float x;
+	int i;
+
+	if (elapsed >= duration)
+		return ease_table[EASE_STEPS];
+
+	x = (float)elapsed / (float)duration * EASE_STEPS;
+	i = (int)x;
+
+	return ease_table[i] + (ease_table[i + 1] - ease_table[i]) * (x - i);
+}
 
 static void layout_transition_destroy(struct ivi_layout_transition *transition);
 
@@ -61,12 +83,13 @@ static struct ivi_layout_transition *
 get_transition_from_type_and_id(enum ivi_layout_transition_type type,
 				void *id_data)
 {
-	struct ivi_layout *layout = get_instance();
-	struct transition_node *node;
+	struct ivi_layout_transition_set *transitions =
+		get_instance()->transitions;
 	struct ivi_layout_transition *tran;
+	int32_t i;
 
-	wl_list_for_each(node, &layout->transitions->transition_list, link) {
-		tran = node->transition;
+	for (i = 0; i < transitions->active_count; i++) {
+		tran = transitions->transition[i];
 
 		if (tran->type == type &&
 		    tran->is_transition_func(tran->private_data, id_data))
@@ -79,12 +102,13 @@ get_transition_from_type_and_id(enum ivi_layout_transition_type type,
 int32_t
 is_surface_transition(struct ivi_layout_surface *surface)
 {
-	struct ivi_layout *layout = get_instance();
-	struct transition_node *node;
+	struct ivi_layout_transition_set *transitions =
+		get_instance()->transitions;
 	struct ivi_layout_transition *tran;
+	int32_t i;
 
-	wl_list_for_each(node, &layout->transitions->transition_list, link) {
-		tran = node->transition;
+	for (i = 0; i < transitions->active_count; i++) {
+		tran = transitions->transition[i];
 
 		if ((tran->type == IVI_LAYOUT_TRANSITION_VIEW_MOVE_RESIZE ||
 		     tran->type == IVI_LAYOUT_TRANSITION_VIEW_RESIZE) &&
@@ -95,50 +119,65 @@ is_surface_transition(struct ivi_layout_surface *surface)
 	return 0;
 }
 
+/* Restarts a transition from its first frame with a new duration. */
 static void
-tick_transition(struct ivi_layout_transition *transition, uint32_t timestamp)
+transition_restart(struct ivi_layout_transition *transition,
+		   uint32_t duration)
 {
-	const double t = timestamp - transition->time_start;
+	struct ivi_layout_transition_set *transitions =
+		get_instance()->transitions;
 
-	if (transition->time_duration <= t) {
-		transition->time_elapsed = transition->time_duration;
-		transition->is_done = 1;
-	} else {
-		transition->time_elapsed = t;
-	}
+	transitions->time_start[transition->index] = 0;
+	transitions->time_duration[transition->index] = duration;
+	transitions->progress[transition->index] = 0.0f;
+	transitions->is_done[transition->index] = 0;
 }
 
 static float time_to_nowpos(struct ivi_layout_transition *transition)
 {
-	return sin((float)transition->time_elapsed /
-		   (float)transition->time_duration * M_PI_2);
+	return get_instance()->transitions->progress[transition->index];
 }
 
-static void
-do_transition_frame(struct ivi_layout_transition *transition,
-		    uint32_t timestamp)
+static uint32_t
+transition_is_done(struct ivi_layout_transition *transition)
 {
-	if (0 == transition->time_start)
-		transition->time_start = timestamp;
-
-	tick_transition(transition, timestamp);
-	transition->frame_func(transition);
+	return get_instance()->transitions->is_done[transition->index];
+}
 
-	if (transition->is_done)
-		layout_transition_destroy(transition);
+/* Advances the timing of all active transitions in one pass. */
+static void
+tick_transitions(struct ivi_layout_transition_set *transitions,
+		 uint32_t timestamp)
+{
+	uint32_t *time_start = transitions->time_start;
+	const uint32_t *time_duration = transitions->time_duration;
+	float *progress = transitions->progress;
+	uint32_t *is_done = transitions->is_done;
+	uint32_t elapsed;
+	int32_t i;
+
+	for (i = 0; i < transitions->active_count; i++) {
+		if (time_start[i] == 0)
+			time_start[i] = timestamp;
+
+		elapsed = timestamp - time_start[i];
+		is_done[i] = elapsed >= time_duration[i];
+		progress[i] = ease(elapsed, time_duration[i]);
+	}
 }
 
 static int32_t
 layout_transition_frame(void *data)
 {
 	struct ivi_layout_transition_set *transitions = data;
+	struct ivi_layout *layout = get_instance();
 	uint32_t fps = 30;
 	struct timespec timestamp = {};
 	uint32_t msec = 0;
-	struct transition_node *node = NULL;
-	struct transition_node *next = NULL;
+	struct ivi_layout_transition *transition = NULL;
+	int32_t i;
 
-	if (wl_list_empty(&transitions->transition_list)) {
+	if (transitions->active_count == 0) {
 		wl_event_source_timer_update(transitions->event_source, 0);
 		return 1;
 	}
@@ -148,11 +187,24 @@ layout_transition_frame(void *data)
 	clock_gettime(CLOCK_MONOTONIC, &timestamp);/* FIXME */
 	msec = (1e+3 * timestamp.tv_sec + 1e-6 * timestamp.tv_nsec);
 
-	wl_list_for_each_safe(node, next, &transitions->transition_list, link) {
-		do_transition_frame(node->transition, msec);
+	tick_transitions(transitions, msec);
+
+	for (i = 0; i < transitions->active_count; i++) {
+		transition = transitions->transition[i];
+		transition->frame_func(transition);
+	}
+
+	/* Backwards, as destroying moves the last active entry into the
+	 * freed slot. */
+	for (i = transitions->active_count - 1; i >= 0; i--) {
+		if (i < transitions->active_count && transitions->is_done[i])
+			layout_transition_destroy(transitions->transition[i]);
 	}
 
+	layout->commit_notification.transition_frame =
+		transitions->active_count > 0;
 	ivi_layout_commit_changes();
+	layout->commit_notification.transition_frame = 0;
 	return 1;
 }
 
@@ -162,13 +214,13 @@ ivi_layout_transition_set_create(struct weston_compositor *ec)
 	struct ivi_layout_transition_set *transitions;
 	struct wl_event_loop *loop;
 
-	transitions = malloc(sizeof(*transitions));
+	transitions = zalloc(sizeof(*transitions));
 	if (transitions == NULL) {
 		weston_log("%s: memory allocation fails\n", __func__);
 		return NULL;
 	}
 
-	wl_list_init(&transitions->transition_list);
+	init_ease_table();
 
 	loop = wl_display_get_event_loop(ec->wl_display);
 	transitions->event_source =
@@ -178,46 +230,75 @@ ivi_layout_transition_set_create(struct weston_compositor *ec)
 	return transitions;
 }
 
-static void
-layout_transition_register(struct ivi_layout_transition *trans)
+static int
+transition_set_reserve(struct ivi_layout_transition_set *transitions,
+		       int32_t count)
 {
-	struct ivi_layout *layout = get_instance();
-	struct transition_node *node;
+	int32_t capacity = transitions->capacity;
+	void *p;
 
-	node = malloc(sizeof(*node));
-	if (node == NULL) {
-		weston_log("%s: memory allocation fails\n", __func__);
+	if (count <= capacity)
+		return 0;
+
+	capacity = capacity ? capacity * 2 : 16;
+
+#define GROW(column)							\
+	p = realloc(transitions->column,				\
+		    capacity * sizeof(*transitions->column));		\
+	if (p == NULL)							\
+		return -1;						\
+	transitions->column = p;
+
+	GROW(transition);
+	GROW(time_start);
+	GROW(time_duration);
+	GROW(progress);
+	GROW(is_done);
+#undef GROW
+
+	transitions->capacity = capacity;
+
+	return 0;
+}
+
+static void
+transition_set_move(struct ivi_layout_transition_set *transitions,
+		    int32_t from, int32_t to)
+{
+	if (from == to)
 		return;
-	}
 
-	node->transition = trans;
-	wl_list_insert(&layout->pending_transition_list, &node->link);
+	transitions->transition[to] = transitions->transition[from];
+	transitions->time_start[to] = transitions->time_start[from];
+	transitions->time_duration[to] = transitions->time_duration[from];
+	transitions->progress[to] = transitions->progress[from];
+	transitions->is_done[to] = transitions->is_done[from];
+
+	transitions->transition[to]->index = to;
 }
 
+/* Removes a transition from the set, keeping active entries in front of
+ * pending ones. */
 static void
 remove_transition(struct ivi_layout *layout,
 		  struct ivi_layout_transition *trans)
 {
-	struct transition_node *node;
-	struct transition_node *next;
+	struct ivi_layout_transition_set *transitions = layout->transitions;
+	int32_t i = trans->index;
 
-	wl_list_for_each_safe(node, next,
-			      &layout->transitions->transition_list, link) {
-		if (node->transition == trans) {
-			wl_list_remove(&node->link);
-			free(node);
-			return;
-		}
-	}
+	if (i < 0)
+		return;
 
-	wl_list_for_each_safe(node, next,
-			      &layout->pending_transition_list, link) {
-		if (node->transition == trans) {
-			wl_list_remove(&node->link);
-			free(node);
-			return;
-		}
+	if (i < transitions->active_count) {
+		transitions->active_count--;
+		transition_set_move(transitions, transitions->active_count, i);
+		i = transitions->active_count;
 	}
+
+	transitions->count--;
+	transition_set_move(transitions, transitions->count, i);
+
+	trans->index = -1;
 }
 
 static void
@@ -231,22 +312,27 @@ layout_transition_destroy(struct ivi_layout_transition *transition)
 	free(transition);
 }
 
+/* Creates a transition, pending until the next ivi_layout_commit_changes. */
 static struct ivi_layout_transition *
 create_layout_transition(void)
 {
-	struct ivi_layout_transition *transition = malloc(sizeof(*transition));
+	struct ivi_layout_transition_set *transitions =
+		get_instance()->transitions;
+	struct ivi_layout_transition *transition;
+	int32_t i;
+
+	if (transition_set_reserve(transitions, transitions->count + 1) < 0) {
+		weston_log("%s: memory allocation fails\n", __func__);
+		return NULL;
+	}
 
+	transition = malloc(sizeof(*transition));
 	if (transition == NULL) {
 		weston_log("%s: memory allocation fails\n", __func__);
 		return NULL;
 	}
 
 	transition->type = IVI_LAYOUT_TRANSITION_MAX;
-	transition->time_start = 0;
-	transition->time_duration = 300; /* 300ms */
-	transition->time_elapsed = 0;
-
-	transition->is_done = 0;
 
 	transition->private_data = NULL;
 	transition->user_data = NULL;
@@ -254,6 +340,11 @@ create_layout_transition(void)
 	transition->frame_func = NULL;
 	transition->destroy_func = NULL;
 
+	i = transitions->count++;
+	transitions->transition[i] = transition;
+	transition->index = i;
+	transition_restart(transition, 300); /* 300ms */
+
 	return transition;
 }
 
@@ -337,6 +428,7 @@ create_move_resize_view_transition(
 	data = malloc(sizeof(*data));
 	if (data == NULL) {
 		weston_log("%s: memory allocation fails\n", __func__);
+		layout_transition_destroy(transition);
 		return NULL;
 	}
 
@@ -348,7 +440,7 @@ create_move_resize_view_transition(
 	transition->private_data = data;
 
 	if (duration != 0)
-		transition->time_duration = duration;
+		transition_restart(transition, duration);
 
 	data->surface = surface;
 	data->start_x = start_x;
@@ -386,8 +478,7 @@ ivi_layout_transition_move_resize_view(struct ivi_layout_surface *surface,
 					surface);
 	if (transition) {
 		struct move_resize_view_data *data = transition->private_data;
-		transition->time_start = 0;
-		transition->time_duration = duration;
+		transition_restart(transition, duration);
 
 		data->start_x = start_pos[0];
 		data->start_y = start_pos[1];
@@ -401,7 +492,7 @@ ivi_layout_transition_move_resize_view(struct ivi_layout_surface *surface,
 		return;
 	}
 
-	transition = create_move_resize_view_transition(
+	create_move_resize_view_transition(
 		surface,
 		start_pos[0], start_pos[1],
 		dest_x, dest_y,
@@ -410,8 +501,6 @@ ivi_layout_transition_move_resize_view(struct ivi_layout_surface *surface,
 		transition_move_resize_view_user_frame,
 		transition_move_resize_view_destroy,
 		duration);
-
-	layout_transition_register(transition);
 }
 
 /* fade transition */
@@ -465,6 +554,7 @@ create_fade_view_transition(
 	data = malloc(sizeof(*data));
 	if (data == NULL) {
 		weston_log("%s: memory allocation fails\n", __func__);
+		layout_transition_destroy(transition);
 		return NULL;
 	}
 
@@ -477,7 +567,7 @@ create_fade_view_transition(
 	transition->destroy_func = destroy_func;
 
 	if (duration != 0)
-		transition->time_duration = duration;
+		transition_restart(transition, duration);
 
 	data->surface = surface;
 	data->start_alpha = start_alpha;
@@ -494,17 +584,13 @@ create_visibility_transition(struct ivi_layout_surface *surface,
 			     ivi_layout_transition_destroy_func destroy_func,
 			     uint32_t duration)
 {
-	struct ivi_layout_transition *transition = NULL;
-
-	transition = create_fade_view_transition(
+	create_fade_view_transition(
 		surface,
 		start_alpha, dest_alpha,
 		fade_view_user_frame,
 		user_data,
 		destroy_func,
 		duration);
-
-	layout_transition_register(transition);
 }
 
 static void
@@ -541,8 +627,7 @@ ivi_layout_transition_visibility_on(struct ivi_layout_surface *surface,
 		user_data = transition->user_data;
 		data = transition->private_data;
 
-		transition->time_start = 0;
-		transition->time_duration = duration;
+		transition_restart(transition, duration);
 		transition->destroy_func = visibility_on_transition_destroy;
 
 		data->start_alpha = wl_fixed_to_double(start_alpha);
@@ -602,8 +687,7 @@ ivi_layout_transition_visibility_off(struct ivi_layout_surface *surface,
 	if (transition) {
 		data = transition->private_data;
 
-		transition->time_start = 0;
-		transition->time_duration = duration;
+		transition_restart(transition, duration);
 		transition->destroy_func = visibility_off_transition_destroy;
 
 		data->start_alpha = wl_fixed_to_double(start_alpha);
@@ -694,6 +778,7 @@ create_move_layer_transition(
 	data = malloc(sizeof(*data));
 	if (data == NULL) {
 		weston_log("%s: memory allocation fails\n", __func__);
+		layout_transition_destroy(transition);
 		return NULL;
 	}
 
@@ -706,7 +791,7 @@ create_move_layer_transition(
 	transition->user_data = user_data;
 
 	if (duration != 0)
-		transition->time_duration = duration;
+		transition_restart(transition, duration);
 
 	data->layer = layer;
 	data->start_x = start_x;
@@ -725,19 +810,16 @@ ivi_layout_transition_move_layer(struct ivi_layout_layer *layer,
 {
 	int32_t start_pos_x = 0;
 	int32_t start_pos_y = 0;
-	struct ivi_layout_transition *transition = NULL;
 
 	ivi_layout_layer_get_position(layer, &start_pos_x, &start_pos_y);
 
-	transition = create_move_layer_transition(
+	create_move_layer_transition(
 		layer,
 		start_pos_x, start_pos_y,
 		dest_x, dest_y,
 		NULL, NULL,
 		duration);
 
-	layout_transition_register(transition);
-
 	return;
 }
 
@@ -780,7 +862,7 @@ transition_fade_layer_user_frame(struct ivi_layout_transition *transition)
 		(data->end_alpha - data->start_alpha) * current;
 	wl_fixed_t fixed_alpha = wl_fixed_from_double(alpha);
 
-	int32_t is_done = transition->is_done;
+	int32_t is_done = transition_is_done(transition);
 	bool is_visible = !is_done || data->is_fade_in;
 
 	ivi_layout_layer_set_opacity(data->layer, fixed_alpha);
@@ -826,9 +908,7 @@ ivi_layout_transition_fade_layer(
 		data->end_alpha = end_alpha;
 
 		remain = is_fade_in? 1.0 - now_opacity : now_opacity;
-		transition->time_start = 0;
-		transition->time_elapsed = 0;
-		transition->time_duration = duration * remain;
+		transition_restart(transition, duration * remain);
 
 		return;
 	}
@@ -840,6 +920,7 @@ ivi_layout_transition_fade_layer(
 	data = malloc(sizeof(*data));
 	if (data == NULL) {
 		weston_log("%s: memory allocation fails\n", __func__);
+		layout_transition_destroy(transition);
 		return;
 	}
 
@@ -853,7 +934,7 @@ ivi_layout_transition_fade_layer(
 	transition->destroy_func = transition_fade_layer_destroy;
 
 	if (duration != 0)
-		transition->time_duration = duration;
+		transition_restart(transition, duration);
 
 	data->layer = layer;
 	data->is_fade_in = is_fade_in;
@@ -861,8 +942,6 @@ ivi_layout_transition_fade_layer(
 	data->end_alpha = end_alpha;
 	data->destroy_func = destroy_func;
 
-	layout_transition_register(transition);
-
 	return;
 }
 
@@ -54,13 +54,17 @@
  */
 #include "config.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "compositor.h"
 #include "ivi-layout-export.h"
 #include "ivi-layout-private.h"
 
 #include "../shared/os-compatibility.h"
+#include "../shared/hash.h"
 
 struct link_layer {
 	struct ivi_layout_layer *ivilayer;
@@ -241,34 +245,83 @@ remove_orderlayer_from_screen(struct ivi_layout_layer *ivilayer)
 }
 
 /**
- * Internal API to add/remove a ivi_layer to/from ivi_screen.
+ * Internal API to look up ivi_surface/ivi_layer by ID. Both are indexed
+ * by ID in a hash table, maintained on creation and removal.
  */
 static struct ivi_layout_surface *
-get_surface(struct wl_list *surf_list, uint32_t id_surface)
+get_surface(struct ivi_layout *layout, uint32_t id_surface)
 {
-	struct ivi_layout_surface *ivisurf;
+	return hash_table_lookup(layout->surface_hash, id_surface);
+}
 
-	wl_list_for_each(ivisurf, surf_list, link) {
-		if (ivisurf->id_surface == id_surface) {
-			return ivisurf;
-		}
-	}
+static struct ivi_layout_layer *
+get_layer(struct ivi_layout *layout, uint32_t id_layer)
+{
+	return hash_table_lookup(layout->layer_hash, id_layer);
+}
 
-	return NULL;
+/**
+ * Internal API to queue ivi_surface/ivi_layer for the next commit. Every
+ * setter marks its object, so ivi_layout_commit_changes only visits what
+ * changed since the last commit.
+ */
+static void
+surface_mark_dirty(struct ivi_layout_surface *ivisurf)
+{
+	if (wl_list_empty(&ivisurf->dirty_link))
+		wl_list_insert(ivisurf->layout->dirty.surface_list.prev,
+			       &ivisurf->dirty_link);
 }
 
-static struct ivi_layout_layer *
-get_layer(struct wl_list *layer_list, uint32_t id_layer)
+static void
+layer_mark_dirty(struct ivi_layout_layer *ivilayer)
 {
-	struct ivi_layout_layer *ivilayer;
+	if (wl_list_empty(&ivilayer->dirty_link))
+		wl_list_insert(ivilayer->layout->dirty.layer_list.prev,
+			       &ivilayer->dirty_link);
+}
+
+/* The ivi_layers and ivi_surfaces of one commit while their
+ * notifications are sent. Entries are detached from the dirty lists
+ * before any listener runs, so changes made by a listener are queued for
+ * the next commit; entries of objects removed meanwhile are cleared.
+ */
+struct prop_notification {
+	struct wl_list link;		/* ivi_layout::commit_notification */
+	struct wl_array layers;		/* struct ivi_layout_layer_change */
+	struct wl_array surfaces;	/* struct ivi_layout_surface_change */
+};
 
-	wl_list_for_each(ivilayer, layer_list, link) {
-		if (ivilayer->id_layer == id_layer) {
-			return ivilayer;
+static void
+forget_notified_layer(struct ivi_layout *layout,
+		      struct ivi_layout_layer *ivilayer)
+{
+	struct prop_notification *notification;
+	struct ivi_layout_layer_change *change;
+
+	wl_list_for_each(notification,
+			 &layout->commit_notification.sending, link) {
+		wl_array_for_each(change, &notification->layers) {
+			if (change->ivilayer == ivilayer)
+				change->ivilayer = NULL;
 		}
 	}
+}
 
-	return NULL;
+static void
+forget_notified_surface(struct ivi_layout *layout,
+			struct ivi_layout_surface *ivisurf)
+{
+	struct prop_notification *notification;
+	struct ivi_layout_surface_change *change;
+
+	wl_list_for_each(notification,
+			 &layout->commit_notification.sending, link) {
+		wl_array_for_each(change, &notification->surfaces) {
+			if (change->ivisurf == ivisurf)
+				change->ivisurf = NULL;
+		}
+	}
 }
 
 static void
@@ -338,6 +391,10 @@ ivi_layout_surface_remove(struct ivi_layout_surface *ivisurf)
 	if (!wl_list_empty(&ivisurf->link)) {
 		wl_list_remove(&ivisurf->link);
 	}
+	wl_list_remove(&ivisurf->dirty_link);
+	forget_notified_surface(layout, ivisurf);
+	if (get_surface(layout, ivisurf->id_surface) == ivisurf)
+		hash_table_remove(layout->surface_hash, ivisurf->id_surface);
 	remove_ordersurface_from_layer(ivisurf);
 
 	wl_signal_emit(&layout->surface_notification.removed, ivisurf);
@@ -470,21 +527,32 @@ init_surface_properties(struct ivi_layout_surface_properties *prop)
  * Internal APIs to be called from ivi_layout_commit_changes.
  */
 static void
-update_opacity(struct ivi_layout_layer *ivilayer,
-	       struct ivi_layout_surface *ivisurf)
+set_view_opacity(struct ivi_layout_layer *ivilayer,
+		 struct ivi_layout_surface *ivisurf)
 {
 	double layer_alpha = wl_fixed_to_double(ivilayer->prop.opacity);
 	double surf_alpha  = wl_fixed_to_double(ivisurf->prop.opacity);
+	struct weston_view *tmpview = NULL;
+
+	/* The cache of an ivi_layer applies its opacity to the image. */
+	if (ivilayer->cache != NULL)
+		layer_alpha = 1.0;
 
+	wl_list_for_each(tmpview, &ivisurf->surface->views, surface_link) {
+		if (tmpview == NULL) {
+			continue;
+		}
+		tmpview->alpha = layer_alpha * surf_alpha;
+	}
+}
+
+static void
+update_opacity(struct ivi_layout_layer *ivilayer,
+	       struct ivi_layout_surface *ivisurf)
+{
 	if ((ivilayer->event_mask & IVI_NOTIFICATION_OPACITY) ||
 	    (ivisurf->event_mask  & IVI_NOTIFICATION_OPACITY)) {
-		struct weston_view *tmpview = NULL;
-		wl_list_for_each(tmpview, &ivisurf->surface->views, surface_link) {
-			if (tmpview == NULL) {
-				continue;
-			}
-			tmpview->alpha = layer_alpha * surf_alpha;
-		}
+		set_view_opacity(ivilayer, ivisurf);
 	}
 }
 
@@ -767,25 +835,155 @@ update_prop(struct ivi_layout_layer *ivilayer,
 			weston_view_geometry_dirty(tmpview);
 		}
 
-		if (ivisurf->surface != NULL) {
+		/* Damage would render the cache again; a change of the
+		 * ivi_layer alone only moves or fades the image. */
+		if (ivisurf->surface != NULL &&
+		    (ivilayer->cache == NULL || ivisurf->event_mask)) {
 			weston_surface_damage(ivisurf->surface);
 		}
 	}
 }
 
+/**
+ * Internal API to composite the cached image of an ivi_layer where the
+ * layer is, with its opacity.
+ */
+static void
+update_layer_cache(struct ivi_layout_layer *ivilayer)
+{
+	if (ivilayer->cache == NULL)
+		return;
+
+	weston_view_cache_set_position(ivilayer->cache,
+				       ivilayer->prop.dest_x,
+				       ivilayer->prop.dest_y);
+	weston_view_cache_set_alpha(ivilayer->cache,
+				    wl_fixed_to_double(ivilayer->prop.opacity));
+}
+
+/**
+ * Internal API to create or drop the cache of an ivi_layer as requested
+ * by ivi_layout_layer_set_cache().
+ */
+static void
+commit_layer_cache(struct ivi_layout_layer *ivilayer)
+{
+	struct ivi_layout *layout = ivilayer->layout;
+	struct ivi_layout_surface *ivisurf = NULL;
+
+	if (ivilayer->cache_enabled) {
+		ivilayer->cache = weston_view_cache_create(layout->compositor);
+		if (ivilayer->cache == NULL) {
+			weston_log("fails to create the cache of layer %u\n",
+				   ivilayer->id_layer);
+			ivilayer->cache_enabled = 0;
+			return;
+		}
+		update_layer_cache(ivilayer);
+	} else {
+		weston_view_cache_destroy(ivilayer->cache);
+		ivilayer->cache = NULL;
+	}
+
+	wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link)
+		set_view_opacity(ivilayer, ivisurf);
+
+	layout->dirty.order = 1;
+}
+
+/**
+ * Internal API to collect the outputs a commit has to repaint: those of
+ * the ivi_screens showing a changed ivi_layer, and those the views of a
+ * changed ivi_surface are on before and after the commit. Views are
+ * placed in global coordinates, so a change can move them to the output
+ * of another ivi_screen.
+ */
+static void
+screen_mark_output(struct ivi_layout *layout,
+		   struct ivi_layout_screen *iviscrn)
+{
+	if (iviscrn->output != NULL)
+		layout->dirty.output_mask |= 1u << iviscrn->output->id;
+}
+
+static void
+layer_mark_outputs(struct ivi_layout *layout,
+		   struct ivi_layout_layer *ivilayer)
+{
+	struct link_screen *link_scrn = NULL;
+
+	wl_list_for_each(link_scrn, &ivilayer->screen_list, link) {
+		screen_mark_output(layout, link_scrn->iviscrn);
+	}
+}
+
+static void
+surface_mark_outputs(struct ivi_layout *layout,
+		     struct ivi_layout_surface *ivisurf)
+{
+	struct weston_view *view = NULL;
+
+	if (ivisurf->surface == NULL)
+		return;
+
+	wl_list_for_each(view, &ivisurf->surface->views, surface_link) {
+		weston_view_update_transform(view);
+		layout->dirty.output_mask |= view->output_mask;
+	}
+}
+
 static void
 commit_changes(struct ivi_layout *layout)
 {
-	struct ivi_layout_screen  *iviscrn  = NULL;
 	struct ivi_layout_layer   *ivilayer = NULL;
 	struct ivi_layout_surface *ivisurf  = NULL;
+	struct link_layer *link = NULL;
 
-	wl_list_for_each(iviscrn, &layout->screen_list, link) {
-		wl_list_for_each(ivilayer, &iviscrn->order.layer_list, order.link) {
-			wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link) {
-				update_prop(ivilayer, ivisurf);
-			}
+	/* A changed ivi_layer affects all of its ivi_surfaces. */
+	wl_list_for_each(ivilayer, &layout->dirty.layer_list, dirty_link) {
+		if (wl_list_empty(&ivilayer->screen_list))
+			continue;
+
+		layer_mark_outputs(layout, ivilayer);
+		update_layer_cache(ivilayer);
+
+		wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link) {
+			surface_mark_outputs(layout, ivisurf);
+			update_prop(ivilayer, ivisurf);
+			surface_mark_outputs(layout, ivisurf);
+		}
+	}
+
+	/* A changed ivi_surface is updated in each ivi_layer on a screen
+	 * holding it, unless that was done above. */
+	wl_list_for_each(ivisurf, &layout->dirty.surface_list, dirty_link) {
+		surface_mark_outputs(layout, ivisurf);
+
+		wl_list_for_each(link, &ivisurf->layer_list, link) {
+			ivilayer = link->ivilayer;
+			if (wl_list_empty(&ivilayer->screen_list) ||
+			    !wl_list_empty(&ivilayer->dirty_link))
+				continue;
+
+			layer_mark_outputs(layout, ivilayer);
+			update_prop(ivilayer, ivisurf);
 		}
+
+		surface_mark_outputs(layout, ivisurf);
+	}
+}
+
+static void
+schedule_repaint(struct ivi_layout *layout)
+{
+	struct weston_output *output = NULL;
+	uint32_t output_mask = layout->dirty.output_mask;
+
+	layout->dirty.output_mask = 0;
+
+	wl_list_for_each(output, &layout->compositor->output_list, link) {
+		if (output_mask & (1u << output->id))
+			weston_output_schedule_repaint(output);
 	}
 }
 
@@ -799,7 +997,10 @@ commit_surface_list(struct ivi_layout *layout)
 	int32_t dest_height = 0;
 	int32_t configured = 0;
 
-	wl_list_for_each(ivisurf, &layout->surface_list, link) {
+	wl_list_for_each(ivisurf, &layout->dirty.surface_list, dirty_link) {
+		if (ivisurf->event_mask & IVI_NOTIFICATION_VISIBILITY)
+			layout->dirty.order = 1;
+
 		if(ivisurf->pending.prop.transition_type == IVI_LAYOUT_TRANSITION_VIEW_DEFAULT) {
 			dest_x = ivisurf->prop.dest_x;
 			dest_y = ivisurf->prop.dest_y;
@@ -892,7 +1093,7 @@ commit_layer_list(struct ivi_layout *layout)
 	struct ivi_layout_surface *ivisurf  = NULL;
 	struct ivi_layout_surface *next     = NULL;
 
-	wl_list_for_each(ivilayer, &layout->layer_list, link) {
+	wl_list_for_each(ivilayer, &layout->dirty.layer_list, dirty_link) {
 		if(ivilayer->pending.prop.transition_type == IVI_LAYOUT_TRANSITION_LAYER_MOVE) {
 			ivi_layout_transition_move_layer(ivilayer, ivilayer->pending.prop.dest_x, ivilayer->pending.prop.dest_y, ivilayer->pending.prop.transition_duration);
 		} else if(ivilayer->pending.prop.transition_type == IVI_LAYOUT_TRANSITION_LAYER_FADE) {
@@ -905,11 +1106,19 @@ commit_layer_list(struct ivi_layout *layout)
 
 		ivilayer->prop = ivilayer->pending.prop;
 
+		if (ivilayer->cache_enabled != (ivilayer->cache != NULL))
+			commit_layer_cache(ivilayer);
+
+		if (ivilayer->event_mask & IVI_NOTIFICATION_VISIBILITY)
+			layout->dirty.order = 1;
+
 		if (!(ivilayer->event_mask &
 		      (IVI_NOTIFICATION_ADD | IVI_NOTIFICATION_REMOVE)) ) {
 			continue;
 		}
 
+		layout->dirty.order = 1;
+
 		if (ivilayer->event_mask & IVI_NOTIFICATION_REMOVE) {
 			wl_list_for_each_safe(ivisurf, next,
 				&ivilayer->order.surface_list, order.link) {
@@ -921,6 +1130,7 @@ commit_layer_list(struct ivi_layout *layout)
 
 				wl_list_init(&ivisurf->order.link);
 				ivisurf->event_mask |= IVI_NOTIFICATION_REMOVE;
+				surface_mark_dirty(ivisurf);
 			}
 
 			wl_list_init(&ivilayer->order.surface_list);
@@ -950,11 +1160,26 @@ commit_layer_list(struct ivi_layout *layout)
 					       &ivisurf->order.link);
 				add_ordersurface_to_layer(ivisurf, ivilayer);
 				ivisurf->event_mask |= IVI_NOTIFICATION_ADD;
+				surface_mark_dirty(ivisurf);
 			}
 		}
 	}
 }
 
+static void
+add_cache_view(struct ivi_layout *layout, struct weston_view *view)
+{
+	struct weston_view **entry;
+
+	entry = wl_array_add(&layout->cache_views, sizeof *entry);
+	if (entry == NULL) {
+		weston_log("fails to allocate memory\n");
+		return;
+	}
+
+	*entry = view;
+}
+
 static void
 commit_screen_list(struct ivi_layout *layout)
 {
@@ -964,6 +1189,11 @@ commit_screen_list(struct ivi_layout *layout)
 	struct ivi_layout_surface *ivisurf  = NULL;
 
 	wl_list_for_each(iviscrn, &layout->screen_list, link) {
+		if (iviscrn->event_mask) {
+			layout->dirty.order = 1;
+			screen_mark_output(layout, iviscrn);
+		}
+
 		if (iviscrn->event_mask & IVI_NOTIFICATION_REMOVE) {
 			wl_list_for_each_safe(ivilayer, next,
 					      &iviscrn->order.layer_list, order.link) {
@@ -975,6 +1205,7 @@ commit_screen_list(struct ivi_layout *layout)
 
 				wl_list_init(&ivilayer->order.link);
 				ivilayer->event_mask |= IVI_NOTIFICATION_REMOVE;
+				layer_mark_dirty(ivilayer);
 			}
 		}
 
@@ -997,11 +1228,27 @@ commit_screen_list(struct ivi_layout *layout)
 					       &ivilayer->order.link);
 				add_orderlayer_to_screen(ivilayer, iviscrn);
 				ivilayer->event_mask |= IVI_NOTIFICATION_ADD;
+				layer_mark_dirty(ivilayer);
 			}
 		}
 
 		iviscrn->event_mask = 0;
+	}
+
+	/* The view list only depends on render order and visibility. */
+	if (!layout->dirty.order)
+		return;
+	layout->dirty.order = 0;
 
+	/* Hidden ivi_layers give their views back to the renderer. */
+	wl_list_for_each(ivilayer, &layout->layer_list, link) {
+		if (ivilayer->cache != NULL &&
+		    (ivilayer->prop.visibility == false ||
+		     wl_list_empty(&ivilayer->screen_list)))
+			weston_view_cache_set_views(ivilayer->cache, NULL, 0);
+	}
+
+	wl_list_for_each(iviscrn, &layout->screen_list, link) {
 		/* Clear view list of layout ivi_layer */
 		wl_list_init(&layout->layout_layer.view_list.link);
 
@@ -1009,6 +1256,8 @@ commit_screen_list(struct ivi_layout *layout)
 			if (ivilayer->prop.visibility == false)
 				continue;
 
+			layout->cache_views.size = 0;
+
 			wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link) {
 				struct weston_view *tmpview = NULL;
 				wl_list_for_each(tmpview, &ivisurf->surface->views, surface_link) {
@@ -1026,6 +1275,19 @@ commit_screen_list(struct ivi_layout *layout)
 							  &tmpview->layer_link);
 
 				ivisurf->surface->output = iviscrn->output;
+
+				if (ivilayer->cache != NULL)
+					add_cache_view(layout, tmpview);
+			}
+
+			/* The image goes right above its views. */
+			if (ivilayer->cache != NULL) {
+				weston_view_cache_set_views(ivilayer->cache,
+					layout->cache_views.data,
+					layout->cache_views.size /
+					sizeof(struct weston_view *));
+				weston_layer_entry_insert(&layout->layout_layer.view_list,
+							  &ivilayer->cache->view->layer_link);
 			}
 		}
 
@@ -1036,45 +1298,132 @@ commit_screen_list(struct ivi_layout *layout)
 static void
 commit_transition(struct ivi_layout* layout)
 {
-	if(wl_list_empty(&layout->pending_transition_list)){
+	struct ivi_layout_transition_set *transitions = layout->transitions;
+
+	if (transitions->active_count == transitions->count) {
 		return;
 	}
 
-	wl_list_insert_list(&layout->transitions->transition_list,
-			    &layout->pending_transition_list);
+	transitions->active_count = transitions->count;
 
-	wl_list_init(&layout->pending_transition_list);
-
-	wl_event_source_timer_update(layout->transitions->event_source, 1);
+	wl_event_source_timer_update(transitions->event_source, 1);
 }
 
+/* Unqueues every changed ivi_layer and ivi_surface into notification,
+ * taking their event masks with them. */
 static void
-send_surface_prop(struct ivi_layout_surface *ivisurf)
+detach_dirty(struct ivi_layout *layout,
+	     struct prop_notification *notification)
 {
-	wl_signal_emit(&ivisurf->property_changed, ivisurf);
-	ivisurf->event_mask = 0;
+	struct ivi_layout_layer   *ivilayer = NULL;
+	struct ivi_layout_surface *ivisurf  = NULL;
+	struct ivi_layout_layer_change *layer_change = NULL;
+	struct ivi_layout_surface_change *surface_change = NULL;
+
+	while (!wl_list_empty(&layout->dirty.layer_list)) {
+		ivilayer = container_of(layout->dirty.layer_list.next,
+					struct ivi_layout_layer, dirty_link);
+		wl_list_remove(&ivilayer->dirty_link);
+		wl_list_init(&ivilayer->dirty_link);
+
+		layer_change = wl_array_add(&notification->layers,
+					    sizeof *layer_change);
+		if (layer_change == NULL) {
+			weston_log("fails to allocate memory\n");
+		} else {
+			layer_change->ivilayer = ivilayer;
+			layer_change->mask = ivilayer->event_mask;
+		}
+		ivilayer->event_mask = 0;
+	}
+
+	while (!wl_list_empty(&layout->dirty.surface_list)) {
+		ivisurf = container_of(layout->dirty.surface_list.next,
+				       struct ivi_layout_surface, dirty_link);
+		wl_list_remove(&ivisurf->dirty_link);
+		wl_list_init(&ivisurf->dirty_link);
+
+		surface_change = wl_array_add(&notification->surfaces,
+					      sizeof *surface_change);
+		if (surface_change == NULL) {
+			weston_log("fails to allocate memory\n");
+		} else {
+			surface_change->ivisurf = ivisurf;
+			surface_change->mask = ivisurf->event_mask;
+		}
+		ivisurf->event_mask = 0;
+	}
 }
 
+/* Emits one summary of the changed ivi_layers and ivi_surfaces. */
 static void
-send_layer_prop(struct ivi_layout_layer *ivilayer)
+send_commit_summary(struct ivi_layout *layout,
+		    struct prop_notification *notification)
 {
-	wl_signal_emit(&ivilayer->property_changed, ivilayer);
-	ivilayer->event_mask = 0;
+	struct ivi_layout_commit_summary summary;
+
+	summary.layers = notification->layers.data;
+	summary.layer_count = notification->layers.size /
+			      sizeof(struct ivi_layout_layer_change);
+	summary.surfaces = notification->surfaces.data;
+	summary.surface_count = notification->surfaces.size /
+				sizeof(struct ivi_layout_surface_change);
+
+	if (summary.layer_count > 0 || summary.surface_count > 0)
+		wl_signal_emit(&layout->commit_notification.committed,
+			       &summary);
 }
 
+/* Notifies every changed ivi_layer and ivi_surface. The entry arrays are
+ * reused across commits; they are taken over while listeners run, so
+ * that a commit made from a listener sends its own notifications. */
 static void
 send_prop(struct ivi_layout *layout)
 {
-	struct ivi_layout_layer   *ivilayer = NULL;
-	struct ivi_layout_surface *ivisurf  = NULL;
+	struct prop_notification notification;
+	struct ivi_layout_layer_change *layer_change = NULL;
+	struct ivi_layout_surface_change *surface_change = NULL;
+
+	notification.layers = layout->commit_notification.layers;
+	wl_array_init(&layout->commit_notification.layers);
+	notification.layers.size = 0;
+
+	notification.surfaces = layout->commit_notification.surfaces;
+	wl_array_init(&layout->commit_notification.surfaces);
+	notification.surfaces.size = 0;
+
+	detach_dirty(layout, &notification);
+
+	if (layout->commit_notification.transition_frame &&
+	    layout->commit_notification.suppress_transition_frames)
+		goto out;
+
+	wl_list_insert(&layout->commit_notification.sending,
+		       &notification.link);
 
-	wl_list_for_each_reverse(ivilayer, &layout->layer_list, link) {
-		send_layer_prop(ivilayer);
+	if (!wl_list_empty(&layout->commit_notification.committed.listener_list))
+		send_commit_summary(layout, &notification);
+
+	wl_array_for_each(layer_change, &notification.layers) {
+		if (layer_change->ivilayer != NULL)
+			wl_signal_emit(&layer_change->ivilayer->property_changed,
+				       layer_change);
 	}
 
-	wl_list_for_each_reverse(ivisurf, &layout->surface_list, link) {
-		send_surface_prop(ivisurf);
+	wl_array_for_each(surface_change, &notification.surfaces) {
+		if (surface_change->ivisurf != NULL)
+			wl_signal_emit(&surface_change->ivisurf->property_changed,
+				       surface_change);
 	}
+
+	wl_list_remove(&notification.link);
+
+out:
+	wl_array_release(&layout->commit_notification.layers);
+	layout->commit_notification.layers = notification.layers;
+
+	wl_array_release(&layout->commit_notification.surfaces);
+	layout->commit_notification.surfaces = notification.surfaces;
 }
 
 static void
@@ -1150,7 +1499,8 @@ layer_removed(struct wl_listener *listener, void *data)
 static void
 layer_prop_changed(struct wl_listener *listener, void *data)
 {
-	struct ivi_layout_layer *ivilayer = data;
+	struct ivi_layout_layer_change *change = data;
+	struct ivi_layout_layer *ivilayer = change->ivilayer;
 
 	struct listener_layout_notification *layout_listener =
 		container_of(listener,
@@ -1161,7 +1511,7 @@ layer_prop_changed(struct wl_listener *listener, void *data)
 		layout_listener->userdata;
 
 	((layer_property_notification_func)prop_callback->callback)
-		(ivilayer, &ivilayer->prop, ivilayer->event_mask, prop_callback->data);
+		(ivilayer, &ivilayer->prop, change->mask, prop_callback->data);
 }
 
 static void
@@ -1201,7 +1551,8 @@ surface_removed(struct wl_listener *listener, void *data)
 static void
 surface_prop_changed(struct wl_listener *listener, void *data)
 {
-	struct ivi_layout_surface *ivisurf = data;
+	struct ivi_layout_surface_change *change = data;
+	struct ivi_layout_surface *ivisurf = change->ivisurf;
 
 	struct listener_layout_notification *layout_listener =
 		container_of(listener,
@@ -1212,9 +1563,7 @@ surface_prop_changed(struct wl_listener *listener, void *data)
 		layout_listener->userdata;
 
 	((surface_property_notification_func)prop_callback->callback)
-		(ivisurf, &ivisurf->prop, ivisurf->event_mask, prop_callback->data);
-
-	ivisurf->event_mask = 0;
+		(ivisurf, &ivisurf->prop, change->mask, prop_callback->data);
 }
 
 static void
@@ -1235,6 +1584,23 @@ surface_configure_changed(struct wl_listener *listener,
 		(ivisurface, configure_changed_callback->data);
 }
 
+static void
+commit_notified(struct wl_listener *listener, void *data)
+{
+	const struct ivi_layout_commit_summary *summary = data;
+
+	struct listener_layout_notification *notification =
+		container_of(listener,
+			     struct listener_layout_notification,
+			     listener);
+
+	struct ivi_layout_notification_callback *commit_callback =
+		notification->userdata;
+
+	((commit_notification_func)commit_callback->callback)
+		(summary, commit_callback->data);
+}
+
 static int32_t
 add_notification(struct wl_signal *signal,
 		 wl_notify_func_t callback,
@@ -1473,31 +1839,13 @@ ivi_layout_get_id_of_layer(struct ivi_layout_layer *ivilayer)
 static struct ivi_layout_layer *
 ivi_layout_get_layer_from_id(uint32_t id_layer)
 {
-	struct ivi_layout *layout = get_instance();
-	struct ivi_layout_layer *ivilayer = NULL;
-
-	wl_list_for_each(ivilayer, &layout->layer_list, link) {
-		if (ivilayer->id_layer == id_layer) {
-			return ivilayer;
-		}
-	}
-
-	return NULL;
+	return get_layer(get_instance(), id_layer);
 }
 
 struct ivi_layout_surface *
 ivi_layout_get_surface_from_id(uint32_t id_surface)
 {
-	struct ivi_layout *layout = get_instance();
-	struct ivi_layout_surface *ivisurf = NULL;
-
-	wl_list_for_each(ivisurf, &layout->surface_list, link) {
-		if (ivisurf->id_surface == id_surface) {
-			return ivisurf;
-		}
-	}
-
-	return NULL;
+	return get_surface(get_instance(), id_surface);
 }
 
 static struct ivi_layout_screen *
@@ -1704,7 +2052,7 @@ ivi_layout_get_layers_on_screen(struct ivi_layout_screen *iviscrn,
 			return IVI_FAILED;
 		}
 
-		wl_list_for_each(ivilayer, &iviscrn->order.layer_list, link) {
+		wl_list_for_each(ivilayer, &iviscrn->order.layer_list, order.link) {
 			(*ppArray)[n++] = ivilayer;
 		}
 	}
@@ -1816,71 +2164,333 @@ ivi_layout_get_surfaces_on_layer(struct ivi_layout_layer *ivilayer,
 	return IVI_SUCCEEDED;
 }
 
-static struct ivi_layout_layer *
-ivi_layout_layer_create_with_dimension(uint32_t id_layer,
-				       int32_t width, int32_t height)
+static int32_t
+ivi_layout_add_notification_commit(commit_notification_func callback,
+				   void *userdata)
 {
 	struct ivi_layout *layout = get_instance();
-	struct ivi_layout_layer *ivilayer = NULL;
+	struct ivi_layout_notification_callback *commit_callback = NULL;
 
-	ivilayer = get_layer(&layout->layer_list, id_layer);
-	if (ivilayer != NULL) {
-		weston_log("id_layer is already created\n");
-		return ivilayer;
+	if (callback == NULL) {
+		weston_log("ivi_layout_add_notification_commit: invalid argument\n");
+		return IVI_FAILED;
 	}
 
-	ivilayer = calloc(1, sizeof *ivilayer);
-	if (ivilayer == NULL) {
+	commit_callback = malloc(sizeof *commit_callback);
+	if (commit_callback == NULL) {
 		weston_log("fails to allocate memory\n");
-		return NULL;
+		return IVI_FAILED;
 	}
 
-	wl_list_init(&ivilayer->link);
-	wl_signal_init(&ivilayer->property_changed);
-	wl_list_init(&ivilayer->screen_list);
-	wl_list_init(&ivilayer->link_to_surface);
-	ivilayer->layout = layout;
-	ivilayer->id_layer = id_layer;
-
-	init_layer_properties(&ivilayer->prop, width, height);
-	ivilayer->event_mask = 0;
-
-	wl_list_init(&ivilayer->pending.surface_list);
-	wl_list_init(&ivilayer->pending.link);
-	ivilayer->pending.prop = ivilayer->prop;
-
-	wl_list_init(&ivilayer->order.surface_list);
-	wl_list_init(&ivilayer->order.link);
-
-	wl_list_insert(&layout->layer_list, &ivilayer->link);
+	commit_callback->callback = callback;
+	commit_callback->data = userdata;
 
-	wl_signal_emit(&layout->layer_notification.created, ivilayer);
+	return add_notification(&layout->commit_notification.committed,
+				commit_notified,
+				commit_callback);
+}
 
-	return ivilayer;
+static void
+ivi_layout_remove_notification_commit(commit_notification_func callback,
+				      void *userdata)
+{
+	struct ivi_layout *layout = get_instance();
+	remove_notification(&layout->commit_notification.committed.listener_list,
+			    callback, userdata);
 }
 
 static void
-ivi_layout_layer_remove_notification(struct ivi_layout_layer *ivilayer)
+ivi_layout_set_transition_frame_notification(bool enabled)
 {
-	if (ivilayer == NULL) {
-		weston_log("ivi_layout_layer_remove_notification: invalid argument\n");
-		return;
-	}
+	struct ivi_layout *layout = get_instance();
 
-	remove_all_notification(&ivilayer->property_changed.listener_list);
+	layout->commit_notification.suppress_transition_frames = !enabled;
 }
 
-static void
-ivi_layout_layer_remove(struct ivi_layout_layer *ivilayer)
+static int32_t
+ivi_layout_layer_set_cache(struct ivi_layout_layer *ivilayer, bool enabled)
 {
 	struct ivi_layout *layout = get_instance();
 
 	if (ivilayer == NULL) {
-		weston_log("ivi_layout_layer_remove: invalid argument\n");
-		return;
+		weston_log("ivi_layout_layer_set_cache: invalid argument\n");
+		return IVI_FAILED;
 	}
 
-	wl_signal_emit(&layout->layer_notification.removed, ivilayer);
+	if (enabled && !layout->compositor->renderer->view_cache_render) {
+		weston_log("ivi_layout_layer_set_cache: not supported by the renderer\n");
+		return IVI_FAILED;
+	}
+
+	ivilayer->cache_enabled = enabled;
+	layer_mark_dirty(ivilayer);
+
+	return IVI_SUCCEEDED;
+}
+
+static int32_t
+ivi_layout_layer_get_cache_stats(struct ivi_layout_layer *ivilayer,
+				 struct ivi_layout_layer_cache_stats *stats)
+{
+	if (ivilayer == NULL || stats == NULL) {
+		weston_log("ivi_layout_layer_get_cache_stats: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	memset(stats, 0, sizeof *stats);
+	if (ivilayer->cache != NULL) {
+		stats->hits = ivilayer->cache->hits;
+		stats->misses = ivilayer->cache->misses;
+		stats->bytes = ivilayer->cache->bytes;
+	}
+
+	return IVI_SUCCEEDED;
+}
+
+static int32_t
+ivi_layout_for_each_surface(ivi_layout_surface_visitor_func visitor,
+			    void *userdata)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_surface *ivisurf = NULL;
+	struct ivi_layout_surface *next = NULL;
+
+	if (visitor == NULL) {
+		weston_log("ivi_layout_for_each_surface: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each_safe(ivisurf, next, &layout->surface_list, link) {
+		if (visitor(ivisurf, userdata))
+			break;
+	}
+
+	return IVI_SUCCEEDED;
+}
+
+static int32_t
+ivi_layout_for_each_surface_on_layer(struct ivi_layout_layer *ivilayer,
+				     ivi_layout_surface_visitor_func visitor,
+				     void *userdata)
+{
+	struct ivi_layout_surface *ivisurf = NULL;
+	struct ivi_layout_surface *next = NULL;
+
+	if (ivilayer == NULL || visitor == NULL) {
+		weston_log("ivi_layout_for_each_surface_on_layer: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each_safe(ivisurf, next,
+			      &ivilayer->order.surface_list, order.link) {
+		if (visitor(ivisurf, userdata))
+			break;
+	}
+
+	return IVI_SUCCEEDED;
+}
+
+static int32_t
+ivi_layout_for_each_layer(ivi_layout_layer_visitor_func visitor,
+			  void *userdata)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_layer *ivilayer = NULL;
+	struct ivi_layout_layer *next = NULL;
+
+	if (visitor == NULL) {
+		weston_log("ivi_layout_for_each_layer: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each_safe(ivilayer, next, &layout->layer_list, link) {
+		if (visitor(ivilayer, userdata))
+			break;
+	}
+
+	return IVI_SUCCEEDED;
+}
+
+static int32_t
+ivi_layout_for_each_layer_on_screen(struct ivi_layout_screen *iviscrn,
+				    ivi_layout_layer_visitor_func visitor,
+				    void *userdata)
+{
+	struct ivi_layout_layer *ivilayer = NULL;
+	struct ivi_layout_layer *next = NULL;
+
+	if (iviscrn == NULL || visitor == NULL) {
+		weston_log("ivi_layout_for_each_layer_on_screen: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each_safe(ivilayer, next,
+			      &iviscrn->order.layer_list, order.link) {
+		if (visitor(ivilayer, userdata))
+			break;
+	}
+
+	return IVI_SUCCEEDED;
+}
+
+static int32_t
+ivi_layout_get_surfaces_into(struct ivi_layout_surface **array, int32_t size)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_surface *ivisurf = NULL;
+	int32_t n = 0;
+
+	if (size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_surfaces_into: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each(ivisurf, &layout->surface_list, link) {
+		if (n < size)
+			array[n] = ivisurf;
+		n++;
+	}
+
+	return n;
+}
+
+static int32_t
+ivi_layout_get_surfaces_on_layer_into(struct ivi_layout_layer *ivilayer,
+				      struct ivi_layout_surface **array,
+				      int32_t size)
+{
+	struct ivi_layout_surface *ivisurf = NULL;
+	int32_t n = 0;
+
+	if (ivilayer == NULL || size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_surfaces_on_layer_into: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each(ivisurf, &ivilayer->order.surface_list, order.link) {
+		if (n < size)
+			array[n] = ivisurf;
+		n++;
+	}
+
+	return n;
+}
+
+static int32_t
+ivi_layout_get_layers_into(struct ivi_layout_layer **array, int32_t size)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_layer *ivilayer = NULL;
+	int32_t n = 0;
+
+	if (size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_layers_into: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each(ivilayer, &layout->layer_list, link) {
+		if (n < size)
+			array[n] = ivilayer;
+		n++;
+	}
+
+	return n;
+}
+
+static int32_t
+ivi_layout_get_layers_on_screen_into(struct ivi_layout_screen *iviscrn,
+				     struct ivi_layout_layer **array,
+				     int32_t size)
+{
+	struct ivi_layout_layer *ivilayer = NULL;
+	int32_t n = 0;
+
+	if (iviscrn == NULL || size < 0 || (array == NULL && size > 0)) {
+		weston_log("ivi_layout_get_layers_on_screen_into: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	wl_list_for_each(ivilayer, &iviscrn->order.layer_list, order.link) {
+		if (n < size)
+			array[n] = ivilayer;
+		n++;
+	}
+
+	return n;
+}
+
+static struct ivi_layout_layer *
+ivi_layout_layer_create_with_dimension(uint32_t id_layer,
+				       int32_t width, int32_t height)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_layer *ivilayer = NULL;
+
+	ivilayer = get_layer(layout, id_layer);
+	if (ivilayer != NULL) {
+		weston_log("id_layer is already created\n");
+		return ivilayer;
+	}
+
+	ivilayer = calloc(1, sizeof *ivilayer);
+	if (ivilayer == NULL) {
+		weston_log("fails to allocate memory\n");
+		return NULL;
+	}
+
+	wl_list_init(&ivilayer->link);
+	wl_signal_init(&ivilayer->property_changed);
+	wl_list_init(&ivilayer->screen_list);
+	wl_list_init(&ivilayer->link_to_surface);
+	ivilayer->layout = layout;
+	ivilayer->id_layer = id_layer;
+
+	init_layer_properties(&ivilayer->prop, width, height);
+	ivilayer->event_mask = 0;
+
+	wl_list_init(&ivilayer->pending.surface_list);
+	wl_list_init(&ivilayer->pending.link);
+	ivilayer->pending.prop = ivilayer->prop;
+
+	wl_list_init(&ivilayer->order.surface_list);
+	wl_list_init(&ivilayer->order.link);
+	wl_list_init(&ivilayer->dirty_link);
+
+	if (hash_table_insert(layout->layer_hash, id_layer, ivilayer) < 0) {
+		weston_log("fails to allocate memory\n");
+		free(ivilayer);
+		return NULL;
+	}
+
+	wl_list_insert(&layout->layer_list, &ivilayer->link);
+
+	wl_signal_emit(&layout->layer_notification.created, ivilayer);
+
+	return ivilayer;
+}
+
+static void
+ivi_layout_layer_remove_notification(struct ivi_layout_layer *ivilayer)
+{
+	if (ivilayer == NULL) {
+		weston_log("ivi_layout_layer_remove_notification: invalid argument\n");
+		return;
+	}
+
+	remove_all_notification(&ivilayer->property_changed.listener_list);
+}
+
+static void
+ivi_layout_layer_remove(struct ivi_layout_layer *ivilayer)
+{
+	struct ivi_layout *layout = get_instance();
+
+	if (ivilayer == NULL) {
+		weston_log("ivi_layout_layer_remove: invalid argument\n");
+		return;
+	}
+
+	wl_signal_emit(&layout->layer_notification.removed, ivilayer);
 
 	clear_surface_pending_list(ivilayer);
 	clear_surface_order_list(ivilayer);
@@ -1894,6 +2504,13 @@ ivi_layout_layer_remove(struct ivi_layout_layer *ivilayer)
 	if (!wl_list_empty(&ivilayer->link)) {
 		wl_list_remove(&ivilayer->link);
 	}
+	wl_list_remove(&ivilayer->dirty_link);
+	forget_notified_layer(layout, ivilayer);
+	hash_table_remove(layout->layer_hash, ivilayer->id_layer);
+	layout->dirty.order = 1;
+	layer_mark_outputs(layout, ivilayer);
+	if (ivilayer->cache != NULL)
+		weston_view_cache_destroy(ivilayer->cache);
 	remove_orderlayer_from_screen(ivilayer);
 	remove_link_to_surface(ivilayer);
 	ivi_layout_layer_remove_notification(ivilayer);
@@ -1916,6 +2533,7 @@ ivi_layout_layer_set_visibility(struct ivi_layout_layer *ivilayer,
 	prop->visibility = newVisibility;
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_VISIBILITY;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -1946,6 +2564,7 @@ ivi_layout_layer_set_opacity(struct ivi_layout_layer *ivilayer,
 	prop->opacity = opacity;
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_OPACITY;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -1980,6 +2599,7 @@ ivi_layout_layer_set_source_rectangle(struct ivi_layout_layer *ivilayer,
 	prop->source_height = height;
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_SOURCE_RECT;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -2003,6 +2623,7 @@ ivi_layout_layer_set_destination_rectangle(struct ivi_layout_layer *ivilayer,
 	prop->dest_height = height;
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_DEST_RECT;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -2039,6 +2660,7 @@ ivi_layout_layer_set_dimension(struct ivi_layout_layer *ivilayer,
 	prop->dest_height = dest_height;
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_DIMENSION;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -2074,6 +2696,7 @@ ivi_layout_layer_set_position(struct ivi_layout_layer *ivilayer,
 	prop->dest_y = dest_y;
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_POSITION;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -2093,6 +2716,7 @@ ivi_layout_layer_set_orientation(struct ivi_layout_layer *ivilayer,
 	prop->orientation = orientation;
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_ORIENTATION;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -2116,7 +2740,6 @@ ivi_layout_layer_set_render_order(struct ivi_layout_layer *ivilayer,
 	struct ivi_layout *layout = get_instance();
 	struct ivi_layout_surface *ivisurf = NULL;
 	struct ivi_layout_surface *next = NULL;
-	uint32_t *id_surface = NULL;
 	int32_t i = 0;
 
 	if (ivilayer == NULL) {
@@ -2133,28 +2756,25 @@ ivi_layout_layer_set_render_order(struct ivi_layout_layer *ivilayer,
 			wl_list_init(&ivisurf->pending.link);
 		}
 		ivilayer->event_mask |= IVI_NOTIFICATION_REMOVE;
+		layer_mark_dirty(ivilayer);
 		return IVI_SUCCEEDED;
 	}
 
 	for (i = 0; i < number; i++) {
-		id_surface = &pSurface[i]->id_surface;
-
-		wl_list_for_each_safe(ivisurf, next, &layout->surface_list, link) {
-			if (*id_surface != ivisurf->id_surface) {
-				continue;
-			}
+		ivisurf = get_surface(layout, pSurface[i]->id_surface);
+		if (ivisurf == NULL)
+			continue;
 
-			if (!wl_list_empty(&ivisurf->pending.link)) {
-				wl_list_remove(&ivisurf->pending.link);
-			}
-			wl_list_init(&ivisurf->pending.link);
-			wl_list_insert(&ivilayer->pending.surface_list,
-				       &ivisurf->pending.link);
-			break;
+		if (!wl_list_empty(&ivisurf->pending.link)) {
+			wl_list_remove(&ivisurf->pending.link);
 		}
+		wl_list_init(&ivisurf->pending.link);
+		wl_list_insert(&ivilayer->pending.surface_list,
+			       &ivisurf->pending.link);
 	}
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_ADD;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -2174,6 +2794,7 @@ ivi_layout_surface_set_visibility(struct ivi_layout_surface *ivisurf,
 	prop->visibility = newVisibility;
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_VISIBILITY;
+	surface_mark_dirty(ivisurf);
 
 	return IVI_SUCCEEDED;
 }
@@ -2204,6 +2825,7 @@ ivi_layout_surface_set_opacity(struct ivi_layout_surface *ivisurf,
 	prop->opacity = opacity;
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_OPACITY;
+	surface_mark_dirty(ivisurf);
 
 	return IVI_SUCCEEDED;
 }
@@ -2242,6 +2864,7 @@ ivi_layout_surface_set_destination_rectangle(struct ivi_layout_surface *ivisurf,
 	prop->dest_height = height;
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_DEST_RECT;
+	surface_mark_dirty(ivisurf);
 
 	return IVI_SUCCEEDED;
 }
@@ -2262,6 +2885,7 @@ ivi_layout_surface_set_dimension(struct ivi_layout_surface *ivisurf,
 	prop->dest_height = dest_height;
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_DIMENSION;
+	surface_mark_dirty(ivisurf);
 
 	return IVI_SUCCEEDED;
 }
@@ -2297,6 +2921,7 @@ ivi_layout_surface_set_position(struct ivi_layout_surface *ivisurf,
 	prop->dest_y = dest_y;
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_POSITION;
+	surface_mark_dirty(ivisurf);
 
 	return IVI_SUCCEEDED;
 }
@@ -2331,6 +2956,7 @@ ivi_layout_surface_set_orientation(struct ivi_layout_surface *ivisurf,
 	prop->orientation = orientation;
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_ORIENTATION;
+	surface_mark_dirty(ivisurf);
 
 	return IVI_SUCCEEDED;
 }
@@ -2352,7 +2978,6 @@ ivi_layout_screen_add_layer(struct ivi_layout_screen *iviscrn,
 {
 	struct ivi_layout *layout = get_instance();
 	struct ivi_layout_layer *ivilayer = NULL;
-	struct ivi_layout_layer *next = NULL;
 	int is_layer_in_scrn = 0;
 
 	if (iviscrn == NULL || addlayer == NULL) {
@@ -2366,16 +2991,14 @@ ivi_layout_screen_add_layer(struct ivi_layout_screen *iviscrn,
 		return IVI_SUCCEEDED;
 	}
 
-	wl_list_for_each_safe(ivilayer, next, &layout->layer_list, link) {
-		if (ivilayer->id_layer == addlayer->id_layer) {
-			if (!wl_list_empty(&ivilayer->pending.link)) {
-				wl_list_remove(&ivilayer->pending.link);
-			}
-			wl_list_init(&ivilayer->pending.link);
-			wl_list_insert(&iviscrn->pending.layer_list,
-				       &ivilayer->pending.link);
-			break;
+	ivilayer = get_layer(layout, addlayer->id_layer);
+	if (ivilayer != NULL) {
+		if (!wl_list_empty(&ivilayer->pending.link)) {
+			wl_list_remove(&ivilayer->pending.link);
 		}
+		wl_list_init(&ivilayer->pending.link);
+		wl_list_insert(&iviscrn->pending.layer_list,
+			       &ivilayer->pending.link);
 	}
 
 	iviscrn->event_mask |= IVI_NOTIFICATION_ADD;
@@ -2391,7 +3014,6 @@ ivi_layout_screen_set_render_order(struct ivi_layout_screen *iviscrn,
 	struct ivi_layout *layout = get_instance();
 	struct ivi_layout_layer *ivilayer = NULL;
 	struct ivi_layout_layer *next = NULL;
-	uint32_t *id_layer = NULL;
 	int32_t i = 0;
 
 	if (iviscrn == NULL) {
@@ -2420,20 +3042,16 @@ ivi_layout_screen_set_render_order(struct ivi_layout_screen *iviscrn,
 	}
 
 	for (i = 0; i < number; i++) {
-		id_layer = &pLayer[i]->id_layer;
-		wl_list_for_each(ivilayer, &layout->layer_list, link) {
-			if (*id_layer != ivilayer->id_layer) {
-				continue;
-			}
+		ivilayer = get_layer(layout, pLayer[i]->id_layer);
+		if (ivilayer == NULL)
+			continue;
 
-			if (!wl_list_empty(&ivilayer->pending.link)) {
-				wl_list_remove(&ivilayer->pending.link);
-			}
-			wl_list_init(&ivilayer->pending.link);
-			wl_list_insert(&iviscrn->pending.layer_list,
-				       &ivilayer->pending.link);
-			break;
+		if (!wl_list_empty(&ivilayer->pending.link)) {
+			wl_list_remove(&ivilayer->pending.link);
 		}
+		wl_list_init(&ivilayer->pending.link);
+		wl_list_insert(&iviscrn->pending.layer_list,
+			       &ivilayer->pending.link);
 	}
 
 	iviscrn->event_mask |= IVI_NOTIFICATION_ADD;
@@ -2501,7 +3119,6 @@ ivi_layout_layer_add_surface(struct ivi_layout_layer *ivilayer,
 {
 	struct ivi_layout *layout = get_instance();
 	struct ivi_layout_surface *ivisurf = NULL;
-	struct ivi_layout_surface *next = NULL;
 	int is_surf_in_layer = 0;
 
 	if (ivilayer == NULL || addsurf == NULL) {
@@ -2515,19 +3132,18 @@ ivi_layout_layer_add_surface(struct ivi_layout_layer *ivilayer,
 		return IVI_SUCCEEDED;
 	}
 
-	wl_list_for_each_safe(ivisurf, next, &layout->surface_list, link) {
-		if (ivisurf->id_surface == addsurf->id_surface) {
-			if (!wl_list_empty(&ivisurf->pending.link)) {
-				wl_list_remove(&ivisurf->pending.link);
-			}
-			wl_list_init(&ivisurf->pending.link);
-			wl_list_insert(&ivilayer->pending.surface_list,
-				       &ivisurf->pending.link);
-			break;
+	ivisurf = get_surface(layout, addsurf->id_surface);
+	if (ivisurf != NULL) {
+		if (!wl_list_empty(&ivisurf->pending.link)) {
+			wl_list_remove(&ivisurf->pending.link);
 		}
+		wl_list_init(&ivisurf->pending.link);
+		wl_list_insert(&ivilayer->pending.surface_list,
+			       &ivisurf->pending.link);
 	}
 
 	ivilayer->event_mask |= IVI_NOTIFICATION_ADD;
+	layer_mark_dirty(ivilayer);
 
 	return IVI_SUCCEEDED;
 }
@@ -2556,6 +3172,7 @@ ivi_layout_layer_remove_surface(struct ivi_layout_layer *ivilayer,
 	}
 
 	remsurf->event_mask |= IVI_NOTIFICATION_REMOVE;
+	surface_mark_dirty(remsurf);
 }
 
 static int32_t
@@ -2577,6 +3194,7 @@ ivi_layout_surface_set_source_rectangle(struct ivi_layout_surface *ivisurf,
 	prop->source_height = height;
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_SOURCE_RECT;
+	surface_mark_dirty(ivisurf);
 
 	return IVI_SUCCEEDED;
 }
@@ -2594,7 +3212,7 @@ ivi_layout_commit_changes(void)
 
 	commit_changes(layout);
 	send_prop(layout);
-	weston_compositor_schedule_repaint(layout->compositor);
+	schedule_repaint(layout);
 
 	return IVI_SUCCEEDED;
 }
@@ -2611,6 +3229,7 @@ ivi_layout_layer_set_transition(struct ivi_layout_layer *ivilayer,
 
 	ivilayer->pending.prop.transition_type = type;
 	ivilayer->pending.prop.transition_duration = duration;
+	layer_mark_dirty(ivilayer);
 
 	return 0;
 }
@@ -2628,6 +3247,7 @@ ivi_layout_layer_set_fade_info(struct ivi_layout_layer* ivilayer,
 	ivilayer->pending.prop.is_fade_in = is_fade_in;
 	ivilayer->pending.prop.start_alpha = start_alpha;
 	ivilayer->pending.prop.end_alpha = end_alpha;
+	layer_mark_dirty(ivilayer);
 
 	return 0;
 }
@@ -2645,6 +3265,7 @@ ivi_layout_surface_set_transition_duration(struct ivi_layout_surface *ivisurf,
 
 	prop = &ivisurf->pending.prop;
 	prop->transition_duration = duration*10;
+	surface_mark_dirty(ivisurf);
 	return 0;
 }
 
@@ -2663,6 +3284,7 @@ ivi_layout_surface_set_transition(struct ivi_layout_surface *ivisurf,
 	prop = &ivisurf->pending.prop;
 	prop->transition_type = type;
 	prop->transition_duration = duration;
+	surface_mark_dirty(ivisurf);
 	return 0;
 }
 
@@ -2708,6 +3330,7 @@ ivi_layout_surface_configure(struct ivi_layout_surface *ivisurf,
 	/* } */
 
 	ivisurf->event_mask |= IVI_NOTIFICATION_CONFIGURE;
+	surface_mark_dirty(ivisurf);
 
 	if (in_init) {
 		wl_signal_emit(&layout->surface_notification.configure_changed, ivisurf);
@@ -2731,6 +3354,472 @@ ivi_layout_surface_set_content_observer(struct ivi_layout_surface *ivisurf,
 	return ret;
 }
 
+/**
+ * Scene snapshots
+ *
+ * A snapshot is a text file of the committed scene. It has a line per
+ * ivi_surface, then per ivi_layer, then per ivi_screen, so that each
+ * line only refers to objects listed before it:
+ *
+ *   surface <id> <visibility> <opacity> <source x y w h> <dest x y w h>
+ *           <orientation>
+ *   layer <id> <visibility> <opacity> <source x y w h> <dest x y w h>
+ *         <orientation> <count> <surface ids, bottom first>
+ *   screen <id> <count> <layer ids, bottom first>
+ *
+ * opacity is a wl_fixed_t. Restoring applies the scene in one commit;
+ * ivi_surfaces which do not exist yet are placed when they are created,
+ * and take their place with the controller's next commit. The source
+ * rectangle of an ivi_surface follows its buffer, so it is saved but
+ * not restored.
+ */
+#define SCENE_HEADER "ivi-scene 1"
+
+struct scene_surface {
+	uint32_t id_surface;
+	struct ivi_layout_surface_properties prop;
+	int pending; /* not placed yet */
+};
+
+struct scene_layer {
+	uint32_t id_layer;
+	struct ivi_layout_layer_properties prop;
+	/* range of ivi_layout::scene.surface_ids */
+	uint32_t first;
+	uint32_t count;
+};
+
+struct scene_screen {
+	uint32_t id_screen;
+	/* range of the layer IDs being restored */
+	uint32_t first;
+	uint32_t count;
+};
+
+static int32_t
+ivi_layout_scene_save(const char *filename)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_surface *ivisurf = NULL;
+	struct ivi_layout_layer *ivilayer = NULL;
+	struct ivi_layout_screen *iviscrn = NULL;
+	struct ivi_layout_surface_properties *sprop;
+	struct ivi_layout_layer_properties *lprop;
+	char *tmp;
+	FILE *fp;
+	int fd, ret;
+
+	if (filename == NULL) {
+		weston_log("ivi_layout_scene_save: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	if (asprintf(&tmp, "%s.XXXXXX", filename) < 0)
+		return IVI_FAILED;
+
+	/* Written under a temporary name and renamed into place, so that a
+	 * crash while saving leaves the previous snapshot. */
+	fd = mkstemp(tmp);
+	fp = fd < 0 ? NULL : fdopen(fd, "w");
+	if (fp == NULL) {
+		weston_log("fails to create %s: %m\n", tmp);
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp);
+		}
+		free(tmp);
+		return IVI_FAILED;
+	}
+
+	fprintf(fp, "%s\n", SCENE_HEADER);
+
+	wl_list_for_each(ivisurf, &layout->surface_list, link) {
+		sprop = &ivisurf->prop;
+		fprintf(fp, "surface %u %d %d %d %d %d %d %d %d %d %d %d\n",
+			ivisurf->id_surface, sprop->visibility, sprop->opacity,
+			sprop->source_x, sprop->source_y,
+			sprop->source_width, sprop->source_height,
+			sprop->dest_x, sprop->dest_y,
+			sprop->dest_width, sprop->dest_height,
+			sprop->orientation);
+	}
+
+	wl_list_for_each(ivilayer, &layout->layer_list, link) {
+		lprop = &ivilayer->prop;
+		fprintf(fp, "layer %u %u %d %d %d %d %d %d %d %d %d %d %d",
+			ivilayer->id_layer, lprop->visibility, lprop->opacity,
+			lprop->source_x, lprop->source_y,
+			lprop->source_width, lprop->source_height,
+			lprop->dest_x, lprop->dest_y,
+			lprop->dest_width, lprop->dest_height,
+			lprop->orientation,
+			wl_list_length(&ivilayer->order.surface_list));
+		wl_list_for_each(ivisurf, &ivilayer->order.surface_list,
+				 order.link)
+			fprintf(fp, " %u", ivisurf->id_surface);
+		fputc('\n', fp);
+	}
+
+	wl_list_for_each(iviscrn, &layout->screen_list, link) {
+		fprintf(fp, "screen %u %d", iviscrn->id_screen,
+			wl_list_length(&iviscrn->order.layer_list));
+		wl_list_for_each(ivilayer, &iviscrn->order.layer_list,
+				 order.link)
+			fprintf(fp, " %u", ivilayer->id_layer);
+		fputc('\n', fp);
+	}
+
+	ret = ferror(fp);
+	if (fclose(fp) != 0 || ret != 0 || rename(tmp, filename) < 0) {
+		weston_log("fails to write %s: %m\n", filename);
+		unlink(tmp);
+		free(tmp);
+		return IVI_FAILED;
+	}
+
+	free(tmp);
+
+	return IVI_SUCCEEDED;
+}
+
+/**
+ * Internal API to read a list of count IDs into ids.
+ */
+static int
+scene_parse_ids(const char *p, uint32_t count, struct wl_array *ids)
+{
+	uint32_t *id;
+	char *end;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		id = wl_array_add(ids, sizeof *id);
+		if (id == NULL)
+			return -1;
+
+		*id = strtoul(p, &end, 10);
+		if (end == p)
+			return -1;
+		p = end;
+	}
+
+	return 0;
+}
+
+static int
+scene_parse_line(struct ivi_layout *layout, const char *line,
+		 struct wl_array *screens, struct wl_array *layer_ids)
+{
+	struct scene_surface *surface;
+	struct scene_layer *layer;
+	struct scene_screen *screen;
+	struct ivi_layout_surface_properties *sprop;
+	struct ivi_layout_layer_properties *lprop;
+	int visibility, orientation, n = 0;
+
+	if (strncmp(line, "surface ", 8) == 0) {
+		surface = wl_array_add(&layout->scene.surfaces, sizeof *surface);
+		if (surface == NULL)
+			return -1;
+
+		sprop = &surface->prop;
+		init_surface_properties(sprop);
+		if (sscanf(line, "surface %u %d %d %d %d %d %d %d %d %d %d %d",
+			   &surface->id_surface, &visibility, &sprop->opacity,
+			   &sprop->source_x, &sprop->source_y,
+			   &sprop->source_width, &sprop->source_height,
+			   &sprop->dest_x, &sprop->dest_y,
+			   &sprop->dest_width, &sprop->dest_height,
+			   &orientation) != 12)
+			return -1;
+
+		sprop->visibility = visibility;
+		sprop->orientation = orientation;
+		surface->pending = 1;
+	} else if (strncmp(line, "layer ", 6) == 0) {
+		layer = wl_array_add(&layout->scene.layers, sizeof *layer);
+		if (layer == NULL)
+			return -1;
+
+		lprop = &layer->prop;
+		init_layer_properties(lprop, 0, 0);
+		if (sscanf(line, "layer %u %u %d %d %d %d %d %d %d %d %d %d %u%n",
+			   &layer->id_layer, &lprop->visibility, &lprop->opacity,
+			   &lprop->source_x, &lprop->source_y,
+			   &lprop->source_width, &lprop->source_height,
+			   &lprop->dest_x, &lprop->dest_y,
+			   &lprop->dest_width, &lprop->dest_height,
+			   &orientation, &layer->count, &n) != 13)
+			return -1;
+
+		lprop->orientation = orientation;
+		layer->first = layout->scene.surface_ids.size / sizeof(uint32_t);
+		return scene_parse_ids(line + n, layer->count,
+				       &layout->scene.surface_ids);
+	} else if (strncmp(line, "screen ", 7) == 0) {
+		screen = wl_array_add(screens, sizeof *screen);
+		if (screen == NULL)
+			return -1;
+
+		if (sscanf(line, "screen %u %u%n",
+			   &screen->id_screen, &screen->count, &n) != 2)
+			return -1;
+
+		screen->first = layer_ids->size / sizeof(uint32_t);
+		return scene_parse_ids(line + n, screen->count, layer_ids);
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+scene_apply_surface(struct ivi_layout_surface *ivisurf,
+		    const struct ivi_layout_surface_properties *prop)
+{
+	ivi_layout_surface_set_visibility(ivisurf, prop->visibility);
+	ivi_layout_surface_set_opacity(ivisurf, prop->opacity);
+	ivi_layout_surface_set_destination_rectangle(ivisurf,
+						     prop->dest_x, prop->dest_y,
+						     prop->dest_width,
+						     prop->dest_height);
+	ivi_layout_surface_set_orientation(ivisurf, prop->orientation);
+}
+
+static void
+scene_apply_layer(struct ivi_layout_layer *ivilayer,
+		  const struct ivi_layout_layer_properties *prop)
+{
+	ivi_layout_layer_set_visibility(ivilayer, prop->visibility);
+	ivi_layout_layer_set_opacity(ivilayer, prop->opacity);
+	ivi_layout_layer_set_source_rectangle(ivilayer,
+					      prop->source_x, prop->source_y,
+					      prop->source_width,
+					      prop->source_height);
+	ivi_layout_layer_set_destination_rectangle(ivilayer,
+						   prop->dest_x, prop->dest_y,
+						   prop->dest_width,
+						   prop->dest_height);
+	ivi_layout_layer_set_orientation(ivilayer, prop->orientation);
+}
+
+/**
+ * Internal API to set the render order of an ivi_layer to the existing
+ * ivi_surfaces of its snapshot, followed by those added to the ivi_layer
+ * since, which the snapshot does not list.
+ */
+static void
+scene_order_layer(struct ivi_layout *layout, struct ivi_layout_layer *ivilayer,
+		  const struct scene_layer *layer)
+{
+	const uint32_t *ids = layout->scene.surface_ids.data;
+	struct ivi_layout_surface *ivisurf = NULL;
+	struct ivi_layout_surface **entry;
+	struct wl_array order;
+	uint32_t i;
+
+	wl_array_init(&order);
+
+	for (i = 0; i < layer->count; i++) {
+		ivisurf = get_surface(layout, ids[layer->first + i]);
+		if (ivisurf == NULL)
+			continue;
+
+		entry = wl_array_add(&order, sizeof *entry);
+		if (entry == NULL)
+			goto out;
+		*entry = ivisurf;
+	}
+
+	wl_list_for_each(ivisurf, &ivilayer->pending.surface_list, pending.link) {
+		for (i = 0; i < layer->count; i++) {
+			if (ids[layer->first + i] == ivisurf->id_surface)
+				break;
+		}
+		if (i < layer->count)
+			continue;
+
+		entry = wl_array_add(&order, sizeof *entry);
+		if (entry == NULL)
+			goto out;
+		*entry = ivisurf;
+	}
+
+	ivi_layout_layer_set_render_order(ivilayer, order.data,
+					  order.size / sizeof *entry);
+
+out:
+	wl_array_release(&order);
+}
+
+static void
+scene_order_screen(struct ivi_layout_screen *iviscrn,
+		   const uint32_t *ids, uint32_t count)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_layer **layers;
+	int32_t n = 0;
+	uint32_t i;
+
+	layers = calloc(count + 1, sizeof *layers);
+	if (layers == NULL) {
+		weston_log("fails to allocate memory\n");
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		layers[n] = get_layer(layout, ids[i]);
+		if (layers[n] != NULL)
+			n++;
+	}
+
+	ivi_layout_screen_set_render_order(iviscrn, layers, n);
+	free(layers);
+}
+
+/**
+ * Internal API to place an ivi_surface being created where the restored
+ * snapshot has it, before the controller learns about it. Only pending
+ * state is set, so nothing changes on screen before the controller
+ * commits.
+ */
+static void
+scene_place_surface(struct ivi_layout *layout,
+		    struct ivi_layout_surface *ivisurf)
+{
+	struct scene_surface *surface;
+	struct scene_layer *layer;
+	struct ivi_layout_layer *ivilayer;
+	const uint32_t *ids = layout->scene.surface_ids.data;
+	int placed = 0;
+	uint32_t i;
+
+	wl_array_for_each(surface, &layout->scene.surfaces) {
+		if (surface->id_surface != ivisurf->id_surface ||
+		    !surface->pending)
+			continue;
+
+		surface->pending = 0;
+		scene_apply_surface(ivisurf, &surface->prop);
+		placed = 1;
+		break;
+	}
+
+	if (!placed)
+		return;
+
+	wl_array_for_each(layer, &layout->scene.layers) {
+		ivilayer = get_layer(layout, layer->id_layer);
+		if (ivilayer == NULL)
+			continue;
+
+		for (i = 0; i < layer->count; i++) {
+			if (ids[layer->first + i] == ivisurf->id_surface) {
+				scene_order_layer(layout, ivilayer, layer);
+				break;
+			}
+		}
+	}
+}
+
+static int32_t
+ivi_layout_scene_restore(const char *filename)
+{
+	struct ivi_layout *layout = get_instance();
+	struct ivi_layout_surface *ivisurf;
+	struct ivi_layout_layer *ivilayer;
+	struct ivi_layout_screen *iviscrn;
+	struct scene_surface *surface;
+	struct scene_layer *layer;
+	struct scene_screen *screen;
+	struct wl_array screens, layer_ids;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int32_t ret = IVI_SUCCEEDED;
+	FILE *fp;
+
+	if (filename == NULL) {
+		weston_log("ivi_layout_scene_restore: invalid argument\n");
+		return IVI_FAILED;
+	}
+
+	fp = fopen(filename, "r");
+	if (fp == NULL) {
+		weston_log("fails to open %s: %m\n", filename);
+		return IVI_FAILED;
+	}
+
+	layout->scene.surfaces.size = 0;
+	layout->scene.layers.size = 0;
+	layout->scene.surface_ids.size = 0;
+	wl_array_init(&screens);
+	wl_array_init(&layer_ids);
+
+	/* Parse all of it first, so that a broken file changes nothing. */
+	len = getline(&line, &size, fp);
+	if (len < 0 || strcmp(line, SCENE_HEADER "\n") != 0)
+		ret = IVI_FAILED;
+
+	while (ret == IVI_SUCCEEDED && getline(&line, &size, fp) >= 0) {
+		if (scene_parse_line(layout, line, &screens, &layer_ids) < 0)
+			ret = IVI_FAILED;
+	}
+
+	free(line);
+	fclose(fp);
+
+	if (ret != IVI_SUCCEEDED) {
+		weston_log("%s is not a valid ivi scene\n", filename);
+		layout->scene.surfaces.size = 0;
+		layout->scene.layers.size = 0;
+		layout->scene.surface_ids.size = 0;
+		goto out;
+	}
+
+	wl_array_for_each(surface, &layout->scene.surfaces) {
+		ivisurf = get_surface(layout, surface->id_surface);
+		if (ivisurf == NULL)
+			continue;
+
+		surface->pending = 0;
+		scene_apply_surface(ivisurf, &surface->prop);
+	}
+
+	wl_array_for_each(layer, &layout->scene.layers) {
+		ivilayer = get_layer(layout, layer->id_layer);
+		if (ivilayer == NULL)
+			ivilayer = ivi_layout_layer_create_with_dimension(
+					layer->id_layer,
+					layer->prop.dest_width,
+					layer->prop.dest_height);
+		if (ivilayer == NULL)
+			continue;
+
+		scene_apply_layer(ivilayer, &layer->prop);
+		scene_order_layer(layout, ivilayer, layer);
+	}
+
+	wl_array_for_each(screen, &screens) {
+		iviscrn = ivi_layout_get_screen_from_id(screen->id_screen);
+		if (iviscrn == NULL)
+			continue;
+
+		scene_order_screen(iviscrn,
+				   (uint32_t *) layer_ids.data + screen->first,
+				   screen->count);
+	}
+
+	ivi_layout_commit_changes();
+
+out:
+	wl_array_release(&screens);
+	wl_array_release(&layer_ids);
+
+	return ret;
+}
+
 struct ivi_layout_surface*
 ivi_layout_surface_create(struct weston_surface *wl_surface,
 			  uint32_t id_surface)
@@ -2744,7 +3833,7 @@ ivi_layout_surface_create(struct weston_surface *wl_surface,
 		return NULL;
 	}
 
-	ivisurf = get_surface(&layout->surface_list, id_surface);
+	ivisurf = get_surface(layout, id_surface);
 	if (ivisurf != NULL) {
 		if (ivisurf->surface != NULL) {
 			weston_log("id_surface(%d) is already created\n", id_surface);
@@ -2799,15 +3888,27 @@ ivi_layout_surface_create(struct weston_surface *wl_surface,
 
 	wl_list_init(&ivisurf->order.link);
 	wl_list_init(&ivisurf->order.layer_list);
+	wl_list_init(&ivisurf->dirty_link);
+
+	if (hash_table_insert(layout->surface_hash, id_surface, ivisurf) < 0) {
+		weston_log("fails to allocate memory\n");
+		wl_list_remove(&ivisurf->surface_destroy_listener.link);
+		if (tmpview != NULL)
+			weston_view_destroy(tmpview);
+		free(ivisurf);
+		return NULL;
+	}
 
 	wl_list_insert(&layout->surface_list, &ivisurf->link);
 
+	scene_place_surface(layout, ivisurf);
+
 	wl_signal_emit(&layout->surface_notification.created, ivisurf);
 
 	return ivisurf;
 }
 
-void
+int
 ivi_layout_init_with_compositor(struct weston_compositor *ec)
 {
 	struct ivi_layout *layout = get_instance();
@@ -2818,6 +3919,22 @@ ivi_layout_init_with_compositor(struct weston_compositor *ec)
 	wl_list_init(&layout->layer_list);
 	wl_list_init(&layout->screen_list);
 
+	layout->surface_hash = hash_table_create();
+	layout->layer_hash = hash_table_create();
+	if (layout->surface_hash == NULL || layout->layer_hash == NULL) {
+		weston_log("fails to allocate memory\n");
+		if (layout->surface_hash)
+			hash_table_destroy(layout->surface_hash);
+		if (layout->layer_hash)
+			hash_table_destroy(layout->layer_hash);
+		layout->surface_hash = NULL;
+		layout->layer_hash = NULL;
+		return -1;
+	}
+
+	wl_list_init(&layout->dirty.surface_list);
+	wl_list_init(&layout->dirty.layer_list);
+
 	wl_signal_init(&layout->layer_notification.created);
 	wl_signal_init(&layout->layer_notification.removed);
 
@@ -2825,13 +3942,23 @@ ivi_layout_init_with_compositor(struct weston_compositor *ec)
 	wl_signal_init(&layout->surface_notification.removed);
 	wl_signal_init(&layout->surface_notification.configure_changed);
 
+	wl_signal_init(&layout->commit_notification.committed);
+	wl_array_init(&layout->commit_notification.layers);
+	wl_array_init(&layout->commit_notification.surfaces);
+	wl_list_init(&layout->commit_notification.sending);
+	wl_array_init(&layout->cache_views);
+	wl_array_init(&layout->scene.surfaces);
+	wl_array_init(&layout->scene.layers);
+	wl_array_init(&layout->scene.surface_ids);
+
 	/* Add layout_layer at the last of weston_compositor.layer_list */
 	weston_layer_init(&layout->layout_layer, ec->layer_list.prev);
 
 	create_screen(ec);
 
 	layout->transitions = ivi_layout_transition_set_create(ec);
-	wl_list_init(&layout->pending_transition_list);
+
+	return 0;
 }
 
 
@@ -2930,7 +4057,38 @@ static struct ivi_controller_interface ivi_controller_interface = {
 	 * animation
 	 */
 	.transition_move_layer_cancel	= ivi_layout_transition_move_layer_cancel,
-	.layer_set_fade_info		= ivi_layout_layer_set_fade_info
+	.layer_set_fade_info		= ivi_layout_layer_set_fade_info,
+
+	/**
+	 * allocation-free queries
+	 */
+	.for_each_surface		= ivi_layout_for_each_surface,
+	.for_each_surface_on_layer	= ivi_layout_for_each_surface_on_layer,
+	.for_each_layer			= ivi_layout_for_each_layer,
+	.for_each_layer_on_screen	= ivi_layout_for_each_layer_on_screen,
+	.get_surfaces_into		= ivi_layout_get_surfaces_into,
+	.get_surfaces_on_layer_into	= ivi_layout_get_surfaces_on_layer_into,
+	.get_layers_into		= ivi_layout_get_layers_into,
+	.get_layers_on_screen_into	= ivi_layout_get_layers_on_screen_into,
+
+	/**
+	 * batched notification
+	 */
+	.add_notification_commit	= ivi_layout_add_notification_commit,
+	.remove_notification_commit	= ivi_layout_remove_notification_commit,
+	.set_transition_frame_notification = ivi_layout_set_transition_frame_notification,
+
+	/**
+	 * offscreen layer cache
+	 */
+	.layer_set_cache		= ivi_layout_layer_set_cache,
+	.layer_get_cache_stats		= ivi_layout_layer_get_cache_stats,
+
+	/**
+	 * scene snapshot
+	 */
+	.scene_save			= ivi_layout_scene_save,
+	.scene_restore			= ivi_layout_scene_restore
 };
 
 int
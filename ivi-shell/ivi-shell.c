@@ -440,7 +440,8 @@ module_init(struct weston_compositor *compositor,
 			     shell, bind_ivi_application) == NULL)
 		goto out_settings;
 
-	ivi_layout_init_with_compositor(compositor);
+	if (ivi_layout_init_with_compositor(compositor) < 0)
+		goto out_settings;
 
 	/* Call module_init of ivi-modules which are defined in weston.ini */
 	if (load_controller_modules(compositor, setting.ivi_module,
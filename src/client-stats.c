@@ -0,0 +1,325 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <linux/input.h>
+
+#include "compositor.h"
+#include "client-stats.h"
+
+/* Per-client accounting of the work clients make the compositor do.
+ *
+ * Only wl_surface requests are counted, and only commit, damage and
+ * buffer upload handlers are timed; other interfaces are not accounted.
+ * These counts and times are only collected while accounting is enabled, so the hot paths cost a single flag test otherwise.
+ * Memory held through SHM buffers and renderer textures changes rarely
+ * and is tracked always, so that the numbers are right whenever
+ * accounting gets switched on.
+ */
+
+struct client_stats {
+	struct wl_client *client;
+	struct wl_listener destroy_listener;
+	struct wl_list link;
+
+	uint64_t surface_requests;
+	uint64_t count[CLIENT_STATS_KIND_COUNT];
+	uint64_t time_ns[CLIENT_STATS_KIND_COUNT];
+
+	int64_t shm_bytes;
+	int64_t texture_bytes;
+};
+
+struct client_stats_state {
+	struct weston_compositor *compositor;
+	struct wl_list client_list; /* struct client_stats::link */
+	struct wl_event_source *dump_timer;
+	int32_t interval;
+	uint64_t since;
+	struct wl_listener compositor_destroy_listener;
+};
+
+WL_EXPORT int weston_client_stats_enabled_;
+static struct client_stats_state stats_;
+
+static const char *const kind_names[CLIENT_STATS_KIND_COUNT] = {
+	[CLIENT_STATS_COMMIT] = "commit",
+	[CLIENT_STATS_DAMAGE] = "damage",
+	[CLIENT_STATS_UPLOAD] = "upload",
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+client_stats_handle_client_destroy(struct wl_listener *listener, void *data)
+{
+	struct client_stats *cs =
+		container_of(listener, struct client_stats, destroy_listener);
+
+	/* Resources, buffers included, are destroyed after this. Unhook
+	 * so that their accounting finds nothing to update. */
+	wl_list_remove(&cs->destroy_listener.link);
+	wl_list_remove(&cs->link);
+	free(cs);
+}
+
+static struct client_stats *
+client_stats_get(struct wl_client *client, int create)
+{
+	struct wl_listener *listener;
+	struct client_stats *cs;
+
+	if (!client)
+		return NULL;
+
+	listener = wl_client_get_destroy_listener(client,
+				client_stats_handle_client_destroy);
+	if (listener)
+		return container_of(listener, struct client_stats,
+				    destroy_listener);
+
+	if (!create || !stats_.compositor)
+		return NULL;
+
+	cs = zalloc(sizeof *cs);
+	if (!cs)
+		return NULL;
+
+	cs->client = client;
+	cs->destroy_listener.notify = client_stats_handle_client_destroy;
+	wl_client_add_destroy_listener(client, &cs->destroy_listener);
+	wl_list_insert(stats_.client_list.prev, &cs->link);
+
+	return cs;
+}
+
+WL_EXPORT void
+weston_client_stats_surface_request(struct wl_client *client)
+{
+	struct client_stats *cs = client_stats_get(client, 1);
+
+	if (cs)
+		cs->surface_requests++;
+}
+
+WL_EXPORT void
+weston_client_stats_add_time(struct wl_client *client,
+			     enum client_stats_kind kind, uint64_t begin)
+{
+	struct client_stats *cs = client_stats_get(client, 1);
+
+	if (!cs)
+		return;
+
+	cs->count[kind]++;
+	cs->time_ns[kind] += now_ns() - begin;
+}
+
+WL_EXPORT void
+weston_client_stats_account_shm(struct wl_client *client, int64_t delta)
+{
+	struct client_stats *cs = client_stats_get(client, delta > 0);
+
+	if (cs)
+		cs->shm_bytes += delta;
+}
+
+WL_EXPORT void
+weston_client_stats_account_texture(struct weston_surface *surface,
+				    int64_t delta)
+{
+	struct client_stats *cs;
+
+	if (!surface->resource)
+		return;
+
+	cs = client_stats_get(wl_resource_get_client(surface->resource),
+			      delta > 0);
+	if (cs)
+		cs->texture_bytes += delta;
+}
+
+static double
+ns_to_ms(uint64_t ns)
+{
+	return ns / 1000000.0;
+}
+
+/** Log the accounting of every client, then start a new period
+ *
+ * Request counts and times cover the period since the previous dump,
+ * memory is what the client holds right now.
+ */
+WL_EXPORT void
+weston_client_stats_dump(void)
+{
+	struct client_stats *cs;
+	uint64_t now = now_ns();
+	pid_t pid;
+	uid_t uid;
+	gid_t gid;
+	int i;
+
+	if (!stats_.compositor)
+		return;
+
+	weston_log("client accounting over the last %.1f s:\n",
+		   ns_to_ms(now - stats_.since) / 1000.0);
+
+	wl_list_for_each(cs, &stats_.client_list, link) {
+		wl_client_get_credentials(cs->client, &pid, &uid, &gid);
+		weston_log_continue(STAMP_SPACE "pid %d: %" PRIu64
+				    " surface requests", (int)pid,
+				    cs->surface_requests);
+		for (i = 0; i < CLIENT_STATS_KIND_COUNT; i++)
+			weston_log_continue(", %s %" PRIu64 " / %.3f ms",
+					    kind_names[i], cs->count[i],
+					    ns_to_ms(cs->time_ns[i]));
+		weston_log_continue(", shm %" PRId64 " KiB"
+				    ", textures %" PRId64 " KiB\n",
+				    cs->shm_bytes / 1024,
+				    cs->texture_bytes / 1024);
+
+		cs->surface_requests = 0;
+		memset(cs->count, 0, sizeof cs->count);
+		memset(cs->time_ns, 0, sizeof cs->time_ns);
+	}
+
+	stats_.since = now;
+}
+
+static int
+dump_timer_handler(void *data)
+{
+	weston_client_stats_dump();
+	wl_event_source_timer_update(stats_.dump_timer,
+				     stats_.interval * 1000);
+
+	return 1;
+}
+
+static void
+client_stats_set_enabled(int enabled)
+{
+	struct client_stats *cs;
+
+	if (enabled == weston_client_stats_enabled_)
+		return;
+
+	weston_client_stats_enabled_ = enabled;
+
+	if (enabled) {
+		wl_list_for_each(cs, &stats_.client_list, link) {
+			cs->surface_requests = 0;
+			memset(cs->count, 0, sizeof cs->count);
+			memset(cs->time_ns, 0, sizeof cs->time_ns);
+		}
+		stats_.since = now_ns();
+		weston_log("client accounting enabled\n");
+	} else {
+		weston_client_stats_dump();
+		weston_log("client accounting disabled\n");
+	}
+}
+
+static void
+client_stats_binding(struct weston_seat *seat, uint32_t time, uint32_t key,
+		     void *data)
+{
+	client_stats_set_enabled(!weston_client_stats_enabled_);
+}
+
+static void
+client_stats_handle_compositor_destroy(struct wl_listener *listener,
+				       void *data)
+{
+	struct client_stats *cs, *next;
+
+	weston_client_stats_enabled_ = 0;
+
+	if (stats_.dump_timer)
+		wl_event_source_remove(stats_.dump_timer);
+	stats_.dump_timer = NULL;
+
+	wl_list_for_each_safe(cs, next, &stats_.client_list, link) {
+		wl_list_remove(&cs->destroy_listener.link);
+		wl_list_remove(&cs->link);
+		free(cs);
+	}
+
+	wl_list_remove(&stats_.compositor_destroy_listener.link);
+	stats_.compositor = NULL;
+}
+
+/** Set up per-client accounting
+ *
+ * Accounting is toggled with the debug binding mod+shift+space a, which
+ * logs a report when switching off. With client-stats-interval set in the
+ * [core] section of weston.ini, accounting is on from the start and a
+ * report is logged every that many seconds.
+ */
+void
+weston_client_stats_init(struct weston_compositor *compositor)
+{
+	struct weston_config_section *section;
+	struct wl_event_loop *loop;
+
+	stats_.compositor = compositor;
+	wl_list_init(&stats_.client_list);
+
+	stats_.compositor_destroy_listener.notify =
+		client_stats_handle_compositor_destroy;
+	wl_signal_add(&compositor->destroy_signal,
+		      &stats_.compositor_destroy_listener);
+
+	weston_compositor_add_debug_binding(compositor, KEY_A,
+					    client_stats_binding, NULL);
+
+	section = weston_config_get_section(compositor->config,
+					    "core", NULL, NULL);
+	weston_config_section_get_int(section, "client-stats-interval",
+				      &stats_.interval, 0);
+	if (stats_.interval <= 0)
+		return;
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+	stats_.dump_timer = wl_event_loop_add_timer(loop, dump_timer_handler,
+						    NULL);
+	if (!stats_.dump_timer)
+		return;
+
+	wl_event_source_timer_update(stats_.dump_timer,
+				     stats_.interval * 1000);
+	client_stats_set_enabled(1);
+}
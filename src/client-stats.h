@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WESTON_CLIENT_STATS_H
+#define WESTON_CLIENT_STATS_H
+
+#include <stdint.h>
+#include <time.h>
+
+extern int weston_client_stats_enabled_;
+
+struct weston_compositor;
+struct wl_client;
+
+enum client_stats_kind {
+	CLIENT_STATS_COMMIT,
+	CLIENT_STATS_DAMAGE,
+	CLIENT_STATS_UPLOAD,
+	CLIENT_STATS_KIND_COUNT
+};
+
+void
+weston_client_stats_init(struct weston_compositor *compositor);
+
+void
+weston_client_stats_surface_request(struct wl_client *client);
+
+void
+weston_client_stats_add_time(struct wl_client *client,
+			     enum client_stats_kind kind, uint64_t begin);
+
+void
+weston_client_stats_account_shm(struct wl_client *client, int64_t delta);
+
+void
+weston_client_stats_dump(void);
+
+static inline uint64_t
+weston_client_stats_now(void)
+{
+	struct timespec ts;
+
+	if (!weston_client_stats_enabled_)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Call from the wl_surface request handlers. */
+#define CLIENT_STATS_SURFACE_REQUEST(client) do { \
+	if (weston_client_stats_enabled_) \
+		weston_client_stats_surface_request(client); \
+} while (0)
+
+#define CLIENT_STATS_TIME(client, kind, begin) do { \
+	if (weston_client_stats_enabled_ && (begin)) \
+		weston_client_stats_add_time(client, kind, begin); \
+} while (0)
+
+#endif /* WESTON_CLIENT_STATS_H */
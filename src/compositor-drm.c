@@ -1124,8 +1124,11 @@ drm_assign_planes(struct weston_output *output_base)
 		pixman_region32_intersect(&surface_overlap, &overlap,
 					  &ev->transform.boundingbox);
 
+		/* Cached views are only drawn through their cache's image,
+		 * which the renderer composites. */
 		next_plane = NULL;
-		if (pixman_region32_not_empty(&surface_overlap))
+		if (pixman_region32_not_empty(&surface_overlap) ||
+		    ev->cache.owner)
 			next_plane = primary;
 		if (next_plane == NULL)
 			next_plane = drm_output_prepare_cursor_view(output, ev);
@@ -23,6 +23,7 @@
 
 #include "config.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
@@ -32,16 +33,33 @@
 #include "pixman-renderer.h"
 #include "presentation_timing-server-protocol.h"
 
+/* How frame completion is signalled after a repaint:
+ * TIMER waits one refresh period of wall clock time, as a display would;
+ * UNTHROTTLED completes the frame as soon as the main loop is idle again,
+ * for measuring compositor throughput; VIRTUAL does the same, but the
+ * presentation clock of the output only advances by exactly one refresh
+ * period per frame (and when stepped), making timestamps deterministic.
+ */
+enum headless_frame_mode {
+	HEADLESS_FRAME_TIMER,
+	HEADLESS_FRAME_UNTHROTTLED,
+	HEADLESS_FRAME_VIRTUAL,
+};
+
 struct headless_compositor {
 	struct weston_compositor base;
 	struct weston_seat fake_seat;
 	bool use_pixman;
+	enum headless_frame_mode frame_mode;
 };
 
 struct headless_output {
 	struct weston_output base;
 	struct weston_mode mode;
 	struct wl_event_source *finish_frame_timer;
+	struct wl_event_source *finish_frame_idle;
+	struct timespec virtual_clock;
+	int64_t frame_period_ns;
 	uint32_t *image_buf;
 	pixman_image_t *image;
 };
@@ -51,42 +69,121 @@ struct headless_parameters {
 	int height;
 	int use_pixman;
 	uint32_t transform;
+	int refresh;
+	int output_count;
+	enum headless_frame_mode frame_mode;
+};
+
+struct headless_output_config {
+	char *name;
+	int x, y;
+	int width, height;
+	int scale;
+	uint32_t transform;
+	int refresh;
 };
 
+static void
+timespec_add_nsec(struct timespec *ts, int64_t nsec)
+{
+	nsec += ts->tv_nsec;
+	ts->tv_sec += nsec / 1000000000;
+	ts->tv_nsec = nsec % 1000000000;
+}
+
+static void
+headless_output_read_clock(struct headless_output *output,
+			   struct timespec *ts)
+{
+	struct headless_compositor *c =
+		(struct headless_compositor *) output->base.compositor;
+
+	if (c->frame_mode == HEADLESS_FRAME_VIRTUAL)
+		*ts = output->virtual_clock;
+	else
+		clock_gettime(c->base.presentation_clock, ts);
+}
+
 static void
 headless_output_start_repaint_loop(struct weston_output *output)
 {
 	struct timespec ts;
 
-	clock_gettime(output->compositor->presentation_clock, &ts);
+	headless_output_read_clock((struct headless_output *) output, &ts);
 	weston_output_finish_frame(output, &ts, PRESENTATION_FEEDBACK_INVALID);
 }
 
-static int
-finish_frame_handler(void *data)
+static void
+finish_frame(struct headless_output *output)
 {
-	struct headless_output *output = data;
+	struct headless_compositor *c =
+		(struct headless_compositor *) output->base.compositor;
 	struct timespec ts;
 
-	clock_gettime(output->base.compositor->presentation_clock, &ts);
+	if (c->frame_mode == HEADLESS_FRAME_VIRTUAL)
+		timespec_add_nsec(&output->virtual_clock,
+				  output->frame_period_ns);
+
+	output->base.msc++;
+	headless_output_read_clock(output, &ts);
 	weston_output_finish_frame(&output->base, &ts, 0);
+}
+
+static int
+finish_frame_handler(void *data)
+{
+	finish_frame(data);
 
 	return 1;
 }
 
+static void
+finish_frame_idle_handler(void *data)
+{
+	struct headless_output *output = data;
+
+	output->finish_frame_idle = NULL;
+	finish_frame(output);
+}
+
+static void
+headless_step_clock(struct weston_compositor *ec, uint32_t frames)
+{
+	struct headless_output *output;
+
+	/* Each skipped frame counts as presented, like in finish_frame(). */
+	wl_list_for_each(output, &ec->output_list, base.link) {
+		timespec_add_nsec(&output->virtual_clock,
+				  frames * output->frame_period_ns);
+		output->base.msc += frames;
+	}
+}
+
 static int
 headless_output_repaint(struct weston_output *output_base,
 		       pixman_region32_t *damage)
 {
 	struct headless_output *output = (struct headless_output *) output_base;
 	struct weston_compositor *ec = output->base.compositor;
+	struct headless_compositor *c = (struct headless_compositor *) ec;
+	struct wl_event_loop *loop;
+	int msecs;
 
 	ec->renderer->repaint_output(&output->base, damage);
 
 	pixman_region32_subtract(&ec->primary_plane.damage,
 				 &ec->primary_plane.damage, damage);
 
-	wl_event_source_timer_update(output->finish_frame_timer, 16);
+	if (c->frame_mode == HEADLESS_FRAME_TIMER) {
+		msecs = (output->frame_period_ns + 500000) / 1000000;
+		wl_event_source_timer_update(output->finish_frame_timer,
+					     msecs > 0 ? msecs : 1);
+	} else if (!output->finish_frame_idle) {
+		loop = wl_display_get_event_loop(ec->wl_display);
+		output->finish_frame_idle =
+			wl_event_loop_add_idle(loop, finish_frame_idle_handler,
+					       output);
+	}
 
 	return 0;
 }
@@ -99,6 +196,8 @@ headless_output_destroy(struct weston_output *output_base)
 			(struct headless_compositor *) output->base.compositor;
 
 	wl_event_source_remove(output->finish_frame_timer);
+	if (output->finish_frame_idle)
+		wl_event_source_remove(output->finish_frame_idle);
 
 	if (c->use_pixman) {
 		pixman_renderer_output_destroy(&output->base);
@@ -113,29 +212,34 @@ headless_output_destroy(struct weston_output *output_base)
 	return;
 }
 
-static int
+static struct headless_output *
 headless_compositor_create_output(struct headless_compositor *c,
-				  struct headless_parameters *param)
+				  const struct headless_output_config *oc)
 {
 	struct headless_output *output;
 	struct wl_event_loop *loop;
 
 	output = zalloc(sizeof *output);
 	if (output == NULL)
-		return -1;
+		return NULL;
 
 	output->mode.flags =
 		WL_OUTPUT_MODE_CURRENT | WL_OUTPUT_MODE_PREFERRED;
-	output->mode.width = param->width;
-	output->mode.height = param->height;
-	output->mode.refresh = 60000;
+	output->mode.width = oc->width;
+	output->mode.height = oc->height;
+	output->mode.refresh = oc->refresh;
 	wl_list_init(&output->base.mode_list);
 	wl_list_insert(&output->base.mode_list, &output->mode.link);
 
 	output->base.current_mode = &output->mode;
-	weston_output_init(&output->base, &c->base, 0, 0, param->width,
-			   param->height, param->transform, 1);
+	weston_output_init(&output->base, &c->base, oc->x, oc->y, oc->width,
+			   oc->height, oc->transform, oc->scale);
 
+	clock_gettime(c->base.presentation_clock, &output->virtual_clock);
+	output->frame_period_ns = 1000000000000LL / oc->refresh;
+
+	if (oc->name)
+		output->base.name = strdup(oc->name);
 	output->base.make = "weston";
 	output->base.model = "headless";
 
@@ -151,19 +255,20 @@ headless_compositor_create_output(struct headless_compositor *c,
 	output->base.set_dpms = NULL;
 	output->base.switch_mode = NULL;
 
+	/* Every output renders into its own buffer. */
 	if (c->use_pixman) {
-		output->image_buf = malloc(param->width * param->height * 4);
+		output->image_buf = malloc(oc->width * oc->height * 4);
 		if (!output->image_buf)
-			return -1;
+			return NULL;
 
 		output->image = pixman_image_create_bits(PIXMAN_x8r8g8b8,
-							 param->width,
-							 param->height,
+							 oc->width,
+							 oc->height,
 							 output->image_buf,
-							 param->width * 4);
+							 oc->width * 4);
 
 		if (pixman_renderer_output_create(&output->base) < 0)
-			return -1;
+			return NULL;
 
 		pixman_renderer_output_set_buffer(&output->base,
 						  output->image);
@@ -171,6 +276,113 @@ headless_compositor_create_output(struct headless_compositor *c,
 
 	wl_list_insert(c->base.output_list.prev, &output->base.link);
 
+	return output;
+}
+
+static void
+headless_output_config_from_section(struct weston_config_section *section,
+				    const struct headless_parameters *param,
+				    struct headless_output_config *oc)
+{
+	char *mode, *position, *t;
+
+	weston_config_section_get_string(section, "mode", &mode, NULL);
+	if (mode && sscanf(mode, "%dx%d", &oc->width, &oc->height) != 2) {
+		weston_log("Invalid mode \"%s\" for output %s\n",
+			   mode, oc->name);
+		oc->width = param->width;
+		oc->height = param->height;
+	}
+	free(mode);
+
+	weston_config_section_get_string(section, "position", &position,
+					 NULL);
+	if (position && sscanf(position, "%d,%d", &oc->x, &oc->y) != 2)
+		weston_log("Invalid position \"%s\" for output %s\n",
+			   position, oc->name);
+	free(position);
+
+	weston_config_section_get_int(section, "scale", &oc->scale, 1);
+	if (oc->scale < 1)
+		oc->scale = 1;
+
+	weston_config_section_get_int(section, "refresh", &oc->refresh,
+				      param->refresh);
+	if (oc->refresh <= 0)
+		oc->refresh = param->refresh;
+
+	weston_config_section_get_string(section, "transform", &t, NULL);
+	if (t && weston_parse_transform(t, &oc->transform) < 0)
+		weston_log("Invalid transform \"%s\" for output %s\n",
+			   t, oc->name);
+	free(t);
+}
+
+static void
+headless_output_config_init(struct headless_output_config *oc,
+			    const struct headless_parameters *param, int x)
+{
+	memset(oc, 0, sizeof *oc);
+	oc->x = x;
+	oc->width = param->width;
+	oc->height = param->height;
+	oc->scale = 1;
+	oc->transform = param->transform;
+	oc->refresh = param->refresh;
+}
+
+/* Outputs come from [output] sections whose name starts with HL, then
+ * default ones are added up to --output-count. Without an explicit
+ * position, each output goes to the right of the previous one. */
+static int
+headless_compositor_create_outputs(struct headless_compositor *c,
+				   struct headless_parameters *param)
+{
+	struct weston_config_section *section = NULL;
+	struct headless_output_config oc;
+	struct headless_output *output;
+	const char *section_name;
+	int x = 0, count = 0;
+	char *name;
+
+	while (weston_config_next_section(c->base.config,
+					  &section, &section_name)) {
+		if (!section_name || strcmp(section_name, "output") != 0)
+			continue;
+		weston_config_section_get_string(section, "name", &name, NULL);
+		if (name == NULL || name[0] != 'H' || name[1] != 'L') {
+			free(name);
+			continue;
+		}
+
+		headless_output_config_init(&oc, param, x);
+		oc.name = name;
+		headless_output_config_from_section(section, param, &oc);
+
+		output = headless_compositor_create_output(c, &oc);
+		free(name);
+		if (output == NULL)
+			return -1;
+
+		x = pixman_region32_extents(&output->base.region)->x2;
+
+		count++;
+		if (param->output_count && count >= param->output_count)
+			return 0;
+	}
+
+	if (count == 0 && param->output_count == 0)
+		param->output_count = 1;
+
+	for (; count < param->output_count; count++) {
+		headless_output_config_init(&oc, param, x);
+		output = headless_compositor_create_output(c, &oc);
+		if (output == NULL)
+			return -1;
+
+		x = pixman_region32_extents(&output->base.region)->x2;
+	}
+
 	return 0;
 }
 
@@ -234,11 +446,15 @@ headless_compositor_create(struct wl_display *display,
 	c->base.destroy = headless_destroy;
 	c->base.restore = headless_restore;
 
+	c->frame_mode = param->frame_mode;
+	if (c->frame_mode == HEADLESS_FRAME_VIRTUAL)
+		c->base.step_clock = headless_step_clock;
+
 	c->use_pixman = param->use_pixman;
 	if (c->use_pixman) {
 		pixman_renderer_init(&c->base);
 	}
-	if (headless_compositor_create_output(c, param) < 0)
+	if (headless_compositor_create_outputs(c, param) < 0)
 		goto err_input;
 
 	if (!c->use_pixman && noop_renderer_init(&c->base) < 0)
@@ -260,15 +476,20 @@ backend_init(struct wl_display *display, int *argc, char *argv[],
 	     struct weston_config *config)
 {
 	int width = 1024, height = 640;
+	int refresh = 60000, output_count = 0;
 	char *display_name = NULL;
 	struct headless_parameters param = { 0, };
 	const char *transform = "normal";
+	const char *frame_mode = "timer";
 
 	const struct weston_option headless_options[] = {
 		{ WESTON_OPTION_INTEGER, "width", 0, &width },
 		{ WESTON_OPTION_INTEGER, "height", 0, &height },
 		{ WESTON_OPTION_BOOLEAN, "use-pixman", 0, &param.use_pixman },
 		{ WESTON_OPTION_STRING, "transform", 0, &transform },
+		{ WESTON_OPTION_INTEGER, "refresh", 0, &refresh },
+		{ WESTON_OPTION_INTEGER, "output-count", 0, &output_count },
+		{ WESTON_OPTION_STRING, "frame-mode", 0, &frame_mode },
 	};
 
 	parse_options(headless_options,
@@ -276,10 +497,21 @@ backend_init(struct wl_display *display, int *argc, char *argv[],
 
 	param.width = width;
 	param.height = height;
+	param.refresh = refresh > 0 ? refresh : 60000;
+	param.output_count = output_count > 0 ? output_count : 0;
 
 	if (weston_parse_transform(transform, &param.transform) < 0)
 		weston_log("Invalid transform \"%s\"\n", transform);
 
+	if (strcmp(frame_mode, "timer") == 0)
+		param.frame_mode = HEADLESS_FRAME_TIMER;
+	else if (strcmp(frame_mode, "unthrottled") == 0)
+		param.frame_mode = HEADLESS_FRAME_UNTHROTTLED;
+	else if (strcmp(frame_mode, "virtual") == 0)
+		param.frame_mode = HEADLESS_FRAME_VIRTUAL;
+	else
+		weston_log("Invalid frame mode \"%s\"\n", frame_mode);
+
 	return headless_compositor_create(display, &param, display_name,
 					  argc, argv, config);
 }
@@ -54,6 +54,10 @@
 #endif
 
 #include "timeline.h"
+#include "client-stats.h"
+#include "watchdog.h"
+#include "render-stats.h"
+#include "startup-profile.h"
 
 #include "compositor.h"
 #include "scaler-server-protocol.h"
@@ -351,6 +355,9 @@ weston_client_launch(struct weston_compositor *compositor,
 	proc->cleanup = cleanup;
 	weston_watch_process(proc);
 
+	/* Not an application, so not the first client frame either. */
+	STARTUP_HELPER_CLIENT(client);
+
 	return client;
 }
 
@@ -441,6 +448,7 @@ weston_view_create(struct weston_surface *surface)
 	wl_signal_init(&view->destroy_signal);
 	wl_list_init(&view->link);
 	wl_list_init(&view->layer_link.link);
+	wl_list_init(&view->cache.link);
 
 	pixman_region32_init(&view->clip);
 
@@ -455,6 +463,7 @@ weston_view_create(struct weston_surface *surface)
 	pixman_region32_init(&view->geometry.scissor);
 	pixman_region32_init(&view->transform.boundingbox);
 	view->transform.dirty = 1;
+	view->transform.geometry_dirty = 1;
 
 	return view;
 }
@@ -656,7 +665,12 @@ WL_EXPORT void
 weston_view_to_global_float(struct weston_view *view,
 			    float sx, float sy, float *x, float *y)
 {
-	if (view->transform.enabled) {
+	if (view->transform.enabled &&
+	    view->transform.matrix.type == WESTON_MATRIX_TRANSFORM_TRANSLATE) {
+		/* Pure translation, no need for the full projection. */
+		*x = sx + view->transform.matrix.d[12];
+		*y = sy + view->transform.matrix.d[13];
+	} else if (view->transform.enabled) {
 		struct weston_vector v = { { sx, sy, 0.0f, 1.0f } };
 
 		weston_matrix_transform(&view->transform.matrix, &v);
@@ -1127,17 +1141,26 @@ view_compute_bbox(struct weston_view *view, const pixman_box32_t *inbox,
 		return;
 	}
 
-	for (i = 0; i < 4; ++i) {
-		float x, y;
-		weston_view_to_global_float(view, s[i][0], s[i][1], &x, &y);
-		if (x < min_x)
-			min_x = x;
-		if (x > max_x)
-			max_x = x;
-		if (y < min_y)
-			min_y = y;
-		if (y > max_y)
-			max_y = y;
+	if (view->transform.matrix.type == WESTON_MATRIX_TRANSFORM_TRANSLATE) {
+		/* The box stays axis aligned, only offset it. */
+		min_x = inbox->x1 + view->transform.matrix.d[12];
+		max_x = inbox->x2 + view->transform.matrix.d[12];
+		min_y = inbox->y1 + view->transform.matrix.d[13];
+		max_y = inbox->y2 + view->transform.matrix.d[13];
+	} else {
+		for (i = 0; i < 4; ++i) {
+			float x, y;
+			weston_view_to_global_float(view, s[i][0], s[i][1],
+						    &x, &y);
+			if (x < min_x)
+				min_x = x;
+			if (x > max_x)
+				max_x = x;
+			if (y < min_y)
+				min_y = y;
+			if (y > max_y)
+				max_y = y;
+		}
 	}
 
 	int_x = floorf(min_x);
@@ -1211,7 +1234,14 @@ weston_view_update_transform_enable(struct weston_view *view)
 	if (parent)
 		weston_matrix_multiply(matrix, &parent->transform.matrix);
 
-	if (weston_matrix_invert(inverse, matrix) < 0) {
+	if (matrix->type == WESTON_MATRIX_TRANSFORM_TRANSLATE) {
+		/* Common for subsurfaces: the inverse is just the
+		 * negated offset, no need for the general inversion. */
+		*inverse = *matrix;
+		inverse->d[12] = -matrix->d[12];
+		inverse->d[13] = -matrix->d[13];
+		inverse->d[14] = -matrix->d[14];
+	} else if (weston_matrix_invert(inverse, matrix) < 0) {
 		/* Oops, bad total transformation, not invertible */
 		weston_log("error: weston_view %p"
 			" transformation not invertible.\n", view);
@@ -1239,12 +1269,51 @@ get_view_layer(struct weston_view *view)
 	return view->layer_link.layer;
 }
 
+static const pixman_box32_t infinite_mask = {
+	INT32_MIN, INT32_MIN, INT32_MAX, INT32_MAX
+};
+
+static bool
+box_equal(const pixman_box32_t *a, const pixman_box32_t *b)
+{
+	return a->x1 == b->x1 && a->y1 == b->y1 &&
+	       a->x2 == b->x2 && a->y2 == b->y2;
+}
+
+static void
+weston_compositor_damage_pick(struct weston_compositor *compositor,
+			      const pixman_box32_t *box)
+{
+	if (box->x1 >= box->x2 || box->y1 >= box->y2)
+		return;
+
+	pixman_region32_union_rect(&compositor->pick_damage,
+				   &compositor->pick_damage,
+				   box->x1, box->y1,
+				   box->x2 - box->x1, box->y2 - box->y1);
+	compositor->scene_generation++;
+}
+
+static void
+weston_compositor_damage_pick_all(struct weston_compositor *compositor)
+{
+	pixman_region32_fini(&compositor->pick_damage);
+	region_init_infinite(&compositor->pick_damage);
+	compositor->scene_generation++;
+}
+
 WL_EXPORT void
 weston_view_update_transform(struct weston_view *view)
 {
 	struct weston_view *parent = view->geometry.parent;
 	struct weston_layer *layer;
 	pixman_region32_t mask;
+	struct weston_matrix old_matrix;
+	bool old_scissor_enabled;
+	pixman_box32_t old_scissor;
+	pixman_box32_t old_layer_mask;
+	pixman_box32_t old_boundingbox;
+	uint32_t old_generation;
 
 	if (!view->transform.dirty)
 		return;
@@ -1254,6 +1323,25 @@ weston_view_update_transform(struct weston_view *view)
 
 	view->transform.dirty = 0;
 
+	/* Only dirtied through an ancestor which did not end up changing
+	 * anything we inherit: everything cached is still valid.
+	 */
+	if (!view->transform.geometry_dirty && parent &&
+	    view->transform.parent_generation == parent->transform.generation)
+		return;
+
+	view->transform.geometry_dirty = 0;
+	if (parent)
+		view->transform.parent_generation =
+			parent->transform.generation;
+
+	old_matrix = view->transform.matrix;
+	old_scissor_enabled = view->geometry.scissor_enabled;
+	old_scissor = *pixman_region32_extents(&view->geometry.scissor);
+	old_layer_mask = view->transform.layer_mask;
+	old_boundingbox = *pixman_region32_extents(&view->transform.boundingbox);
+	old_generation = view->transform.generation;
+
 	weston_view_damage_below(view);
 
 	pixman_region32_fini(&view->transform.boundingbox);
@@ -1280,8 +1368,16 @@ weston_view_update_transform(struct weston_view *view)
 		pixman_region32_intersect(&view->transform.opaque,
 					  &view->transform.opaque, &mask);
 		pixman_region32_fini(&mask);
+		view->transform.layer_mask = layer->mask;
+	} else {
+		view->transform.layer_mask = infinite_mask;
 	}
 
+	/* Cached views are drawn through the cache, which may blend them
+	 * with its own alpha, so they occlude nothing on their own. */
+	if (view->cache.owner)
+		pixman_region32_clear(&view->transform.opaque);
+
 	if (parent) {
 		if (parent->geometry.scissor_enabled) {
 			view->geometry.scissor_enabled = true;
@@ -1291,6 +1387,26 @@ weston_view_update_transform(struct weston_view *view)
 		}
 	}
 
+	if (memcmp(&old_matrix, &view->transform.matrix,
+		   sizeof old_matrix) != 0 ||
+	    old_scissor_enabled != view->geometry.scissor_enabled ||
+	    (view->geometry.scissor_enabled &&
+	     !box_equal(&old_scissor,
+			pixman_region32_extents(&view->geometry.scissor))) ||
+	    !box_equal(&old_layer_mask, &view->transform.layer_mask))
+		view->transform.generation++;
+
+	/* Views taking no input, like the cursor, never change a pick. */
+	if (pixman_region32_not_empty(&view->surface->input) &&
+	    (old_generation != view->transform.generation ||
+	     !box_equal(&old_boundingbox,
+			pixman_region32_extents(&view->transform.boundingbox)))) {
+		weston_compositor_damage_pick(view->surface->compositor,
+					      &old_boundingbox);
+		weston_compositor_damage_pick(view->surface->compositor,
+			pixman_region32_extents(&view->transform.boundingbox));
+	}
+
 	weston_view_damage_below(view);
 
 	weston_view_assign_output(view);
@@ -1299,15 +1415,15 @@ weston_view_update_transform(struct weston_view *view)
 		       view->surface);
 }
 
-WL_EXPORT void
-weston_view_geometry_dirty(struct weston_view *view)
+static void
+weston_view_mark_transform_dirty(struct weston_view *view)
 {
 	struct weston_view *child;
 
 	/*
-	 * The invariant: if view->geometry.dirty, then all views
-	 * in view->geometry.child_list have geometry.dirty too.
-	 * Corollary: if not parent->geometry.dirty, then all ancestors
+	 * The invariant: if view->transform.dirty, then all views
+	 * in view->geometry.child_list have transform.dirty too.
+	 * Corollary: if not parent->transform.dirty, then all ancestors
 	 * are not dirty.
 	 */
 
@@ -1318,7 +1434,14 @@ weston_view_geometry_dirty(struct weston_view *view)
 
 	wl_list_for_each(child, &view->geometry.child_list,
 			 geometry.parent_link)
-		weston_view_geometry_dirty(child);
+		weston_view_mark_transform_dirty(child);
+}
+
+WL_EXPORT void
+weston_view_geometry_dirty(struct weston_view *view)
+{
+	view->transform.geometry_dirty = 1;
+	weston_view_mark_transform_dirty(view);
 }
 
 WL_EXPORT void
@@ -1340,7 +1463,11 @@ WL_EXPORT void
 weston_view_from_global_float(struct weston_view *view,
 			      float x, float y, float *vx, float *vy)
 {
-	if (view->transform.enabled) {
+	if (view->transform.enabled &&
+	    view->transform.inverse.type == WESTON_MATRIX_TRANSFORM_TRANSLATE) {
+		*vx = x + view->transform.inverse.d[12];
+		*vy = y + view->transform.inverse.d[13];
+	} else if (view->transform.enabled) {
 		struct weston_vector v = { { x, y, 0.0f, 1.0f } };
 
 		weston_matrix_transform(&view->transform.inverse, &v);
@@ -1603,6 +1730,30 @@ weston_surface_set_size(struct weston_surface *surface,
 	surface_set_size(surface, width, height);
 }
 
+/** Replace the input region of a surface
+ *
+ * \param surface The surface
+ * \param region The new input region, in surface coordinates
+ *
+ * Shells must change the input region through here rather than writing
+ * surface->input, so that pointers resting on the surface's views are
+ * picked again at the next repaint.
+ */
+WL_EXPORT void
+weston_surface_set_input_region(struct weston_surface *surface,
+				pixman_region32_t *region)
+{
+	struct weston_view *view;
+
+	if (pixman_region32_equal(region, &surface->input))
+		return;
+
+	pixman_region32_copy(&surface->input, region);
+	wl_list_for_each(view, &surface->views, surface_link)
+		weston_compositor_damage_pick(surface->compositor,
+			pixman_region32_extents(&view->transform.boundingbox));
+}
+
 static int
 fixed_round_up_to_int(wl_fixed_t f)
 {
@@ -1716,12 +1867,34 @@ static void
 weston_compositor_repick(struct weston_compositor *compositor)
 {
 	struct weston_seat *seat;
+	struct weston_pointer *pointer;
+	uint32_t generation = compositor->scene_generation;
 
 	if (!compositor->session_active)
 		return;
 
-	wl_list_for_each(seat, &compositor->seat_list, link)
-		weston_seat_repick(seat);
+	if (compositor->repick_generation == generation)
+		return;
+
+	/* Pointer motion picks on its own; only a pointer resting in an
+	 * area where the scene changed needs a new pick here. */
+	wl_list_for_each(seat, &compositor->seat_list, link) {
+		pointer = seat->pointer;
+		if (pointer &&
+		    pixman_region32_contains_point(&compositor->pick_damage,
+						   wl_fixed_to_int(pointer->x),
+						   wl_fixed_to_int(pointer->y),
+						   NULL))
+			weston_seat_repick(seat);
+	}
+
+	/* A grab focus handler may have changed the scene again; keep
+	 * that for the next repick. */
+	if (compositor->scene_generation != generation)
+		return;
+
+	pixman_region32_clear(&compositor->pick_damage);
+	compositor->repick_generation = generation;
 }
 
 WL_EXPORT void
@@ -1733,6 +1906,8 @@ weston_view_unmap(struct weston_view *view)
 		return;
 
 	weston_view_damage_below(view);
+	weston_compositor_damage_pick(view->surface->compositor,
+			pixman_region32_extents(&view->transform.boundingbox));
 	view->output = NULL;
 	view->plane = NULL;
 	weston_layer_entry_remove(&view->layer_link);
@@ -1789,6 +1964,9 @@ weston_view_destroy(struct weston_view *view)
 		weston_compositor_build_view_list(view->surface->compositor);
 	}
 
+	if (view->cache.owner)
+		weston_view_cache_remove_view(view);
+
 	wl_list_remove(&view->link);
 	weston_layer_entry_remove(&view->layer_link);
 
@@ -1849,12 +2027,27 @@ destroy_surface(struct wl_resource *resource)
 	weston_surface_destroy(surface);
 }
 
+static int64_t
+shm_buffer_bytes(struct wl_resource *resource)
+{
+	struct wl_shm_buffer *shm_buffer = wl_shm_buffer_get(resource);
+
+	if (!shm_buffer)
+		return 0;
+
+	return (int64_t)wl_shm_buffer_get_stride(shm_buffer) *
+		wl_shm_buffer_get_height(shm_buffer);
+}
+
 static void
 weston_buffer_destroy_handler(struct wl_listener *listener, void *data)
 {
 	struct weston_buffer *buffer =
 		container_of(listener, struct weston_buffer, destroy_listener);
 
+	weston_client_stats_account_shm(wl_resource_get_client(buffer->resource),
+					-shm_buffer_bytes(buffer->resource));
+
 	wl_signal_emit(&buffer->destroy_signal, buffer);
 	free(buffer);
 }
@@ -1882,6 +2075,9 @@ weston_buffer_from_resource(struct wl_resource *resource)
 	buffer->y_inverted = 1;
 	wl_resource_add_destroy_listener(resource, &buffer->destroy_listener);
 
+	weston_client_stats_account_shm(wl_resource_get_client(resource),
+					shm_buffer_bytes(resource));
+
 	return buffer;
 }
 
@@ -1961,9 +2157,17 @@ weston_output_damage(struct weston_output *output)
 static void
 surface_flush_damage(struct weston_surface *surface)
 {
+	uint64_t begin;
+
 	if (surface->buffer_ref.buffer &&
-	    wl_shm_buffer_get(surface->buffer_ref.buffer->resource))
+	    wl_shm_buffer_get(surface->buffer_ref.buffer->resource)) {
+		begin = weston_client_stats_now();
+		RENDER_STATS_UPLOAD(surface);
 		surface->compositor->renderer->flush_damage(surface);
+		if (surface->resource)
+			CLIENT_STATS_TIME(wl_resource_get_client(surface->resource),
+					  CLIENT_STATS_UPLOAD, begin);
+	}
 
 	if (weston_timeline_enabled_ &&
 	    pixman_region32_not_empty(&surface->damage))
@@ -1979,6 +2183,10 @@ view_accumulate_damage(struct weston_view *view,
 {
 	pixman_region32_t damage;
 
+	if (view->cache.owner &&
+	    pixman_region32_not_empty(&view->surface->damage))
+		view->cache.owner->dirty = 1;
+
 	pixman_region32_init(&damage);
 	if (view->transform.enabled) {
 		pixman_box32_t *extents;
@@ -2158,6 +2366,7 @@ weston_compositor_build_view_list(struct weston_compositor *compositor)
 {
 	struct weston_view *view;
 	struct weston_layer *layer;
+	uint64_t signature;
 
 	wl_list_for_each(layer, &compositor->layer_list, link)
 		wl_list_for_each(view, &layer->view_list.link, layer_link.link)
@@ -2173,6 +2382,16 @@ weston_compositor_build_view_list(struct weston_compositor *compositor)
 	wl_list_for_each(layer, &compositor->layer_list, link)
 		wl_list_for_each(view, &layer->view_list.link, layer_link.link)
 			surface_free_unused_subsurface_views(view->surface);
+
+	/* Any restacking, mapping or unmapping may change any pick. */
+	signature = 0;
+	wl_list_for_each(view, &compositor->view_list, link)
+		signature = signature * 31 + (uintptr_t) view;
+
+	if (signature != compositor->view_list_signature) {
+		compositor->view_list_signature = signature;
+		weston_compositor_damage_pick_all(compositor);
+	}
 }
 
 static void
@@ -2200,6 +2419,21 @@ weston_output_take_feedback_list(struct weston_output *output,
 	wl_list_init(&surface->feedback_list);
 }
 
+WL_EXPORT void
+weston_repaint_stats_enable(struct weston_compositor *compositor)
+{
+	compositor->repaint_stats_enabled = 1;
+}
+
+static uint64_t
+repaint_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 static int
 weston_output_repaint(struct weston_output *output)
 {
@@ -2209,13 +2443,19 @@ weston_output_repaint(struct weston_output *output)
 	struct weston_frame_callback *cb, *cnext;
 	struct wl_list frame_callback_list;
 	pixman_region32_t output_damage;
+	uint64_t begin = 0, duration;
+	int timed = ec->repaint_stats_enabled || weston_watchdog_armed_;
 	int r;
 
 	if (output->destroying)
 		return 0;
 
+	if (timed)
+		begin = repaint_clock_ns();
 	TL_POINT("core_repaint_begin", TLP_OUTPUT(output), TLP_END);
 
+	weston_compositor_flush_motion(ec);
+
 	/* Rebuild the surface list and update surface transforms up front. */
 	weston_compositor_build_view_list(ec);
 
@@ -2243,6 +2483,7 @@ weston_output_repaint(struct weston_output *output)
 	}
 
 	compositor_accumulate_damage(ec);
+	weston_compositor_update_view_caches(ec, output);
 
 	pixman_region32_init(&output_damage);
 	pixman_region32_intersect(&output_damage,
@@ -2253,7 +2494,9 @@ weston_output_repaint(struct weston_output *output)
 	if (output->dirty)
 		weston_output_update_matrix(output);
 
+	RENDER_STATS_REPAINT(output, &output_damage);
 	r = output->repaint(output, &output_damage);
+	STARTUP_REPAINT(output);
 
 	pixman_region32_fini(&output_damage);
 
@@ -2274,6 +2517,15 @@ weston_output_repaint(struct weston_output *output)
 
 	TL_POINT("core_repaint_posted", TLP_OUTPUT(output), TLP_END);
 
+	output->repaint_stats.count++;
+	if (timed) {
+		duration = repaint_clock_ns() - begin;
+		output->repaint_stats.time_ns += duration;
+		if (duration > output->repaint_stats.max_ns)
+			output->repaint_stats.max_ns = duration;
+		WATCHDOG_CHECK_REPAINT(output, duration);
+	}
+
 	return r;
 }
 
@@ -2436,6 +2688,7 @@ weston_compositor_schedule_repaint(struct weston_compositor *compositor)
 static void
 surface_destroy(struct wl_client *client, struct wl_resource *resource)
 {
+	CLIENT_STATS_SURFACE_REQUEST(client);
 	wl_resource_destroy(resource);
 }
 
@@ -2447,6 +2700,8 @@ surface_attach(struct wl_client *client,
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
 	struct weston_buffer *buffer = NULL;
 
+	CLIENT_STATS_SURFACE_REQUEST(client);
+
 	if (buffer_resource) {
 		buffer = weston_buffer_from_resource(buffer_resource);
 		if (buffer == NULL) {
@@ -2470,10 +2725,15 @@ surface_damage(struct wl_client *client,
 	       int32_t x, int32_t y, int32_t width, int32_t height)
 {
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
+	uint64_t begin = weston_client_stats_now();
+
+	CLIENT_STATS_SURFACE_REQUEST(client);
 
 	pixman_region32_union_rect(&surface->pending.damage,
 				   &surface->pending.damage,
 				   x, y, width, height);
+
+	CLIENT_STATS_TIME(client, CLIENT_STATS_DAMAGE, begin);
 }
 
 static void
@@ -2492,6 +2752,8 @@ surface_frame(struct wl_client *client,
 	struct weston_frame_callback *cb;
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
 
+	CLIENT_STATS_SURFACE_REQUEST(client);
+
 	cb = malloc(sizeof *cb);
 	if (cb == NULL) {
 		wl_resource_post_no_memory(resource);
@@ -2520,6 +2782,8 @@ surface_set_opaque_region(struct wl_client *client,
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
 	struct weston_region *region;
 
+	CLIENT_STATS_SURFACE_REQUEST(client);
+
 	if (region_resource) {
 		region = wl_resource_get_user_data(region_resource);
 		pixman_region32_copy(&surface->pending.opaque,
@@ -2537,6 +2801,8 @@ surface_set_input_region(struct wl_client *client,
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
 	struct weston_region *region;
 
+	CLIENT_STATS_SURFACE_REQUEST(client);
+
 	if (region_resource) {
 		region = wl_resource_get_user_data(region_resource);
 		pixman_region32_copy(&surface->pending.input,
@@ -2565,6 +2831,7 @@ weston_surface_commit_state(struct weston_surface *surface,
 {
 	struct weston_view *view;
 	pixman_region32_t opaque;
+	pixman_region32_t input;
 
 	/* wl_surface.set_buffer_transform */
 	/* wl_surface.set_buffer_scale */
@@ -2611,9 +2878,13 @@ weston_surface_commit_state(struct weston_surface *surface,
 	pixman_region32_fini(&opaque);
 
 	/* wl_surface.set_input_region */
-	pixman_region32_intersect_rect(&surface->input, &state->input,
+	pixman_region32_init(&input);
+	pixman_region32_intersect_rect(&input, &state->input,
 				       0, 0, surface->width, surface->height);
 
+	weston_surface_set_input_region(surface, &input);
+	pixman_region32_fini(&input);
+
 	/* wl_surface.frame */
 	wl_list_insert_list(&surface->frame_callback_list,
 			    &state->frame_callback_list);
@@ -2652,18 +2923,23 @@ surface_commit(struct wl_client *client, struct wl_resource *resource)
 {
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
 	struct weston_subsurface *sub = weston_surface_to_subsurface(surface);
+	uint64_t begin = weston_client_stats_now();
+
+	CLIENT_STATS_SURFACE_REQUEST(client);
+	STARTUP_CLIENT_COMMIT(surface);
 
 	if (sub) {
 		weston_subsurface_commit(sub);
-		return;
-	}
-
-	weston_surface_commit(surface);
+	} else {
+		weston_surface_commit(surface);
 
-	wl_list_for_each(sub, &surface->subsurface_list, parent_link) {
-		if (sub->surface != surface)
-			weston_subsurface_parent_commit(sub, 0);
+		wl_list_for_each(sub, &surface->subsurface_list, parent_link) {
+			if (sub->surface != surface)
+				weston_subsurface_parent_commit(sub, 0);
+		}
 	}
+
+	CLIENT_STATS_TIME(client, CLIENT_STATS_COMMIT, begin);
 }
 
 static void
@@ -2672,6 +2948,8 @@ surface_set_buffer_transform(struct wl_client *client,
 {
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
 
+	CLIENT_STATS_SURFACE_REQUEST(client);
+
 	/* if wl_output.transform grows more members this will need to be updated. */
 	if (transform < 0 ||
 	    transform > WL_OUTPUT_TRANSFORM_FLIPPED_270) {
@@ -2693,6 +2971,8 @@ surface_set_buffer_scale(struct wl_client *client,
 {
 	struct weston_surface *surface = wl_resource_get_user_data(resource);
 
+	CLIENT_STATS_SURFACE_REQUEST(client);
+
 	if (scale < 1) {
 		wl_resource_post_error(resource,
 			WL_SURFACE_ERROR_INVALID_SCALE,
@@ -4424,6 +4704,7 @@ weston_compositor_init(struct weston_compositor *ec,
 
 	wl_list_init(&ec->view_list);
 	wl_list_init(&ec->plane_list);
+	wl_list_init(&ec->view_cache_list);
 	wl_list_init(&ec->layer_list);
 	wl_list_init(&ec->seat_list);
 	wl_list_init(&ec->output_list);
@@ -4437,6 +4718,8 @@ weston_compositor_init(struct weston_compositor *ec,
 	weston_plane_init(&ec->primary_plane, ec, 0, 0);
 	weston_compositor_stack_plane(ec, &ec->primary_plane, NULL);
 
+	pixman_region32_init(&ec->pick_damage);
+
 	s = weston_config_get_section(ec->config, "keyboard", NULL, NULL);
 	weston_config_section_get_string(s, "keymap_rules",
 					 (char **) &xkb_names.rules, NULL);
@@ -4448,6 +4731,8 @@ weston_compositor_init(struct weston_compositor *ec,
 					 (char **) &xkb_names.variant, NULL);
 	weston_config_section_get_string(s, "keymap_options",
 					 (char **) &xkb_names.options, NULL);
+	weston_config_section_get_bool(s, "keymap-cache",
+				       &ec->use_keymap_cache, 1);
 
 	if (weston_compositor_xkb_init(ec, &xkb_names) < 0)
 		return -1;
@@ -4457,6 +4742,10 @@ weston_compositor_init(struct weston_compositor *ec,
 	weston_config_section_get_int(s, "repeat-delay",
 				      &ec->kb_repeat_delay, 400);
 
+	s = weston_config_get_section(ec->config, "core", NULL, NULL);
+	weston_config_section_get_bool(s, "coalesce-motion",
+				       &ec->coalesce_motion, 0);
+
 	text_backend_init(ec);
 
 	wl_data_device_manager_init(ec->wl_display);
@@ -4475,6 +4764,9 @@ weston_compositor_init(struct weston_compositor *ec,
 	weston_compositor_add_debug_binding(ec, KEY_T,
 					    timeline_key_binding_handler, ec);
 
+	weston_client_stats_init(ec);
+	weston_watchdog_init(ec);
+
 	weston_compositor_schedule_repaint(ec);
 
 	return 0;
@@ -4503,6 +4795,7 @@ weston_compositor_shutdown(struct weston_compositor *ec)
 	weston_binding_list_destroy_all(&ec->debug_binding_list);
 
 	weston_plane_release(&ec->primary_plane);
+	pixman_region32_fini(&ec->pick_damage);
 
 	wl_event_loop_destroy(ec->input_loop);
 
@@ -4639,8 +4932,46 @@ static int on_term_signal(int signal_number, void *data)
 	return 1;
 }
 
+void
+weston_backtrace_print(void *const *ips, int count)
+{
+	int i;
+	Dl_info info;
+
+	for (i = 0; i < count; i++) {
+		if (!dladdr(ips[i], &info))
+			memset(&info, 0, sizeof info);
+		weston_log("  [%016lx]  %s  (%s)\n",
+			(long) ips[i],
+			info.dli_sname ? info.dli_sname : "--",
+			info.dli_fname ? info.dli_fname : "?");
+	}
+}
+
 #ifdef HAVE_LIBUNWIND
 
+/* Only records instruction pointers, so that it can be used from a
+ * signal handler; symbols are resolved by weston_backtrace_print(). */
+int
+weston_backtrace_capture(void **ips, int max)
+{
+	unw_cursor_t cursor;
+	unw_context_t context;
+	unw_word_t ip;
+	int count = 0;
+
+	if (unw_getcontext(&context) || unw_init_local(&cursor, &context))
+		return 0;
+
+	while (count < max && unw_step(&cursor) > 0) {
+		if (unw_get_reg(&cursor, UNW_REG_IP, &ip))
+			break;
+		ips[count++] = (void *)ip;
+	}
+
+	return count;
+}
+
 static void
 print_backtrace(void)
 {
@@ -4699,21 +5030,20 @@ print_backtrace(void)
 
 #else
 
+int
+weston_backtrace_capture(void **ips, int max)
+{
+	return backtrace(ips, max);
+}
+
 static void
 print_backtrace(void)
 {
 	void *buffer[32];
-	int i, count;
-	Dl_info info;
+	int count;
 
-	count = backtrace(buffer, ARRAY_LENGTH(buffer));
-	for (i = 0; i < count; i++) {
-		dladdr(buffer[i], &info);
-		weston_log("  [%016lx]  %s  (%s)\n",
-			(long) buffer[i],
-			info.dli_sname ? info.dli_sname : "--",
-			info.dli_fname);
-	}
+	count = weston_backtrace_capture(buffer, ARRAY_LENGTH(buffer));
+	weston_backtrace_print(buffer, count);
 }
 
 #endif
@@ -4729,6 +5059,7 @@ on_caught_signal(int s, siginfo_t *siginfo, void *context)
 	 * will allow weston to switch back to gdb on crash and then
 	 * gdb will catch the crash with SIGTRAP.*/
 
+	weston_log_flush();
 	weston_log("caught signal: %d\n", s);
 
 	print_backtrace();
@@ -4784,6 +5115,7 @@ load_modules(struct weston_compositor *ec, const char *modules,
 	char buffer[256];
 	int (*module_init)(struct weston_compositor *ec,
 			   int *argc, char *argv[]);
+	uint64_t begin;
 
 	if (modules == NULL)
 		return 0;
@@ -4792,11 +5124,13 @@ load_modules(struct weston_compositor *ec, const char *modules,
 	while (*p) {
 		end = strchrnul(p, ',');
 		snprintf(buffer, sizeof buffer, "%.*s", (int) (end - p), p);
+		begin = weston_startup_begin();
 		module_init = weston_load_module(buffer, "module_init");
 		if (!module_init)
 			return -1;
 		if (module_init(ec, argc, argv) < 0)
 			return -1;
+		weston_startup_end("module", buffer, begin);
 		p = end;
 		while (*p == ',')
 			p++;
@@ -4962,7 +5296,11 @@ usage(int error_code)
 		"  --height=HEIGHT\tHeight of memory surface\n"
 		"  --transform=TR\tThe output transformation, TR is one of:\n"
 		"\tnormal 90 180 270 flipped flipped-90 flipped-180 flipped-270\n"
-		"  --use-pixman\t\tUse the pixman (CPU) renderer (default: no rendering)\n\n");
+		"  --use-pixman\t\tUse the pixman (CPU) renderer (default: no rendering)\n"
+		"  --refresh=RATE\tRefresh rate in mHz (default: 60000)\n"
+		"  --output-count=COUNT\tCreate multiple outputs\n"
+		"  --frame-mode=MODE\tHow frames complete, MODE is one of:\n"
+		"\ttimer (default), unthrottled, virtual\n\n");
 #endif
 
 	exit(error_code);
@@ -5082,8 +5420,10 @@ int main(int argc, char *argv[])
 	char *modules = NULL;
 	char *option_modules = NULL;
 	char *log = NULL;
+	char *log_overflow = NULL;
 	char *server_socket = NULL, *end;
 	int32_t idle_time = -1;
+	int32_t log_buffer;
 	int32_t help = 0;
 	char *socket_name = NULL;
 	int32_t version = 0;
@@ -5094,6 +5434,7 @@ int main(int argc, char *argv[])
 	struct wl_client *primary_client;
 	struct wl_listener primary_client_destroyed;
 	struct weston_seat *seat;
+	uint64_t begin;
 
 	const struct weston_option core_options[] = {
 		{ WESTON_OPTION_STRING, "backend", 'B', &backend },
@@ -5107,6 +5448,8 @@ int main(int argc, char *argv[])
 		{ WESTON_OPTION_BOOLEAN, "no-config", 0, &noconfig },
 	};
 
+	weston_startup_init();
+
 	parse_options(core_options, ARRAY_LENGTH(core_options), &argc, argv);
 
 	if (help)
@@ -5148,8 +5491,10 @@ int main(int argc, char *argv[])
 		goto out_signals;
 	}
 
+	begin = weston_startup_begin();
 	if (noconfig == 0)
 		config = weston_config_parse("weston.ini");
+	weston_startup_end("config", NULL, begin);
 	if (config != NULL) {
 		weston_log("Using config file '%s'\n",
 			   weston_config_get_full_path(config));
@@ -5158,6 +5503,14 @@ int main(int argc, char *argv[])
 	}
 	section = weston_config_get_section(config, "core", NULL, NULL);
 
+	weston_config_section_get_int(section, "log-buffer", &log_buffer, 0);
+	weston_config_section_get_string(section, "log-overflow",
+					 &log_overflow, "drop");
+	if (log_buffer > 0)
+		weston_log_async_start((size_t)log_buffer * 1024,
+				       strcmp(log_overflow, "block") == 0);
+	free(log_overflow);
+
 	if (!backend) {
 		weston_config_section_get_string(section, "backend", &backend,
 						 NULL);
@@ -5165,18 +5518,22 @@ int main(int argc, char *argv[])
 			backend = weston_choose_default_backend();
 	}
 
+	begin = weston_startup_begin();
 	backend_init = weston_load_module(backend, "backend_init");
 	if (!backend_init) {
 		ret = EXIT_FAILURE;
 		goto out_signals;
 	}
+	weston_startup_end("backend load", backend, begin);
 
+	begin = weston_startup_begin();
 	ec = backend_init(display, &argc, argv, config);
 	if (ec == NULL) {
 		weston_log("fatal: failed to create compositor\n");
 		ret = EXIT_FAILURE;
 		goto out_signals;
 	}
+	weston_startup_end("backend init", backend, begin);
 
 	catch_signals();
 	segv_compositor = ec;
@@ -5251,6 +5608,7 @@ int main(int argc, char *argv[])
 
 	weston_compositor_wake(ec);
 
+	weston_startup_mark("main loop");
 	wl_display_run(display);
 
 	/* Allow for setting return exit code after
@@ -5262,6 +5620,8 @@ int main(int argc, char *argv[])
 	ret = ec->exit_code;
 
 out:
+	weston_startup_report();
+
 	/* prevent further rendering while shutting down */
 	ec->state = WESTON_COMPOSITOR_OFFSCREEN;
 
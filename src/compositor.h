@@ -176,6 +176,17 @@ enum dpms_enum {
 	WESTON_DPMS_OFF
 };
 
+struct weston_render_stats {
+	uint32_t frames;	/* repaints recorded so far */
+	uint32_t views;		/* views with something to draw */
+	uint32_t opaque_rects;	/* rectangles drawn with the source operator */
+	uint32_t blended_rects;	/* rectangles blended over what is below */
+	uint64_t opaque_pixels;
+	uint64_t blended_pixels;
+	uint64_t damage_pixels;	/* size of the repainted damage */
+	uint64_t upload_bytes;	/* shm data flushed to the renderer */
+};
+
 struct weston_output {
 	uint32_t id;
 	char *name;
@@ -208,6 +219,18 @@ struct weston_output {
 	int destroying;
 	struct wl_list feedback_list;
 
+	/* Time spent in weston_output_repaint(), accumulated while
+	 * weston_repaint_stats_enable() or the watchdog is in effect. */
+	struct {
+		uint32_t count;
+		uint64_t time_ns;
+		uint64_t max_ns;
+	} repaint_stats;
+
+	/* Work handed to the renderer in the last repaint, while
+	 * weston_render_stats_enable() is in effect. */
+	struct weston_render_stats render_stats;
+
 	char *make, *model, *serial_number;
 	uint32_t subpixel;
 	uint32_t transform;
@@ -318,7 +341,6 @@ struct weston_data_source {
 struct weston_pointer {
 	struct weston_seat *seat;
 
-	struct wl_list resource_list;
 	struct wl_list focus_resource_list;
 	struct weston_view *focus;
 	uint32_t focus_serial;
@@ -342,6 +364,11 @@ struct weston_pointer {
 	wl_fixed_t sx, sy;
 	uint32_t button_count;
 
+	/* Latest position while motion is being coalesced */
+	int motion_pending;
+	uint32_t motion_time;
+	wl_fixed_t motion_x, motion_y;
+
 	struct wl_listener output_destroy_listener;
 };
 
@@ -349,7 +376,6 @@ struct weston_pointer {
 struct weston_touch {
 	struct weston_seat *seat;
 
-	struct wl_list resource_list;
 	struct wl_list focus_resource_list;
 	struct weston_view *focus;
 	struct wl_listener focus_view_listener;
@@ -466,7 +492,6 @@ struct weston_xkb_info {
 struct weston_keyboard {
 	struct weston_seat *seat;
 
-	struct wl_list resource_list;
 	struct wl_list focus_resource_list;
 	struct weston_surface *focus;
 	struct wl_listener focus_resource_listener;
@@ -501,6 +526,7 @@ struct weston_keyboard {
 
 struct weston_seat {
 	struct wl_list base_resource_list;
+	struct wl_list client_list; /* unfocused device resources per client */
 
 	struct wl_global *global;
 	struct weston_pointer *pointer;
@@ -561,6 +587,8 @@ struct weston_plane {
 	struct wl_list link;
 };
 
+struct weston_view_cache;
+
 struct weston_renderer {
 	int (*read_pixels)(struct weston_output *output,
 			       pixman_format_code_t format, void *pixels,
@@ -585,6 +613,10 @@ struct weston_renderer {
 				    void *target, size_t size,
 				    int src_x, int src_y,
 				    int width, int height);
+
+	/** See weston_view_cache; NULL if the renderer cannot cache */
+	int (*view_cache_render)(struct weston_view_cache *cache,
+				 struct weston_output *output);
 };
 
 enum weston_capability {
@@ -643,6 +675,7 @@ struct weston_compositor {
 	struct wl_list layer_list;
 	struct wl_list view_list;
 	struct wl_list plane_list;
+	struct wl_list view_cache_list;
 	struct wl_list key_binding_list;
 	struct wl_list modifier_binding_list;
 	struct wl_list button_binding_list;
@@ -659,6 +692,14 @@ struct weston_compositor {
 
 	/* Repaint state. */
 	struct weston_plane primary_plane;
+
+	/* Pick state: scene_generation is bumped whenever what lies
+	 * under a point may have changed, and pick_damage collects where
+	 * (in global coords) since the last repick. */
+	uint32_t scene_generation;
+	uint32_t repick_generation;
+	pixman_region32_t pick_damage;
+	uint64_t view_list_signature;
 	uint32_t capabilities; /* combination of enum weston_capability */
 
 	struct weston_renderer *renderer;
@@ -668,6 +709,9 @@ struct weston_compositor {
 	void (*destroy)(struct weston_compositor *ec);
 	void (*restore)(struct weston_compositor *ec);
 	int (*authenticate)(struct weston_compositor *c, uint32_t id);
+	/* Only set by backends with a virtual presentation clock; advances
+	 * it by the given number of refresh periods. */
+	void (*step_clock)(struct weston_compositor *c, uint32_t frames);
 
 	struct weston_launcher *launcher;
 
@@ -679,10 +723,18 @@ struct weston_compositor {
 
 	/* Raw keyboard processing (no libxkbcommon initialization or handling) */
 	int use_xkbcommon;
+	/* Load and store the compiled global keymap in the keymap cache */
+	int use_keymap_cache;
 
 	int32_t kb_repeat_rate;
 	int32_t kb_repeat_delay;
 
+	/* Deliver pointer motion once per repaint instead of per event */
+	int coalesce_motion;
+
+	/* Time every output repaint, see weston_repaint_stats_enable() */
+	int repaint_stats_enabled;
+
 	clockid_t presentation_clock;
 
 	int exit_code;
@@ -766,6 +818,13 @@ struct weston_region {
  * view will be the parent's total transformation and this transformation
  * combined:
  *    Mparent * Mn * ... * M2 * M1
+ *
+ * Marking a parent dirty marks all its transform children dirty too, but
+ * a child only recomputes its derived state if its own geometry was
+ * dirtied or view->transform.generation of the parent moved on since the
+ * child was last updated. The parent's generation is bumped only when
+ * something the children inherit (the total matrix, the scissor or the
+ * layer mask) actually changed.
  */
 
 struct weston_view {
@@ -811,6 +870,11 @@ struct weston_view {
 	 */
 	struct {
 		int dirty;
+		int geometry_dirty; /* dirtied directly, not via the parent */
+
+		/* Inherited state serial, see above */
+		uint32_t generation;
+		uint32_t parent_generation;
 
 		/* Approximations in global coordinates:
 		 * - boundingbox is guaranteed to include the whole view in
@@ -829,6 +893,9 @@ struct weston_view {
 		struct weston_matrix inverse;
 
 		struct weston_transform position; /* matrix from x, y */
+
+		/* layer mask applied at the last update */
+		pixman_box32_t layer_mask;
 	} transform;
 
 	/*
@@ -846,6 +913,42 @@ struct weston_view {
 
 	/* Per-surface Presentation feedback flags, controlled by backend. */
 	uint32_t psf_flags;
+
+	/* Managed by weston_view_cache_set_views() */
+	struct {
+		struct weston_view_cache *owner;
+		struct wl_list link;		/* weston_view_cache::view_list */
+		struct weston_matrix matrix;	/* relative, at the last render */
+		float alpha;			/* at the last render */
+	} cache;
+};
+
+/** Views composited as one offscreen image
+ *
+ * The member views stay in the view list, so they keep their outputs,
+ * frame callbacks and input, but the renderers and plane assignment
+ * skip them. Instead the image is drawn through the cache's own view,
+ * which its owner places right above the members. The image is only
+ * rendered again when a member is damaged, joins or leaves, or moves
+ * or fades relative to the cache position; moving the cache or
+ * changing its alpha reuses the image. Views with subsurfaces are never
+ * members, as their subsurfaces would end up below the image.
+ */
+struct weston_view_cache {
+	struct weston_compositor *compositor;
+	struct wl_list link;		/* weston_compositor::view_cache_list */
+
+	struct weston_surface *surface;	/* holds the image */
+	struct weston_view *view;	/* draws the image */
+	struct wl_list view_list;	/* weston_view::cache.link, bottom first */
+
+	int32_t x, y;			/* see weston_view_cache_set_position() */
+	int32_t image_x, image_y;	/* image offset from x, y */
+	int dirty;
+
+	uint32_t hits;			/* repaints that reused the image */
+	uint32_t misses;		/* repaints that rendered it again */
+	size_t bytes;			/* size of the image */
 };
 
 struct weston_surface_state {
@@ -1271,9 +1374,37 @@ void
 weston_surface_set_size(struct weston_surface *surface,
 			int32_t width, int32_t height);
 
+void
+weston_surface_set_input_region(struct weston_surface *surface,
+				pixman_region32_t *region);
+
 void
 weston_surface_schedule_repaint(struct weston_surface *surface);
 
+struct weston_view_cache *
+weston_view_cache_create(struct weston_compositor *compositor);
+
+void
+weston_view_cache_destroy(struct weston_view_cache *cache);
+
+void
+weston_view_cache_set_views(struct weston_view_cache *cache,
+			    struct weston_view **views, int count);
+
+void
+weston_view_cache_set_position(struct weston_view_cache *cache,
+			       int32_t x, int32_t y);
+
+void
+weston_view_cache_set_alpha(struct weston_view_cache *cache, float alpha);
+
+void
+weston_view_cache_remove_view(struct weston_view *view);
+
+void
+weston_compositor_update_view_caches(struct weston_compositor *compositor,
+				     struct weston_output *output);
+
 void
 weston_surface_damage(struct weston_surface *surface);
 
@@ -1313,6 +1444,10 @@ weston_surface_copy_content(struct weston_surface *surface,
 			    int src_x, int src_y,
 			    int width, int height);
 
+void
+weston_client_stats_account_texture(struct weston_surface *surface,
+				    int64_t delta);
+
 struct weston_buffer *
 weston_buffer_from_resource(struct wl_resource *resource);
 
@@ -1384,6 +1519,8 @@ weston_compositor_xkb_init(struct weston_compositor *ec,
 			   struct xkb_rule_names *names);
 void
 weston_compositor_xkb_destroy(struct weston_compositor *ec);
+void
+weston_compositor_flush_motion(struct weston_compositor *compositor);
 
 /* String literal of spaces, the same width as the timestamp. */
 #define STAMP_SPACE "               "
@@ -1392,6 +1529,10 @@ void
 weston_log_file_open(const char *filename);
 void
 weston_log_file_close(void);
+void
+weston_log_async_start(size_t size, int block);
+void
+weston_log_flush(void);
 int
 weston_vlog(const char *fmt, va_list ap);
 int
@@ -1431,6 +1572,18 @@ enum weston_screenshooter_outcome {
 
 typedef void (*weston_screenshooter_done_func_t)(void *data,
 				enum weston_screenshooter_outcome outcome);
+void
+weston_render_stats_enable(struct weston_compositor *compositor);
+
+void
+weston_repaint_stats_enable(struct weston_compositor *compositor);
+
+uint64_t
+weston_startup_begin(void);
+
+void
+weston_startup_end(const char *phase, const char *detail, uint64_t begin);
+
 int
 weston_screenshooter_shoot(struct weston_output *output, struct weston_buffer *buffer,
 			   weston_screenshooter_done_func_t done, void *data);
@@ -110,6 +110,12 @@ struct gl_surface_state {
 	int height; /* in pixels */
 	int y_inverted;
 
+	/* SHM texture storage, for per-client accounting */
+	int64_t texture_bytes;
+
+	/* Renders into textures[0], for weston_view_cache surfaces */
+	GLuint fbo;
+
 	struct weston_surface *surface;
 
 	struct wl_listener surface_destroy_listener;
@@ -551,11 +557,13 @@ static void
 use_shader(struct gl_renderer *gr, struct gl_shader *shader)
 {
 	if (!shader->program) {
+		uint64_t begin = weston_startup_begin();
 		int ret;
 
 		ret =  shader_init(shader, gr,
 				   shader->vertex_source,
 				   shader->fragment_source);
+		weston_startup_end("shader compile", NULL, begin);
 
 		if (ret < 0)
 			weston_log("warning: failed to compile shader\n");
@@ -570,13 +578,13 @@ use_shader(struct gl_renderer *gr, struct gl_shader *shader)
 static void
 shader_uniforms(struct gl_shader *shader,
 		struct weston_view *view,
-		struct weston_output *output)
+		const struct weston_matrix *proj)
 {
 	int i;
 	struct gl_surface_state *gs = get_surface_state(view->surface);
 
 	glUniformMatrix4fv(shader->proj_uniform,
-			   1, GL_FALSE, output->matrix.d);
+			   1, GL_FALSE, proj->d);
 	glUniform4fv(shader->color_uniform, 1, gs->color);
 	glUniform1f(shader->alpha_uniform, view->alpha);
 
@@ -584,15 +592,16 @@ shader_uniforms(struct gl_shader *shader,
 		glUniform1i(shader->tex_uniforms[i], i);
 }
 
+/* Draws the repaint region of the view, in global coordinates, with the
+ * given projection. Scaled tells that the target does not sample the
+ * buffer 1:1 even without a view transformation. */
 static void
-draw_view(struct weston_view *ev, struct weston_output *output,
-	  pixman_region32_t *damage) /* in global coordinates */
+draw_view_region(struct weston_view *ev, const struct weston_matrix *proj,
+		 int scaled, pixman_region32_t *repaint)
 {
 	struct weston_compositor *ec = ev->surface->compositor;
 	struct gl_renderer *gr = get_renderer(ec);
 	struct gl_surface_state *gs = get_surface_state(ev->surface);
-	/* repaint bounding region in global coordinates: */
-	pixman_region32_t repaint;
 	/* opaque region in surface coordinates: */
 	pixman_region32_t surface_opaque;
 	/* non-opaque region in surface coordinates: */
@@ -600,32 +609,17 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 	GLint filter;
 	int i;
 
-	/* In case of a runtime switch of renderers, we may not have received
-	 * an attach for this surface since the switch. In that case we don't
-	 * have a valid buffer or a proper shader set up so skip rendering. */
-	if (!gs->shader)
-		return;
-
-	pixman_region32_init(&repaint);
-	pixman_region32_intersect(&repaint,
-				  &ev->transform.boundingbox, damage);
-	pixman_region32_subtract(&repaint, &repaint, &ev->clip);
-
-	if (!pixman_region32_not_empty(&repaint))
-		goto out;
-
 	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
 	if (gr->fan_debug) {
 		use_shader(gr, &gr->solid_shader);
-		shader_uniforms(&gr->solid_shader, ev, output);
+		shader_uniforms(&gr->solid_shader, ev, proj);
 	}
 
 	use_shader(gr, gs->shader);
-	shader_uniforms(gs->shader, ev, output);
+	shader_uniforms(gs->shader, ev, proj);
 
-	if (ev->transform.enabled || output->zoom.active ||
-	    output->current_scale != ev->surface->buffer_viewport.buffer.scale)
+	if (ev->transform.enabled || scaled)
 		filter = GL_LINEAR;
 	else
 		filter = GL_NEAREST;
@@ -663,7 +657,7 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 			 * Xwayland surfaces need this.
 			 */
 			use_shader(gr, &gr->texture_shader_rgbx);
-			shader_uniforms(&gr->texture_shader_rgbx, ev, output);
+			shader_uniforms(&gr->texture_shader_rgbx, ev, proj);
 		}
 
 		if (ev->alpha < 1.0)
@@ -671,19 +665,46 @@ draw_view(struct weston_view *ev, struct weston_output *output,
 		else
 			glDisable(GL_BLEND);
 
-		repaint_region(ev, &repaint, &surface_opaque);
+		repaint_region(ev, repaint, &surface_opaque);
 	}
 
 	if (pixman_region32_not_empty(&surface_blend)) {
 		use_shader(gr, gs->shader);
 		glEnable(GL_BLEND);
-		repaint_region(ev, &repaint, &surface_blend);
+		repaint_region(ev, repaint, &surface_blend);
 	}
 
 	pixman_region32_fini(&surface_blend);
 	pixman_region32_fini(&surface_opaque);
+}
+
+static void
+draw_view(struct weston_view *ev, struct weston_output *output,
+	  pixman_region32_t *damage) /* in global coordinates */
+{
+	struct gl_surface_state *gs = get_surface_state(ev->surface);
+	/* repaint bounding region in global coordinates: */
+	pixman_region32_t repaint;
+	int scaled;
+
+	/* In case of a runtime switch of renderers, we may not have received
+	 * an attach for this surface since the switch. In that case we don't
+	 * have a valid buffer or a proper shader set up so skip rendering. */
+	if (!gs->shader)
+		return;
+
+	pixman_region32_init(&repaint);
+	pixman_region32_intersect(&repaint,
+				  &ev->transform.boundingbox, damage);
+	pixman_region32_subtract(&repaint, &repaint, &ev->clip);
+
+	if (pixman_region32_not_empty(&repaint)) {
+		scaled = output->zoom.active ||
+			 output->current_scale !=
+			 ev->surface->buffer_viewport.buffer.scale;
+		draw_view_region(ev, &output->matrix, scaled, &repaint);
+	}
 
-out:
 	pixman_region32_fini(&repaint);
 }
 
@@ -694,10 +715,97 @@ repaint_views(struct weston_output *output, pixman_region32_t *damage)
 	struct weston_view *view;
 
 	wl_list_for_each_reverse(view, &compositor->view_list, link)
-		if (view->plane == &compositor->primary_plane)
+		if (view->plane == &compositor->primary_plane &&
+		    !view->cache.owner)
 			draw_view(view, output, damage);
 }
 
+/* Renders the members into a texture the cache surface samples from,
+ * the way repaint_views() would draw them on an output positioned at
+ * the cache view, except that views outside the cache do not clip. */
+static int
+gl_renderer_view_cache_render(struct weston_view_cache *cache,
+			      struct weston_output *output)
+{
+	struct weston_surface *surface = cache->surface;
+	struct gl_renderer *gr = get_renderer(surface->compositor);
+	struct gl_surface_state *gs = get_surface_state(surface);
+	int32_t x = cache->view->geometry.x;
+	int32_t y = cache->view->geometry.y;
+	int32_t width = surface->width;
+	int32_t height = surface->height;
+	struct weston_view *view;
+	struct weston_matrix proj;
+	pixman_region32_t repaint;
+	GLenum status;
+
+	if (use_output(output) < 0)
+		return -1;
+
+	if (!gs->fbo) {
+		glGenTextures(1, gs->textures);
+		glBindTexture(GL_TEXTURE_2D, gs->textures[0]);
+		glTexParameteri(GL_TEXTURE_2D,
+				GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D,
+				GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glGenFramebuffers(1, &gs->fbo);
+
+		gs->num_textures = 1;
+		gs->target = GL_TEXTURE_2D;
+		gs->shader = &gr->texture_shader_rgba;
+		/* rendered top row first */
+		gs->y_inverted = 1;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, gs->textures[0]);
+	if (gs->pitch != width || gs->height != height) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
+			     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		gs->pitch = width;
+		gs->height = height;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, gs->fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			       GL_TEXTURE_2D, gs->textures[0], 0);
+
+	status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		weston_log("%s: fbo error: %#x\n", __func__, status);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return -1;
+	}
+
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	weston_matrix_init(&proj);
+	weston_matrix_translate(&proj,
+				-(x + width / 2.0), -(y + height / 2.0), 0);
+	weston_matrix_scale(&proj, 2.0 / width, 2.0 / height, 1);
+
+	pixman_region32_init(&repaint);
+	wl_list_for_each(view, &cache->view_list, cache.link) {
+		/* see draw_view() */
+		if (!get_surface_state(view->surface)->shader)
+			continue;
+
+		pixman_region32_intersect_rect(&repaint,
+					       &view->transform.boundingbox,
+					       x, y, width, height);
+		draw_view_region(view, &proj,
+				 view->surface->buffer_viewport.buffer.scale != 1,
+				 &repaint);
+	}
+	pixman_region32_fini(&repaint);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	return 0;
+}
+
 static void
 draw_output_border_texture(struct gl_output_state *go,
 			   enum gl_renderer_border_side side,
@@ -1183,6 +1291,17 @@ ensure_textures(struct gl_surface_state *gs, int num_textures)
 	glBindTexture(gs->target, 0);
 }
 
+static void
+set_texture_bytes(struct gl_surface_state *gs, int64_t bytes)
+{
+	if (bytes == gs->texture_bytes)
+		return;
+
+	weston_client_stats_account_texture(gs->surface,
+					    bytes - gs->texture_bytes);
+	gs->texture_bytes = bytes;
+}
+
 static void
 gl_renderer_attach_shm(struct weston_surface *es, struct weston_buffer *buffer,
 		       struct wl_shm_buffer *shm_buffer)
@@ -1242,6 +1361,8 @@ gl_renderer_attach_shm(struct weston_surface *es, struct weston_buffer *buffer,
 		gs->surface = es;
 
 		ensure_textures(gs, 1);
+		set_texture_bytes(gs, (int64_t)wl_shm_buffer_get_stride(shm_buffer) *
+				  buffer->height);
 	}
 }
 
@@ -1319,6 +1440,7 @@ gl_renderer_attach_egl(struct weston_surface *es, struct weston_buffer *buffer,
 	gs->height = buffer->height;
 	gs->buffer_type = BUFFER_TYPE_EGL;
 	gs->y_inverted = buffer->y_inverted;
+	set_texture_bytes(gs, 0);
 }
 
 static void
@@ -1343,6 +1465,7 @@ gl_renderer_attach(struct weston_surface *es, struct weston_buffer *buffer)
 		gs->num_textures = 0;
 		gs->buffer_type = BUFFER_TYPE_NULL;
 		gs->y_inverted = 1;
+		set_texture_bytes(gs, 0);
 		return;
 	}
 
@@ -1534,8 +1657,12 @@ surface_state_destroy(struct gl_surface_state *gs, struct gl_renderer *gr)
 
 	gs->surface->renderer_state = NULL;
 
+	set_texture_bytes(gs, 0);
 	glDeleteTextures(gs->num_textures, gs->textures);
 
+	if (gs->fbo)
+		glDeleteFramebuffers(1, &gs->fbo);
+
 	for (i = 0; i < gs->num_images; i++)
 		gr->destroy_image(gr->egl_display, gs->images[i]);
 
@@ -2156,6 +2283,7 @@ gl_renderer_create(struct weston_compositor *ec, EGLNativeDisplayType display,
 	gr->base.surface_get_content_size =
 		gl_renderer_surface_get_content_size;
 	gr->base.surface_copy_content = gl_renderer_surface_copy_content;
+	gr->base.view_cache_render = gl_renderer_view_cache_render;
 
 	gr->egl_display = eglGetDisplay(display);
 	if (gr->egl_display == EGL_NO_DISPLAY) {
@@ -24,8 +24,11 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <assert.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -46,6 +49,128 @@ static void unbind_resource(struct wl_resource *resource)
 	wl_list_remove(wl_resource_get_link(resource));
 }
 
+/* The pointer, keyboard and touch resources a client has bound on a
+ * seat, while they are not in the focus lists of the seat devices.
+ * Keeping them per client lets a focus change move the resources of
+ * one client in and out of the focus lists without scanning the
+ * resources of every other client.
+ */
+struct seat_client {
+	struct weston_seat *seat;
+	struct wl_list link;		/* weston_seat::client_list */
+	struct wl_list client_link;	/* input_client::seat_list */
+	struct wl_list pointer_resource_list;
+	struct wl_list keyboard_resource_list;
+	struct wl_list touch_resource_list;
+};
+
+/* Found through the client destroy listener, so looking up a client
+ * does not depend on the number of clients. */
+struct input_client {
+	struct wl_listener destroy_listener;
+	struct wl_list seat_list;	/* seat_client::client_link */
+};
+
+static void
+seat_client_destroy(struct seat_client *sc)
+{
+	/* Resources still in the lists stay linked to each other, so
+	 * that unbind_resource() keeps working once the heads are gone. */
+	wl_list_remove(&sc->pointer_resource_list);
+	wl_list_remove(&sc->keyboard_resource_list);
+	wl_list_remove(&sc->touch_resource_list);
+	wl_list_remove(&sc->client_link);
+	wl_list_remove(&sc->link);
+	free(sc);
+}
+
+static void
+input_client_destroyed(struct wl_listener *listener, void *data)
+{
+	struct input_client *ic =
+		container_of(listener, struct input_client, destroy_listener);
+	struct seat_client *sc, *next;
+
+	/* The resources of the client are destroyed after this. */
+	wl_list_for_each_safe(sc, next, &ic->seat_list, client_link)
+		seat_client_destroy(sc);
+
+	wl_list_remove(&ic->destroy_listener.link);
+	free(ic);
+}
+
+static struct seat_client *
+seat_client_get(struct weston_seat *seat, struct wl_client *client,
+		int create)
+{
+	struct wl_listener *listener;
+	struct input_client *ic;
+	struct seat_client *sc;
+
+	listener = wl_client_get_destroy_listener(client,
+						  input_client_destroyed);
+	if (listener) {
+		ic = container_of(listener, struct input_client,
+				  destroy_listener);
+		wl_list_for_each(sc, &ic->seat_list, client_link)
+			if (sc->seat == seat)
+				return sc;
+	} else {
+		ic = NULL;
+	}
+
+	if (!create)
+		return NULL;
+
+	if (!ic) {
+		ic = zalloc(sizeof *ic);
+		if (!ic)
+			return NULL;
+
+		wl_list_init(&ic->seat_list);
+		ic->destroy_listener.notify = input_client_destroyed;
+		wl_client_add_destroy_listener(client, &ic->destroy_listener);
+	}
+
+	sc = zalloc(sizeof *sc);
+	if (!sc)
+		return NULL;
+
+	sc->seat = seat;
+	wl_list_init(&sc->pointer_resource_list);
+	wl_list_init(&sc->keyboard_resource_list);
+	wl_list_init(&sc->touch_resource_list);
+	wl_list_insert(&ic->seat_list, &sc->client_link);
+	wl_list_insert(&seat->client_list, &sc->link);
+
+	return sc;
+}
+
+static struct seat_client *
+seat_client_for_surface(struct weston_seat *seat,
+			struct weston_surface *surface)
+{
+	if (!surface || !surface->resource)
+		return NULL;
+
+	return seat_client_get(seat,
+			       wl_resource_get_client(surface->resource), 0);
+}
+
+/* A focus list only ever holds the resources of a single client. */
+static struct seat_client *
+seat_client_for_focus(struct weston_seat *seat, struct wl_list *list)
+{
+	struct wl_resource *resource;
+
+	if (wl_list_empty(list))
+		return NULL;
+
+	resource = wl_resource_from_link(list->next);
+
+	return seat_client_get(seat, wl_resource_get_client(resource), 0);
+}
+
 WL_EXPORT void
 weston_seat_repick(struct weston_seat *seat)
 {
@@ -121,28 +246,18 @@ touch_focus_resource_destroyed(struct wl_listener *listener, void *data)
 	weston_touch_set_focus(touch->seat, NULL);
 }
 
+/* With no destination, the resources are only unlinked from source;
+ * that happens when their client is already being destroyed. */
 static void
 move_resources(struct wl_list *destination, struct wl_list *source)
 {
-	wl_list_insert_list(destination, source);
+	if (destination)
+		wl_list_insert_list(destination, source);
+	else
+		wl_list_remove(source);
 	wl_list_init(source);
 }
 
-static void
-move_resources_for_client(struct wl_list *destination,
-			  struct wl_list *source,
-			  struct wl_client *client)
-{
-	struct wl_resource *resource, *tmp;
-	wl_resource_for_each_safe(resource, tmp, source) {
-		if (wl_resource_get_client(resource) == client) {
-			wl_list_remove(wl_resource_get_link(resource));
-			wl_list_insert(destination,
-				       wl_resource_get_link(resource));
-		}
-	}
-}
-
 static void
 default_grab_pointer_focus(struct weston_pointer_grab *grab)
 {
@@ -344,40 +459,14 @@ send_modifiers_to_resource(struct weston_keyboard *keyboard,
 }
 
 static void
-send_modifiers_to_client_in_list(struct wl_client *client,
-				 struct wl_list *list,
-				 uint32_t serial,
-				 struct weston_keyboard *keyboard)
+send_modifiers_to_list(struct wl_list *list,
+		       uint32_t serial,
+		       struct weston_keyboard *keyboard)
 {
 	struct wl_resource *resource;
 
-	wl_resource_for_each(resource, list) {
-		if (wl_resource_get_client(resource) == client)
-			send_modifiers_to_resource(keyboard,
-						   resource,
-						   serial);
-	}
-}
-
-static struct wl_resource *
-find_resource_for_surface(struct wl_list *list, struct weston_surface *surface)
-{
-	if (!surface)
-		return NULL;
-
-	if (!surface->resource)
-		return NULL;
-
-	return wl_resource_find_for_client(list, wl_resource_get_client(surface->resource));
-}
-
-static struct wl_resource *
-find_resource_for_view(struct wl_list *list, struct weston_view *view)
-{
-	if (!view)
-		return NULL;
-
-	return find_resource_for_surface(list, view->surface);
+	wl_resource_for_each(resource, list)
+		send_modifiers_to_resource(keyboard, resource, serial);
 }
 
 static void
@@ -397,14 +486,15 @@ default_grab_keyboard_modifiers(struct weston_keyboard_grab *grab,
 		wl_keyboard_send_modifiers(resource, serial, mods_depressed,
 					   mods_latched, mods_locked, group);
 	}
-	if (pointer && pointer->focus && pointer->focus->surface->resource &&
+	if (pointer && pointer->focus &&
 	    pointer->focus->surface != keyboard->focus) {
-		struct wl_client *pointer_client =
-			wl_resource_get_client(pointer->focus->surface->resource);
-		send_modifiers_to_client_in_list(pointer_client,
-						 &keyboard->resource_list,
-						 serial,
-						 keyboard);
+		struct seat_client *sc =
+			seat_client_for_surface(keyboard->seat,
+						pointer->focus->surface);
+		if (sc)
+			send_modifiers_to_list(&sc->keyboard_resource_list,
+					       serial,
+					       keyboard);
 	}
 }
 
@@ -464,7 +554,6 @@ weston_pointer_create(struct weston_seat *seat)
 	if (pointer == NULL)
 		return NULL;
 
-	wl_list_init(&pointer->resource_list);
 	wl_list_init(&pointer->focus_resource_list);
 	weston_pointer_set_default_grab(pointer,
 					seat->compositor->default_pointer_grab);
@@ -493,10 +582,16 @@ weston_pointer_create(struct weston_seat *seat)
 WL_EXPORT void
 weston_pointer_destroy(struct weston_pointer *pointer)
 {
+	struct seat_client *sc;
+
 	if (pointer->sprite)
 		pointer_unmap_sprite(pointer);
 
-	/* XXX: What about pointer->resource_list? */
+	/* Hand the focused resources back to their client; the seat
+	 * client records outlive the device. */
+	sc = seat_client_for_focus(pointer->seat, &pointer->focus_resource_list);
+	move_resources(sc ? &sc->pointer_resource_list : NULL,
+		       &pointer->focus_resource_list);
 
 	wl_list_remove(&pointer->focus_resource_listener.link);
 	wl_list_remove(&pointer->focus_view_listener.link);
@@ -524,7 +619,6 @@ weston_keyboard_create(void)
 	if (keyboard == NULL)
 	    return NULL;
 
-	wl_list_init(&keyboard->resource_list);
 	wl_list_init(&keyboard->focus_resource_list);
 	wl_list_init(&keyboard->focus_resource_listener.link);
 	keyboard->focus_resource_listener.notify = keyboard_focus_resource_destroyed;
@@ -543,7 +637,13 @@ weston_xkb_info_destroy(struct weston_xkb_info *xkb_info);
 WL_EXPORT void
 weston_keyboard_destroy(struct weston_keyboard *keyboard)
 {
-	/* XXX: What about keyboard->resource_list? */
+	struct seat_client *sc;
+
+	/* Hand the focused resources back to their client; the seat
+	 * client records outlive the device. */
+	sc = seat_client_for_focus(keyboard->seat, &keyboard->focus_resource_list);
+	move_resources(sc ? &sc->keyboard_resource_list : NULL,
+		       &keyboard->focus_resource_list);
 
 #ifdef ENABLE_XKBCOMMON
 	if (keyboard->seat->compositor->use_xkbcommon) {
@@ -574,7 +674,6 @@ weston_touch_create(void)
 	if (touch == NULL)
 		return NULL;
 
-	wl_list_init(&touch->resource_list);
 	wl_list_init(&touch->focus_resource_list);
 	wl_list_init(&touch->focus_view_listener.link);
 	touch->focus_view_listener.notify = touch_focus_view_destroyed;
@@ -591,7 +690,13 @@ weston_touch_create(void)
 WL_EXPORT void
 weston_touch_destroy(struct weston_touch *touch)
 {
-	/* XXX: What about touch->resource_list? */
+	struct seat_client *sc;
+
+	/* Hand the focused resources back to their client; the seat
+	 * client records outlive the device. */
+	sc = seat_client_for_focus(touch->seat, &touch->focus_resource_list);
+	move_resources(sc ? &sc->touch_resource_list : NULL,
+		       &touch->focus_resource_list);
 
 	wl_list_remove(&touch->focus_view_listener.link);
 	wl_list_remove(&touch->focus_resource_listener.link);
@@ -623,6 +728,7 @@ weston_pointer_set_focus(struct weston_pointer *pointer,
 			 wl_fixed_t sx, wl_fixed_t sy)
 {
 	struct weston_keyboard *kbd = pointer->seat->keyboard;
+	struct seat_client *sc;
 	struct wl_resource *resource;
 	struct wl_display *display = pointer->seat->compositor->wl_display;
 	uint32_t serial;
@@ -644,24 +750,23 @@ weston_pointer_set_focus(struct weston_pointer *pointer,
 					      pointer->focus->surface->resource);
 		}
 
-		move_resources(&pointer->resource_list, focus_resource_list);
+		sc = seat_client_for_focus(pointer->seat, focus_resource_list);
+		move_resources(sc ? &sc->pointer_resource_list : NULL,
+			       focus_resource_list);
 	}
 
-	if (find_resource_for_view(&pointer->resource_list, view) && refocus) {
-		struct wl_client *surface_client =
-			wl_resource_get_client(view->surface->resource);
-
+	sc = view ? seat_client_for_surface(pointer->seat, view->surface) :
+		    NULL;
+	if (sc && !wl_list_empty(&sc->pointer_resource_list) && refocus) {
 		serial = wl_display_next_serial(display);
 
 		if (kbd && kbd->focus != view->surface)
-			send_modifiers_to_client_in_list(surface_client,
-							 &kbd->resource_list,
-							 serial,
-							 kbd);
+			send_modifiers_to_list(&sc->keyboard_resource_list,
+					       serial,
+					       kbd);
 
-		move_resources_for_client(focus_resource_list,
-					  &pointer->resource_list,
-					  surface_client);
+		move_resources(focus_resource_list,
+			       &sc->pointer_resource_list);
 
 		wl_resource_for_each(resource, focus_resource_list) {
 			wl_pointer_send_enter(resource,
@@ -711,6 +816,7 @@ WL_EXPORT void
 weston_keyboard_set_focus(struct weston_keyboard *keyboard,
 			  struct weston_surface *surface)
 {
+	struct seat_client *sc;
 	struct wl_resource *resource;
 	struct wl_display *display = keyboard->seat->compositor->wl_display;
 	uint32_t serial;
@@ -724,19 +830,18 @@ weston_keyboard_set_focus(struct weston_keyboard *keyboard,
 			wl_keyboard_send_leave(resource, serial,
 					keyboard->focus->resource);
 		}
-		move_resources(&keyboard->resource_list, focus_resource_list);
+		sc = seat_client_for_focus(keyboard->seat, focus_resource_list);
+		move_resources(sc ? &sc->keyboard_resource_list : NULL,
+			       focus_resource_list);
 	}
 
-	if (find_resource_for_surface(&keyboard->resource_list, surface) &&
+	sc = seat_client_for_surface(keyboard->seat, surface);
+	if (sc && !wl_list_empty(&sc->keyboard_resource_list) &&
 	    keyboard->focus != surface) {
-		struct wl_client *surface_client =
-			wl_resource_get_client(surface->resource);
-
 		serial = wl_display_next_serial(display);
 
-		move_resources_for_client(focus_resource_list,
-					  &keyboard->resource_list,
-					  surface_client);
+		move_resources(focus_resource_list,
+			       &sc->keyboard_resource_list);
 		send_enter_to_resource_list(focus_resource_list,
 					    keyboard,
 					    surface,
@@ -937,6 +1042,77 @@ weston_pointer_handle_output_destroy(struct wl_listener *listener, void *data)
 	weston_pointer_move(pointer, fx, fy);
 }
 
+/* With [core] coalesce-motion, pointer motion is not dispatched as it
+ * arrives.  Only the latest position is kept and handed to the grab when
+ * the next repaint starts, or before any other event of the seat so the
+ * order of events as seen by clients does not change.  Without an output
+ * there is no repaint to wait for, so motion is delivered right away. */
+static void
+weston_pointer_queue_motion(struct weston_pointer *pointer, uint32_t time,
+			    wl_fixed_t x, wl_fixed_t y)
+{
+	struct weston_compositor *ec = pointer->seat->compositor;
+	struct weston_output *output;
+
+	if (wl_list_empty(&ec->output_list)) {
+		pointer->motion_pending = 0;
+		pointer->grab->interface->motion(pointer->grab, time, x, y);
+		return;
+	}
+
+	weston_pointer_clamp(pointer, &x, &y);
+
+	pointer->motion_time = time;
+	pointer->motion_x = x;
+	pointer->motion_y = y;
+
+	if (pointer->motion_pending)
+		return;
+	pointer->motion_pending = 1;
+
+	wl_list_for_each(output, &ec->output_list, link) {
+		if (pixman_region32_contains_point(&output->region,
+						   wl_fixed_to_int(x),
+						   wl_fixed_to_int(y), NULL)) {
+			weston_output_schedule_repaint(output);
+			return;
+		}
+	}
+
+	weston_compositor_schedule_repaint(ec);
+}
+
+static void
+weston_pointer_flush_motion(struct weston_pointer *pointer)
+{
+	if (!pointer || !pointer->motion_pending)
+		return;
+
+	pointer->motion_pending = 0;
+	pointer->grab->interface->motion(pointer->grab, pointer->motion_time,
+					 pointer->motion_x, pointer->motion_y);
+}
+
+/** Deliver the pointer motion coalesced since the last repaint
+ *
+ * \param compositor The compositor
+ *
+ * Called at the start of each repaint, and by anything that needs the
+ * pointer position to be current before then.  Does nothing unless
+ * motion coalescing is enabled.
+ */
+WL_EXPORT void
+weston_compositor_flush_motion(struct weston_compositor *compositor)
+{
+	struct weston_seat *seat;
+
+	if (!compositor->coalesce_motion)
+		return;
+
+	wl_list_for_each(seat, &compositor->seat_list, link)
+		weston_pointer_flush_motion(seat->pointer);
+}
+
 WL_EXPORT void
 notify_motion(struct weston_seat *seat,
 	      uint32_t time, wl_fixed_t dx, wl_fixed_t dy)
@@ -945,6 +1121,19 @@ notify_motion(struct weston_seat *seat,
 	struct weston_pointer *pointer = seat->pointer;
 
 	weston_compositor_wake(ec);
+
+	if (ec->coalesce_motion) {
+		if (pointer->motion_pending)
+			weston_pointer_queue_motion(pointer, time,
+						    pointer->motion_x + dx,
+						    pointer->motion_y + dy);
+		else
+			weston_pointer_queue_motion(pointer, time,
+						    pointer->x + dx,
+						    pointer->y + dy);
+		return;
+	}
+
 	pointer->grab->interface->motion(pointer->grab, time, pointer->x + dx, pointer->y + dy);
 }
 
@@ -992,6 +1181,12 @@ notify_motion_absolute(struct weston_seat *seat,
 	struct weston_pointer *pointer = seat->pointer;
 
 	weston_compositor_wake(ec);
+
+	if (ec->coalesce_motion) {
+		weston_pointer_queue_motion(pointer, time, x, y);
+		return;
+	}
+
 	pointer->grab->interface->motion(pointer->grab, time, x, y);
 }
 
@@ -1016,6 +1211,8 @@ notify_button(struct weston_seat *seat, uint32_t time, int32_t button,
 	struct weston_compositor *compositor = seat->compositor;
 	struct weston_pointer *pointer = seat->pointer;
 
+	weston_pointer_flush_motion(pointer);
+
 	if (state == WL_POINTER_BUTTON_STATE_PRESSED) {
 		weston_compositor_idle_inhibit(compositor);
 		if (pointer->button_count == 0) {
@@ -1050,6 +1247,7 @@ notify_axis(struct weston_seat *seat, uint32_t time, uint32_t axis,
 	struct wl_list *resource_list;
 
 	weston_compositor_wake(compositor);
+	weston_pointer_flush_motion(pointer);
 
 	if (!value)
 		return;
@@ -1231,19 +1429,21 @@ send_modifiers(struct wl_resource *resource, uint32_t serial, struct weston_keyb
 }
 
 static struct weston_xkb_info *
-weston_xkb_info_create(struct xkb_keymap *keymap);
+weston_xkb_info_get(struct weston_compositor *ec, struct xkb_keymap *keymap);
 
 static void
 update_keymap(struct weston_seat *seat)
 {
 	struct weston_keyboard *keyboard = seat->keyboard;
+	struct seat_client *sc;
 	struct wl_resource *resource;
 	struct weston_xkb_info *xkb_info;
 	struct xkb_state *state;
 	xkb_mod_mask_t latched_mods;
 	xkb_mod_mask_t locked_mods;
 
-	xkb_info = weston_xkb_info_create(keyboard->pending_keymap);
+	xkb_info = weston_xkb_info_get(seat->compositor,
+				       keyboard->pending_keymap);
 
 	xkb_keymap_unref(keyboard->pending_keymap);
 	keyboard->pending_keymap = NULL;
@@ -1276,8 +1476,9 @@ update_keymap(struct weston_seat *seat)
 	xkb_state_unref(keyboard->xkb_state.state);
 	keyboard->xkb_state.state = state;
 
-	wl_resource_for_each(resource, &seat->keyboard->resource_list)
-		send_keymap(resource, xkb_info);
+	wl_list_for_each(sc, &seat->client_list, link)
+		wl_resource_for_each(resource, &sc->keyboard_resource_list)
+			send_keymap(resource, xkb_info);
 	wl_resource_for_each(resource, &seat->keyboard->focus_resource_list)
 		send_keymap(resource, xkb_info);
 
@@ -1286,8 +1487,9 @@ update_keymap(struct weston_seat *seat)
 	if (!latched_mods && !locked_mods)
 		return;
 
-	wl_resource_for_each(resource, &seat->keyboard->resource_list)
-		send_modifiers(resource, wl_display_get_serial(seat->compositor->wl_display), seat->keyboard);
+	wl_list_for_each(sc, &seat->client_list, link)
+		wl_resource_for_each(resource, &sc->keyboard_resource_list)
+			send_modifiers(resource, wl_display_get_serial(seat->compositor->wl_display), seat->keyboard);
 	wl_resource_for_each(resource, &seat->keyboard->focus_resource_list)
 		send_modifiers(resource, wl_display_get_serial(seat->compositor->wl_display), seat->keyboard);
 }
@@ -1319,6 +1521,8 @@ notify_key(struct weston_seat *seat, uint32_t time, uint32_t key,
 	struct weston_keyboard_grab *grab = keyboard->grab;
 	uint32_t *k, *end;
 
+	weston_pointer_flush_motion(seat->pointer);
+
 	if (state == WL_KEYBOARD_KEY_STATE_PRESSED) {
 		weston_compositor_idle_inhibit(compositor);
 	} else {
@@ -1373,6 +1577,8 @@ notify_pointer_focus(struct weston_seat *seat, struct weston_output *output,
 		     wl_fixed_t x, wl_fixed_t y)
 {
 	if (output) {
+		/* The new position replaces any coalesced motion. */
+		seat->pointer->motion_pending = 0;
 		weston_pointer_move(seat->pointer, x, y);
 	} else {
 		/* FIXME: We should call weston_pointer_set_focus(seat,
@@ -1451,6 +1657,7 @@ notify_keyboard_focus_out(struct weston_seat *seat)
 WL_EXPORT void
 weston_touch_set_focus(struct weston_seat *seat, struct weston_view *view)
 {
+	struct seat_client *sc;
 	struct wl_list *focus_resource_list;
 
 	focus_resource_list = &seat->touch->focus_resource_list;
@@ -1467,22 +1674,21 @@ weston_touch_set_focus(struct weston_seat *seat, struct weston_view *view)
 	wl_list_init(&seat->touch->focus_view_listener.link);
 
 	if (!wl_list_empty(focus_resource_list)) {
-		move_resources(&seat->touch->resource_list,
+		sc = seat_client_for_focus(seat, focus_resource_list);
+		move_resources(sc ? &sc->touch_resource_list : NULL,
 			       focus_resource_list);
 	}
 
 	if (view) {
-		struct wl_client *surface_client;
-
 		if (!view->surface->resource) {
 			seat->touch->focus = NULL;
 			return;
 		}
 
-		surface_client = wl_resource_get_client(view->surface->resource);
-		move_resources_for_client(focus_resource_list,
-					  &seat->touch->resource_list,
-					  surface_client);
+		sc = seat_client_for_surface(seat, view->surface);
+		if (sc)
+			move_resources(focus_resource_list,
+				       &sc->touch_resource_list);
 		wl_resource_add_destroy_listener(view->surface->resource,
 						 &seat->touch->focus_resource_listener);
 		wl_signal_add(&view->destroy_signal, &seat->touch->focus_view_listener);
@@ -1508,6 +1714,8 @@ notify_touch(struct weston_seat *seat, uint32_t time, int touch_id,
 	struct weston_view *ev;
 	wl_fixed_t sx, sy;
 
+	weston_pointer_flush_motion(seat->pointer);
+
 	/* Update grab's global coordinates. */
 	if (touch_id == touch->grab_touch_id && touch_type != WL_TOUCH_UP) {
 		touch->grab_x = x;
@@ -1694,11 +1902,18 @@ seat_get_pointer(struct wl_client *client, struct wl_resource *resource,
 		 uint32_t id)
 {
 	struct weston_seat *seat = wl_resource_get_user_data(resource);
+	struct seat_client *sc;
 	struct wl_resource *cr;
 
 	if (!seat->pointer)
 		return;
 
+	sc = seat_client_get(seat, client, 1);
+	if (sc == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
         cr = wl_resource_create(client, &wl_pointer_interface,
 				wl_resource_get_version(resource), id);
 	if (cr == NULL) {
@@ -1709,7 +1924,7 @@ seat_get_pointer(struct wl_client *client, struct wl_resource *resource,
 	/* May be moved to focused list later by either
 	 * weston_pointer_set_focus or directly if this client is already
 	 * focused */
-	wl_list_insert(&seat->pointer->resource_list, wl_resource_get_link(cr));
+	wl_list_insert(&sc->pointer_resource_list, wl_resource_get_link(cr));
 	wl_resource_set_implementation(cr, &pointer_interface, seat->pointer,
 				       unbind_resource);
 
@@ -1767,11 +1982,18 @@ seat_get_keyboard(struct wl_client *client, struct wl_resource *resource,
 {
 	struct weston_seat *seat = wl_resource_get_user_data(resource);
 	struct weston_keyboard *keyboard = seat->keyboard;
+	struct seat_client *sc;
 	struct wl_resource *cr;
 
 	if (!seat->keyboard)
 		return;
 
+	sc = seat_client_get(seat, client, 1);
+	if (sc == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
         cr = wl_resource_create(client, &wl_keyboard_interface,
 				wl_resource_get_version(resource), id);
 	if (cr == NULL) {
@@ -1782,7 +2004,7 @@ seat_get_keyboard(struct wl_client *client, struct wl_resource *resource,
 	/* May be moved to focused list later by either
 	 * weston_keyboard_set_focus or directly if this client is already
 	 * focused */
-	wl_list_insert(&seat->keyboard->resource_list, wl_resource_get_link(cr));
+	wl_list_insert(&sc->keyboard_resource_list, wl_resource_get_link(cr));
 	wl_resource_set_implementation(cr, &keyboard_interface,
 				       seat, unbind_resource);
 
@@ -1846,11 +2068,18 @@ seat_get_touch(struct wl_client *client, struct wl_resource *resource,
 	       uint32_t id)
 {
 	struct weston_seat *seat = wl_resource_get_user_data(resource);
+	struct seat_client *sc;
 	struct wl_resource *cr;
 
 	if (!seat->touch)
 		return;
 
+	sc = seat_client_get(seat, client, 1);
+	if (sc == NULL) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
         cr = wl_resource_create(client, &wl_touch_interface,
 				wl_resource_get_version(resource), id);
 	if (cr == NULL) {
@@ -1858,12 +2087,12 @@ seat_get_touch(struct wl_client *client, struct wl_resource *resource,
 		return;
 	}
 
-	if (seat->touch->focus &&
+	if (seat->touch->focus && seat->touch->focus->surface->resource &&
 	    wl_resource_get_client(seat->touch->focus->surface->resource) == client) {
-		wl_list_insert(&seat->touch->resource_list,
+		wl_list_insert(&seat->touch->focus_resource_list,
 			       wl_resource_get_link(cr));
 	} else {
-		wl_list_insert(&seat->touch->focus_resource_list,
+		wl_list_insert(&sc->touch_resource_list,
 			       wl_resource_get_link(cr));
 	}
 	wl_resource_set_implementation(cr, &touch_interface,
@@ -1964,8 +2193,11 @@ weston_compositor_xkb_destroy(struct weston_compositor *ec)
 	xkb_context_unref(ec->xkb_context);
 }
 
+/* Wraps keymap in a new xkb_info.  If the serialized form of the keymap
+ * is already at hand (loaded from the keymap cache) it is passed in as
+ * keymap_text and used as is, otherwise the keymap is serialized here. */
 static struct weston_xkb_info *
-weston_xkb_info_create(struct xkb_keymap *keymap)
+weston_xkb_info_create(struct xkb_keymap *keymap, const char *keymap_text)
 {
 	struct weston_xkb_info *xkb_info = zalloc(sizeof *xkb_info);
 	if (xkb_info == NULL)
@@ -2000,8 +2232,11 @@ weston_xkb_info_create(struct xkb_keymap *keymap)
 	xkb_info->scroll_led = xkb_keymap_led_get_index(xkb_info->keymap,
 							XKB_LED_NAME_SCROLL);
 
-	keymap_str = xkb_keymap_get_as_string(xkb_info->keymap,
-					      XKB_KEYMAP_FORMAT_TEXT_V1);
+	if (keymap_text)
+		keymap_str = strdup(keymap_text);
+	else
+		keymap_str = xkb_keymap_get_as_string(xkb_info->keymap,
+						      XKB_KEYMAP_FORMAT_TEXT_V1);
 	if (keymap_str == NULL) {
 		weston_log("failed to get string version of keymap\n");
 		goto err_keymap;
@@ -2038,17 +2273,208 @@ err_keymap:
 	return NULL;
 }
 
+/* Returns an xkb_info for keymap, sharing the global one (and with it
+ * the keymap fd sent to clients) when the keymap is the global keymap. */
+static struct weston_xkb_info *
+weston_xkb_info_get(struct weston_compositor *ec, struct xkb_keymap *keymap)
+{
+	if (ec->xkb_info && ec->xkb_info->keymap == keymap) {
+		ec->xkb_info->ref_count++;
+		return ec->xkb_info;
+	}
+
+	return weston_xkb_info_create(keymap, NULL);
+}
+
+/*
+ * Compiled keymap cache.
+ *
+ * Compiling a keymap from RMLVO names walks and parses a good part of
+ * the xkeyboard-config tree, which is one of the slower steps of
+ * startup on small CPUs.  The serialized keymap is instead stored in
+ * $XDG_CACHE_HOME/weston (or ~/.cache/weston) and parsed back from
+ * there on the next start.
+ *
+ * libxkbcommon offers no way to ask for the xkeyboard-config version,
+ * so the size and mtime of the rules file in the XKB include path
+ * stand in for it: any update of xkeyboard-config rewrites the rules
+ * file and so invalidates the cache.  The first line of a cache file
+ * repeats the full key and is compared on load, guarding against hash
+ * collisions and stale files.
+ */
+
+static char *
+keymap_cache_key(struct weston_compositor *ec)
+{
+	struct xkb_rule_names *names = &ec->xkb_names;
+	struct stat st;
+	unsigned int i, n;
+	char path[PATH_MAX];
+	char *key;
+
+	n = xkb_context_num_include_paths(ec->xkb_context);
+	for (i = 0; i < n; i++) {
+		snprintf(path, sizeof path, "%s/rules/%s",
+			 xkb_context_include_path_get(ec->xkb_context, i),
+			 names->rules);
+		if (stat(path, &st) == 0)
+			break;
+	}
+	if (i == n)
+		return NULL;
+
+	if (asprintf(&key, "// weston keymap cache: %s:%s:%s:%s:%s %lld:%lld\n",
+		     names->rules, names->model, names->layout,
+		     names->variant ? names->variant : "",
+		     names->options ? names->options : "",
+		     (long long) st.st_size, (long long) st.st_mtime) < 0)
+		return NULL;
+
+	return key;
+}
+
+static char *
+keymap_cache_path(const char *key)
+{
+	const char *dir, *home;
+	uint64_t hash = 0xcbf29ce484222325ull;
+	char *path;
+	int len;
+
+	/* FNV-1a, only used to name the file */
+	for (; *key; key++)
+		hash = (hash ^ (unsigned char) *key) * 0x100000001b3ull;
+
+	dir = getenv("XDG_CACHE_HOME");
+	home = getenv("HOME");
+	if (dir && dir[0] == '/')
+		len = asprintf(&path, "%s/weston/keymap-%016llx.xkb",
+			       dir, (unsigned long long) hash);
+	else if (home)
+		len = asprintf(&path, "%s/.cache/weston/keymap-%016llx.xkb",
+			       home, (unsigned long long) hash);
+	else
+		return NULL;
+
+	return len < 0 ? NULL : path;
+}
+
+static char *
+keymap_cache_load(const char *path, const char *key)
+{
+	struct stat st;
+	char *buffer;
+	ssize_t len;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0 || st.st_size <= (off_t) strlen(key)) {
+		close(fd);
+		return NULL;
+	}
+
+	buffer = malloc(st.st_size + 1);
+	if (buffer == NULL) {
+		close(fd);
+		return NULL;
+	}
+
+	len = read(fd, buffer, st.st_size);
+	close(fd);
+	if (len != st.st_size ||
+	    strncmp(buffer, key, strlen(key)) != 0) {
+		free(buffer);
+		return NULL;
+	}
+	buffer[len] = '\0';
+
+	return buffer;
+}
+
+static int
+make_parent_dir(char *path)
+{
+	char *p = strrchr(path, '/');
+	int ret;
+
+	if (p == NULL || p == path)
+		return 0;
+
+	*p = '\0';
+	ret = mkdir(path, 0700);
+	if (ret < 0 && errno == ENOENT && make_parent_dir(path) == 0)
+		ret = mkdir(path, 0700);
+	if (ret < 0 && errno == EEXIST)
+		ret = 0;
+	*p = '/';
+
+	return ret;
+}
+
+static void
+keymap_cache_store(char *path, const char *key, const char *text)
+{
+	size_t key_len = strlen(key), text_len = strlen(text);
+	char *tmp;
+	int fd;
+
+	if (make_parent_dir(path) < 0 ||
+	    asprintf(&tmp, "%s.XXXXXX", path) < 0)
+		return;
+
+	/* Written under a temporary name and renamed into place, so a
+	 * concurrently starting compositor never sees a partial file. */
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		free(tmp);
+		return;
+	}
+
+	if (write(fd, key, key_len) != (ssize_t) key_len ||
+	    write(fd, text, text_len) != (ssize_t) text_len ||
+	    close(fd) < 0 ||
+	    rename(tmp, path) < 0) {
+		weston_log("failed to write keymap cache %s: %m\n", path);
+		unlink(tmp);
+	}
+
+	free(tmp);
+}
+
 static int
 weston_compositor_build_global_keymap(struct weston_compositor *ec)
 {
-	struct xkb_keymap *keymap;
+	struct xkb_keymap *keymap = NULL;
+	char *key = NULL, *path = NULL, *cached = NULL;
+	const char *text = NULL;
+	uint64_t begin;
 
 	if (ec->xkb_info != NULL)
 		return 0;
 
-	keymap = xkb_keymap_new_from_names(ec->xkb_context,
-					   &ec->xkb_names,
-					   0);
+	begin = weston_startup_begin();
+
+	if (ec->use_keymap_cache &&
+	    (key = keymap_cache_key(ec)) != NULL &&
+	    (path = keymap_cache_path(key)) != NULL &&
+	    (cached = keymap_cache_load(path, key)) != NULL) {
+		text = cached + strlen(key);
+		keymap = xkb_keymap_new_from_string(ec->xkb_context, text,
+						    XKB_KEYMAP_FORMAT_TEXT_V1,
+						    0);
+		if (keymap == NULL) {
+			weston_log("ignoring unusable keymap cache %s\n", path);
+			text = NULL;
+		}
+	}
+
+	if (keymap == NULL)
+		keymap = xkb_keymap_new_from_names(ec->xkb_context,
+						   &ec->xkb_names,
+						   0);
 	if (keymap == NULL) {
 		weston_log("failed to compile global XKB keymap\n");
 		weston_log("  tried rules %s, model %s, layout %s, variant %s, "
@@ -2056,15 +2482,26 @@ weston_compositor_build_global_keymap(struct weston_compositor *ec)
 			ec->xkb_names.rules, ec->xkb_names.model,
 			ec->xkb_names.layout, ec->xkb_names.variant,
 			ec->xkb_names.options);
-		return -1;
+		goto out;
 	}
 
-	ec->xkb_info = weston_xkb_info_create(keymap);
+	ec->xkb_info = weston_xkb_info_create(keymap, text);
 	xkb_keymap_unref(keymap);
 	if (ec->xkb_info == NULL)
-		return -1;
+		goto out;
 
-	return 0;
+	if (text == NULL && path != NULL)
+		keymap_cache_store(path, key, ec->xkb_info->keymap_area);
+
+	weston_startup_end("keymap", text ? "cached" : ec->xkb_names.layout,
+			   begin);
+
+out:
+	free(cached);
+	free(path);
+	free(key);
+
+	return ec->xkb_info ? 0 : -1;
 }
 #else
 int
@@ -2119,7 +2556,8 @@ weston_seat_init_keyboard(struct weston_seat *seat, struct xkb_keymap *keymap)
 #ifdef ENABLE_XKBCOMMON
 	if (seat->compositor->use_xkbcommon) {
 		if (keymap != NULL) {
-			keyboard->xkb_info = weston_xkb_info_create(keymap);
+			keyboard->xkb_info =
+				weston_xkb_info_get(seat->compositor, keymap);
 			if (keyboard->xkb_info == NULL)
 				goto err;
 		} else {
@@ -2230,6 +2668,7 @@ weston_seat_release_pointer(struct weston_seat *seat)
 			pointer_unmap_sprite(pointer);
 
 		weston_pointer_reset_state(pointer);
+		pointer->motion_pending = 0;
 		seat_send_updated_caps(seat);
 
 		/* seat->pointer is intentionally not destroyed so that
@@ -2282,6 +2721,7 @@ weston_seat_init(struct weston_seat *seat, struct weston_compositor *ec,
 
 	seat->selection_data_source = NULL;
 	wl_list_init(&seat->base_resource_list);
+	wl_list_init(&seat->client_list);
 	wl_signal_init(&seat->selection_signal);
 	wl_list_init(&seat->drag_resource_list);
 	wl_signal_init(&seat->destroy_signal);
@@ -2304,6 +2744,8 @@ weston_seat_init(struct weston_seat *seat, struct weston_compositor *ec,
 WL_EXPORT void
 weston_seat_release(struct weston_seat *seat)
 {
+	struct seat_client *sc, *next;
+
 	wl_list_remove(&seat->link);
 
 	if (seat->saved_kbd_focus)
@@ -2316,6 +2758,9 @@ weston_seat_release(struct weston_seat *seat)
 	if (seat->touch)
 		weston_touch_destroy(seat->touch);
 
+	wl_list_for_each_safe(sc, next, &seat->client_list, link)
+		seat_client_destroy(sc);
+
 	free (seat->seat_name);
 
 	wl_global_destroy(seat->global);
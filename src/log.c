@@ -26,6 +26,12 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
 #include <sys/time.h>
 #include <time.h>
 
@@ -37,6 +43,359 @@ static FILE *weston_logfile = NULL;
 
 static int cached_tm_mday = -1;
 
+/* Asynchronous logging.
+ *
+ * Messages are formatted by the caller into a single-producer,
+ * single-consumer byte ring, and a writer thread drains the ring to the
+ * log file with plain write(2), so a slow log device never stalls the
+ * main loop. Only the main thread may log while this is on. The ring
+ * indices only ever grow; they are reduced modulo the power of two size
+ * when accessing the data.
+ */
+struct log_ring {
+	char *data;
+	size_t size;
+	size_t head;		/* written by the producer */
+	size_t tail;		/* written by the writer thread */
+	uint32_t dropped;
+	int block;
+
+	int fd;
+	int wake_fd;
+	int writer_idle;
+	int running;
+	pthread_t thread;
+};
+
+static struct log_ring *log_ring_;
+
+#define LOG_LINE_SIZE 1024
+
+/* The pieces of one message (timestamp, text) are collected here and
+ * pushed to the ring as one, so a full ring drops whole messages. */
+static struct {
+	char data[LOG_LINE_SIZE];
+	size_t len;
+} log_pending_;
+
+static void
+log_ring_wake(struct log_ring *r, int force)
+{
+	uint64_t one = 1;
+
+	if (__atomic_exchange_n(&r->writer_idle, 0, __ATOMIC_SEQ_CST) ||
+	    force) {
+		if (write(r->wake_fd, &one, sizeof one) < 0)
+			return;
+	}
+}
+
+static void
+log_ring_push(struct log_ring *r, const char *buf, size_t len)
+{
+	size_t head, tail, offset, n;
+	struct timespec pause = { 0, 1000000 };
+
+	if (len > r->size)
+		len = r->size;
+
+	head = r->head;
+	while (1) {
+		tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		if (r->size - (head - tail) >= len)
+			break;
+
+		if (!r->block) {
+			__atomic_add_fetch(&r->dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+
+		log_ring_wake(r, 0);
+		nanosleep(&pause, NULL);
+	}
+
+	offset = head & (r->size - 1);
+	n = r->size - offset;
+	if (n > len)
+		n = len;
+	memcpy(r->data + offset, buf, n);
+	memcpy(r->data, buf + n, len - n);
+
+	__atomic_store_n(&r->head, head + len, __ATOMIC_SEQ_CST);
+	log_ring_wake(r, 0);
+}
+
+static void
+log_write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, buf, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		buf += n;
+		len -= n;
+	}
+}
+
+/* Writes out what is in the ring at the time of the call. Returns 0 if
+ * the ring was empty. */
+static int
+log_ring_drain(struct log_ring *r)
+{
+	size_t head, tail, offset, n;
+	uint32_t dropped;
+	char msg[64];
+
+	head = __atomic_load_n(&r->head, __ATOMIC_SEQ_CST);
+	tail = r->tail;
+
+	dropped = __atomic_exchange_n(&r->dropped, 0, __ATOMIC_RELAXED);
+	if (dropped > 0) {
+		n = snprintf(msg, sizeof msg,
+			     "[%u log messages dropped]\n", dropped);
+		log_write_all(r->fd, msg, n);
+	}
+
+	if (head == tail)
+		return 0;
+
+	while (tail != head) {
+		offset = tail & (r->size - 1);
+		n = r->size - offset;
+		if (n > head - tail)
+			n = head - tail;
+		log_write_all(r->fd, r->data + offset, n);
+		tail += n;
+	}
+
+	__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+static void *
+log_writer_thread(void *data)
+{
+	struct log_ring *r = data;
+	uint64_t value;
+
+	while (1) {
+		if (log_ring_drain(r))
+			continue;
+
+		if (!__atomic_load_n(&r->running, __ATOMIC_SEQ_CST))
+			break;
+
+		__atomic_store_n(&r->writer_idle, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&r->head, __ATOMIC_SEQ_CST) != r->tail ||
+		    !__atomic_load_n(&r->running, __ATOMIC_SEQ_CST)) {
+			__atomic_store_n(&r->writer_idle, 0, __ATOMIC_SEQ_CST);
+			continue;
+		}
+
+		if (read(r->wake_fd, &value, sizeof value) < 0 &&
+		    errno != EINTR)
+			break;
+	}
+
+	return NULL;
+}
+
+static void
+log_ring_destroy(struct log_ring *r)
+{
+	close(r->wake_fd);
+	free(r->data);
+	free(r);
+}
+
+/** Switch weston_log() to asynchronous mode
+ *
+ * \param size Ring buffer size in bytes, rounded up to a power of two.
+ * \param block If set, logging waits for room in a full ring instead of
+ * dropping the message; dropped messages are counted in the log.
+ */
+void
+weston_log_async_start(size_t size, int block)
+{
+	struct log_ring *r;
+	sigset_t set, old;
+	int ret;
+
+	if (log_ring_ || !weston_logfile)
+		return;
+
+	r = zalloc(sizeof *r);
+	if (!r)
+		return;
+
+	r->size = LOG_LINE_SIZE;
+	while (r->size < size)
+		r->size <<= 1;
+	r->data = malloc(r->size);
+	r->block = block;
+	r->running = 1;
+	r->fd = fileno(weston_logfile);
+	r->wake_fd = eventfd(0, EFD_CLOEXEC);
+	if (!r->data || r->wake_fd < 0) {
+		if (r->wake_fd >= 0)
+			close(r->wake_fd);
+		free(r->data);
+		free(r);
+		weston_log("failed to set up asynchronous logging\n");
+		return;
+	}
+
+	fflush(weston_logfile);
+
+	/* Leave all signals to the main thread. */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, &old);
+	ret = pthread_create(&r->thread, NULL, log_writer_thread, r);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret != 0) {
+		log_ring_destroy(r);
+		weston_log("failed to start the log writer thread\n");
+		return;
+	}
+
+	log_ring_ = r;
+	weston_log("Asynchronous logging, %zu byte buffer, %s when full\n",
+		   r->size, block ? "blocking" : "dropping messages");
+}
+
+static void
+log_async_stop(void)
+{
+	struct log_ring *r = log_ring_;
+
+	if (!r)
+		return;
+
+	log_ring_ = NULL;
+	__atomic_store_n(&r->running, 0, __ATOMIC_SEQ_CST);
+	log_ring_wake(r, 1);
+	pthread_join(r->thread, NULL);
+	log_ring_destroy(r);
+}
+
+/** Write out all buffered log messages now
+ *
+ * Meant for the crash path: logging goes synchronous from here on. The
+ * writer thread is given a moment to finish; if it does not, because it
+ * is the thread that crashed or is stuck on the log device, the ring is
+ * written out from the calling thread instead. The ring is not freed, as
+ * the writer may still be using it.
+ */
+void
+weston_log_flush(void)
+{
+	struct log_ring *r = log_ring_;
+	struct timespec pause = { 0, 1000000 };
+	int i;
+
+	if (!r) {
+		if (weston_logfile)
+			fflush(weston_logfile);
+		return;
+	}
+
+	log_ring_ = NULL;
+
+	if (!pthread_equal(pthread_self(), r->thread)) {
+		log_ring_wake(r, 1);
+		for (i = 0; i < 1000; i++) {
+			if (__atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) ==
+			    r->head)
+				return;
+			nanosleep(&pause, NULL);
+		}
+	}
+
+	log_ring_drain(r);
+}
+
+static void
+log_commit(void)
+{
+	if (log_ring_ && log_pending_.len > 0)
+		log_ring_push(log_ring_, log_pending_.data, log_pending_.len);
+	log_pending_.len = 0;
+}
+
+static void
+log_emit(const char *str, size_t len)
+{
+	if (log_pending_.len + len > sizeof log_pending_.data)
+		log_commit();
+
+	if (len > sizeof log_pending_.data) {
+		log_ring_push(log_ring_, str, len);
+		return;
+	}
+
+	memcpy(log_pending_.data + log_pending_.len, str, len);
+	log_pending_.len += len;
+}
+
+static int
+log_vformat(const char *fmt, va_list ap)
+{
+	char line[LOG_LINE_SIZE];
+	char *str = line;
+	va_list copy;
+	int len;
+
+	va_copy(copy, ap);
+	len = vsnprintf(line, sizeof line, fmt, copy);
+	va_end(copy);
+	if (len < 0)
+		return len;
+
+	if ((size_t)len >= sizeof line) {
+		str = malloc(len + 1);
+		if (!str) {
+			str = line;
+			len = sizeof line - 1;
+		} else {
+			vsnprintf(str, len + 1, fmt, ap);
+		}
+	}
+
+	log_emit(str, len);
+
+	if (str != line)
+		free(str);
+
+	return len;
+}
+
+static int
+log_vprintf(const char *fmt, va_list ap)
+{
+	if (!log_ring_)
+		return vfprintf(weston_logfile, fmt, ap);
+
+	return log_vformat(fmt, ap);
+}
+
+static int
+log_printf(const char *fmt, ...)
+{
+	int l;
+	va_list argp;
+
+	va_start(argp, fmt);
+	l = log_vprintf(fmt, argp);
+	va_end(argp);
+
+	return l;
+}
+
 static int weston_log_timestamp(void)
 {
 	struct timeval tv;
@@ -47,26 +406,27 @@ static int weston_log_timestamp(void)
 
 	brokendown_time = localtime(&tv.tv_sec);
 	if (brokendown_time == NULL)
-		return fprintf(weston_logfile, "[(NULL)localtime] ");
+		return log_printf("[(NULL)localtime] ");
 
 	if (brokendown_time->tm_mday != cached_tm_mday) {
 		strftime(string, sizeof string, "%Y-%m-%d %Z", brokendown_time);
-		fprintf(weston_logfile, "Date: %s\n", string);
+		log_printf("Date: %s\n", string);
 
 		cached_tm_mday = brokendown_time->tm_mday;
 	}
 
 	strftime(string, sizeof string, "%H:%M:%S", brokendown_time);
 
-	return fprintf(weston_logfile, "[%s.%03li] ", string, tv.tv_usec/1000);
+	return log_printf("[%s.%03li] ", string, tv.tv_usec/1000);
 }
 
 static void
 custom_handler(const char *fmt, va_list arg)
 {
 	weston_log_timestamp();
-	fprintf(weston_logfile, "libwayland: ");
-	vfprintf(weston_logfile, fmt, arg);
+	log_printf("libwayland: ");
+	log_vprintf(fmt, arg);
+	log_commit();
 }
 
 void
@@ -86,6 +446,8 @@ weston_log_file_open(const char *filename)
 void
 weston_log_file_close()
 {
+	log_async_stop();
+
 	if ((weston_logfile != stderr) && (weston_logfile != NULL))
 		fclose(weston_logfile);
 	weston_logfile = stderr;
@@ -97,7 +459,8 @@ weston_vlog(const char *fmt, va_list ap)
 	int l;
 
 	l = weston_log_timestamp();
-	l += vfprintf(weston_logfile, fmt, ap);
+	l += log_vprintf(fmt, ap);
+	log_commit();
 
 	return l;
 }
@@ -118,7 +481,12 @@ weston_log(const char *fmt, ...)
 WL_EXPORT int
 weston_vlog_continue(const char *fmt, va_list argp)
 {
-	return vfprintf(weston_logfile, fmt, argp);
+	int l;
+
+	l = log_vprintf(fmt, argp);
+	log_commit();
+
+	return l;
 }
 
 WL_EXPORT int
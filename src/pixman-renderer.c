@@ -26,6 +26,8 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "pixman-renderer.h"
 
@@ -41,6 +43,7 @@ struct pixman_surface_state {
 	struct weston_surface *surface;
 
 	pixman_image_t *image;
+	pixman_color_t color; /* if image is a solid fill */
 	struct weston_buffer_reference buffer_ref;
 
 	struct wl_listener buffer_destroy_listener;
@@ -48,6 +51,48 @@ struct pixman_surface_state {
 	struct wl_listener renderer_destroy_listener;
 };
 
+/* One composite recorded while walking the view list, replayed by the
+ * render threads. Everything needed is copied out of the views and
+ * surfaces so the workers never touch compositor state.
+ */
+struct pixman_draw_op {
+	pixman_op_t op;
+	pixman_region32_t region; /* output coordinates */
+	pixman_transform_t transform;
+	pixman_filter_t filter;
+	float alpha;
+
+	/* source: a bits image if bits is set, a solid fill otherwise */
+	pixman_format_code_t format;
+	int width, height, stride;
+	uint32_t *bits;
+	pixman_color_t color;
+	struct wl_shm_buffer *shm_buffer;
+};
+
+/* The threads split a single output repaint into bands. Outputs are
+ * still repainted one after another, each from its own frame timer, so
+ * the pool serves one output at a time.
+ */
+struct pixman_render_pool {
+	pthread_t *threads;
+	int n_threads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t job_cond;
+	pthread_cond_t done_cond;
+	int quit;
+
+	/* current job, protected by mutex */
+	struct weston_output *output;
+	int n_bands;
+	int next_band;
+	int bands_done;
+
+	struct wl_array ops; /* struct pixman_draw_op */
+	pixman_region32_t hw_damage; /* output coordinates */
+};
+
 struct pixman_renderer {
 	struct weston_renderer base;
 
@@ -55,9 +100,15 @@ struct pixman_renderer {
 	pixman_image_t *debug_color;
 	struct weston_binding *debug_binding;
 
+	struct pixman_render_pool *pool;
+
 	struct wl_signal destroy_signal;
 };
 
+static const pixman_color_t debug_red = {
+	0x3fff, 0x0000, 0x0000, 0x3fff
+};
+
 static inline struct pixman_output_state *
 get_output_state(struct weston_output *output)
 {
@@ -168,6 +219,165 @@ transform_apply_viewport(pixman_transform_t *transform,
 	pixman_transform_translate(transform, NULL, D2F(src_x), D2F(src_y));
 }
 
+static void
+record_draw_op(struct pixman_render_pool *pool,
+	       struct pixman_surface_state *ps,
+	       pixman_region32_t *region, pixman_transform_t *transform,
+	       pixman_filter_t filter, pixman_op_t pixman_op, float alpha)
+{
+	struct pixman_draw_op *op;
+
+	op = wl_array_add(&pool->ops, sizeof *op);
+	if (!op) {
+		weston_log("pixman renderer: out of memory recording draw\n");
+		return;
+	}
+
+	op->op = pixman_op;
+	pixman_region32_init(&op->region);
+	pixman_region32_copy(&op->region, region);
+	op->transform = *transform;
+	op->filter = filter;
+	op->alpha = alpha;
+
+	op->bits = pixman_image_get_data(ps->image);
+	if (op->bits) {
+		op->format = pixman_image_get_format(ps->image);
+		op->width = pixman_image_get_width(ps->image);
+		op->height = pixman_image_get_height(ps->image);
+		op->stride = pixman_image_get_stride(ps->image);
+	}
+	op->color = ps->color;
+
+	if (ps->buffer_ref.buffer)
+		op->shm_buffer = ps->buffer_ref.buffer->shm_buffer;
+	else
+		op->shm_buffer = NULL;
+}
+
+/* Appends the transformation from global to buffer coordinates of the
+ * view to transform. */
+static void
+view_source_transform(struct weston_view *ev, pixman_transform_t *transform)
+{
+	struct weston_buffer_viewport *vp = &ev->surface->buffer_viewport;
+	pixman_fixed_t fw, fh;
+
+	if (ev->transform.enabled) {
+		/* Pixman supports only 2D transform matrix, but Weston uses 3D,
+		 * so we're omitting Z coordinate here
+		 */
+		pixman_transform_t surface_transform = {{
+				{ D2F(ev->transform.matrix.d[0]),
+				  D2F(ev->transform.matrix.d[4]),
+				  D2F(ev->transform.matrix.d[12]),
+				},
+				{ D2F(ev->transform.matrix.d[1]),
+				  D2F(ev->transform.matrix.d[5]),
+				  D2F(ev->transform.matrix.d[13]),
+				},
+				{ D2F(ev->transform.matrix.d[3]),
+				  D2F(ev->transform.matrix.d[7]),
+				  D2F(ev->transform.matrix.d[15]),
+				}
+			}};
+
+		pixman_transform_invert(&surface_transform, &surface_transform);
+		pixman_transform_multiply (transform, &surface_transform, transform);
+	} else {
+		pixman_transform_translate(transform, NULL,
+					   pixman_double_to_fixed ((double)-ev->geometry.x),
+					   pixman_double_to_fixed ((double)-ev->geometry.y));
+	}
+
+	transform_apply_viewport(transform, ev->surface);
+
+	fw = pixman_int_to_fixed(ev->surface->width_from_buffer);
+	fh = pixman_int_to_fixed(ev->surface->height_from_buffer);
+
+	switch (vp->buffer.transform) {
+	case WL_OUTPUT_TRANSFORM_FLIPPED:
+	case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+	case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+	case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+		pixman_transform_scale(transform, NULL,
+				       pixman_int_to_fixed (-1),
+				       pixman_int_to_fixed (1));
+		pixman_transform_translate(transform, NULL, fw, 0);
+		break;
+	}
+
+	switch (vp->buffer.transform) {
+	default:
+	case WL_OUTPUT_TRANSFORM_NORMAL:
+	case WL_OUTPUT_TRANSFORM_FLIPPED:
+		break;
+	case WL_OUTPUT_TRANSFORM_90:
+	case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+		pixman_transform_rotate(transform, NULL, 0, pixman_fixed_1);
+		pixman_transform_translate(transform, NULL, fh, 0);
+		break;
+	case WL_OUTPUT_TRANSFORM_180:
+	case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+		pixman_transform_rotate(transform, NULL, -pixman_fixed_1, 0);
+		pixman_transform_translate(transform, NULL, fw, fh);
+		break;
+	case WL_OUTPUT_TRANSFORM_270:
+	case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+		pixman_transform_rotate(transform, NULL, 0, -pixman_fixed_1);
+		pixman_transform_translate(transform, NULL, 0, fw);
+		break;
+	}
+
+	pixman_transform_scale(transform, NULL,
+			       pixman_double_to_fixed(vp->buffer.scale),
+			       pixman_double_to_fixed(vp->buffer.scale));
+}
+
+/* Composites the surface image through transform, from dest to buffer
+ * coordinates, into the region of dest. Leaves dest clipped to it. */
+static void
+composite_surface(struct pixman_surface_state *ps, float alpha,
+		  pixman_image_t *dest, pixman_region32_t *region,
+		  pixman_transform_t *transform, pixman_filter_t filter,
+		  pixman_op_t pixman_op)
+{
+	pixman_image_t *mask_image;
+	pixman_color_t mask = { 0, };
+
+	/* And clip to it */
+	pixman_image_set_clip_region32 (dest, region);
+
+	pixman_image_set_transform(ps->image, transform);
+	pixman_image_set_filter(ps->image, filter, NULL, 0);
+
+	if (ps->buffer_ref.buffer)
+		wl_shm_buffer_begin_access(ps->buffer_ref.buffer->shm_buffer);
+
+	if (alpha < 1.0) {
+		mask.alpha = 0xffff * alpha;
+		mask_image = pixman_image_create_solid_fill(&mask);
+	} else {
+		mask_image = NULL;
+	}
+
+	pixman_image_composite32(pixman_op,
+				 ps->image, /* src */
+				 mask_image, /* mask */
+				 dest, /* dest */
+				 0, 0, /* src_x, src_y */
+				 0, 0, /* mask_x, mask_y */
+				 0, 0, /* dest_x, dest_y */
+				 pixman_image_get_width (dest), /* width */
+				 pixman_image_get_height (dest) /* height */);
+
+	if (mask_image)
+		pixman_image_unref(mask_image);
+
+	if (ps->buffer_ref.buffer)
+		wl_shm_buffer_end_access(ps->buffer_ref.buffer->shm_buffer);
+}
+
 static void
 repaint_region(struct weston_view *ev, struct weston_output *output,
 	       pixman_region32_t *region, pixman_region32_t *surf_region,
@@ -181,9 +391,8 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 	pixman_region32_t final_region;
 	float view_x, view_y;
 	pixman_transform_t transform;
+	pixman_filter_t filter;
 	pixman_fixed_t fw, fh;
-	pixman_image_t *mask_image;
-	pixman_color_t mask = { 0, };
 
 	/* The final region to be painted is the intersection of
 	 * 'region' and 'surf_region'. However, 'region' is in the global
@@ -212,9 +421,6 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 	/* Convert from global to output coord */
 	region_global_to_output(output, &final_region);
 
-	/* And clip to it */
-	pixman_image_set_clip_region32 (po->shadow_image, &final_region);
-
 	/* Set up the source transformation based on the surface
 	   position, the output position/transform/scale and the client
 	   specified buffer transform/scale */
@@ -263,108 +469,22 @@ repaint_region(struct weston_view *ev, struct weston_output *output,
 				   pixman_double_to_fixed (output->x),
 				   pixman_double_to_fixed (output->y));
 
-	if (ev->transform.enabled) {
-		/* Pixman supports only 2D transform matrix, but Weston uses 3D,
-		 * so we're omitting Z coordinate here
-		 */
-		pixman_transform_t surface_transform = {{
-				{ D2F(ev->transform.matrix.d[0]),
-				  D2F(ev->transform.matrix.d[4]),
-				  D2F(ev->transform.matrix.d[12]),
-				},
-				{ D2F(ev->transform.matrix.d[1]),
-				  D2F(ev->transform.matrix.d[5]),
-				  D2F(ev->transform.matrix.d[13]),
-				},
-				{ D2F(ev->transform.matrix.d[3]),
-				  D2F(ev->transform.matrix.d[7]),
-				  D2F(ev->transform.matrix.d[15]),
-				}
-			}};
-
-		pixman_transform_invert(&surface_transform, &surface_transform);
-		pixman_transform_multiply (&transform, &surface_transform, &transform);
-	} else {
-		pixman_transform_translate(&transform, NULL,
-					   pixman_double_to_fixed ((double)-ev->geometry.x),
-					   pixman_double_to_fixed ((double)-ev->geometry.y));
-	}
-
-	transform_apply_viewport(&transform, ev->surface);
-
-	fw = pixman_int_to_fixed(ev->surface->width_from_buffer);
-	fh = pixman_int_to_fixed(ev->surface->height_from_buffer);
-
-	switch (vp->buffer.transform) {
-	case WL_OUTPUT_TRANSFORM_FLIPPED:
-	case WL_OUTPUT_TRANSFORM_FLIPPED_90:
-	case WL_OUTPUT_TRANSFORM_FLIPPED_180:
-	case WL_OUTPUT_TRANSFORM_FLIPPED_270:
-		pixman_transform_scale(&transform, NULL,
-				       pixman_int_to_fixed (-1),
-				       pixman_int_to_fixed (1));
-		pixman_transform_translate(&transform, NULL, fw, 0);
-		break;
-	}
-
-	switch (vp->buffer.transform) {
-	default:
-	case WL_OUTPUT_TRANSFORM_NORMAL:
-	case WL_OUTPUT_TRANSFORM_FLIPPED:
-		break;
-	case WL_OUTPUT_TRANSFORM_90:
-	case WL_OUTPUT_TRANSFORM_FLIPPED_90:
-		pixman_transform_rotate(&transform, NULL, 0, pixman_fixed_1);
-		pixman_transform_translate(&transform, NULL, fh, 0);
-		break;
-	case WL_OUTPUT_TRANSFORM_180:
-	case WL_OUTPUT_TRANSFORM_FLIPPED_180:
-		pixman_transform_rotate(&transform, NULL, -pixman_fixed_1, 0);
-		pixman_transform_translate(&transform, NULL, fw, fh);
-		break;
-	case WL_OUTPUT_TRANSFORM_270:
-	case WL_OUTPUT_TRANSFORM_FLIPPED_270:
-		pixman_transform_rotate(&transform, NULL, 0, -pixman_fixed_1);
-		pixman_transform_translate(&transform, NULL, 0, fw);
-		break;
-	}
-
-	pixman_transform_scale(&transform, NULL,
-			       pixman_double_to_fixed(vp->buffer.scale),
-			       pixman_double_to_fixed(vp->buffer.scale));
-
-	pixman_image_set_transform(ps->image, &transform);
+	view_source_transform(ev, &transform);
 
 	if (ev->transform.enabled || output->current_scale != vp->buffer.scale)
-		pixman_image_set_filter(ps->image, PIXMAN_FILTER_BILINEAR, NULL, 0);
+		filter = PIXMAN_FILTER_BILINEAR;
 	else
-		pixman_image_set_filter(ps->image, PIXMAN_FILTER_NEAREST, NULL, 0);
+		filter = PIXMAN_FILTER_NEAREST;
 
-	if (ps->buffer_ref.buffer)
-		wl_shm_buffer_begin_access(ps->buffer_ref.buffer->shm_buffer);
-
-	if (ev->alpha < 1.0) {
-		mask.alpha = 0xffff * ev->alpha;
-		mask_image = pixman_image_create_solid_fill(&mask);
-	} else {
-		mask_image = NULL;
+	if (pr->pool) {
+		record_draw_op(pr->pool, ps, &final_region, &transform,
+			       filter, pixman_op, ev->alpha);
+		pixman_region32_fini(&final_region);
+		return;
 	}
 
-	pixman_image_composite32(pixman_op,
-				 ps->image, /* src */
-				 mask_image, /* mask */
-				 po->shadow_image, /* dest */
-				 0, 0, /* src_x, src_y */
-				 0, 0, /* mask_x, mask_y */
-				 0, 0, /* dest_x, dest_y */
-				 pixman_image_get_width (po->shadow_image), /* width */
-				 pixman_image_get_height (po->shadow_image) /* height */);
-
-	if (mask_image)
-		pixman_image_unref(mask_image);
-
-	if (ps->buffer_ref.buffer)
-		wl_shm_buffer_end_access(ps->buffer_ref.buffer->shm_buffer);
+	composite_surface(ps, ev->alpha, po->shadow_image, &final_region,
+			  &transform, filter, pixman_op);
 
 	if (pr->repaint_debug)
 		pixman_image_composite32(PIXMAN_OP_OVER,
@@ -442,10 +562,76 @@ repaint_surfaces(struct weston_output *output, pixman_region32_t *damage)
 	struct weston_view *view;
 
 	wl_list_for_each_reverse(view, &compositor->view_list, link)
-		if (view->plane == &compositor->primary_plane)
+		if (view->plane == &compositor->primary_plane &&
+		    !view->cache.owner)
 			draw_view(view, output, damage);
 }
 
+/* Composites the members into the image of the cache surface. This is
+ * done in place of the render threads, as caches are rendered seldom. */
+static int
+pixman_renderer_view_cache_render(struct weston_view_cache *cache,
+				  struct weston_output *output)
+{
+	struct pixman_surface_state *cs = get_surface_state(cache->surface);
+	struct pixman_surface_state *ps;
+	struct weston_view *view;
+	int32_t x = cache->view->geometry.x;
+	int32_t y = cache->view->geometry.y;
+	int32_t width = cache->surface->width;
+	int32_t height = cache->surface->height;
+	pixman_region32_t region;
+	pixman_transform_t transform;
+	pixman_filter_t filter;
+
+	if (cs->image &&
+	    (pixman_image_get_width(cs->image) != width ||
+	     pixman_image_get_height(cs->image) != height)) {
+		pixman_image_unref(cs->image);
+		cs->image = NULL;
+	}
+
+	if (!cs->image) {
+		cs->image = pixman_image_create_bits(PIXMAN_a8r8g8b8,
+						     width, height, NULL, 0);
+		if (!cs->image)
+			return -1;
+	} else {
+		memset(pixman_image_get_data(cs->image), 0,
+		       pixman_image_get_stride(cs->image) * height);
+	}
+
+	pixman_region32_init(&region);
+	wl_list_for_each(view, &cache->view_list, cache.link) {
+		ps = get_surface_state(view->surface);
+		if (!ps->image)
+			continue;
+
+		pixman_region32_intersect_rect(&region,
+					       &view->transform.boundingbox,
+					       x, y, width, height);
+		pixman_region32_translate(&region, -x, -y);
+
+		pixman_transform_init_translate(&transform,
+						pixman_int_to_fixed(x),
+						pixman_int_to_fixed(y));
+		view_source_transform(view, &transform);
+
+		if (view->transform.enabled ||
+		    view->surface->buffer_viewport.buffer.scale != 1)
+			filter = PIXMAN_FILTER_BILINEAR;
+		else
+			filter = PIXMAN_FILTER_NEAREST;
+
+		composite_surface(ps, view->alpha, cs->image, &region,
+				  &transform, filter, PIXMAN_OP_OVER);
+	}
+	pixman_image_set_clip_region32(cs->image, NULL);
+	pixman_region32_fini(&region);
+
+	return 0;
+}
+
 static void
 copy_to_hw_buffer(struct weston_output *output, pixman_region32_t *region)
 {
@@ -473,17 +659,271 @@ copy_to_hw_buffer(struct weston_output *output, pixman_region32_t *region)
 	pixman_image_set_clip_region32 (po->hw_buffer, NULL);
 }
 
+static pixman_image_t *
+draw_op_create_source(const struct pixman_draw_op *op)
+{
+	pixman_image_t *image;
+
+	if (!op->bits)
+		return pixman_image_create_solid_fill(&op->color);
+
+	image = pixman_image_create_bits(op->format, op->width, op->height,
+					 op->bits, op->stride);
+	if (!image)
+		return NULL;
+
+	pixman_image_set_transform(image, &op->transform);
+	pixman_image_set_filter(image, op->filter, NULL, 0);
+
+	return image;
+}
+
+/* Composite all recorded ops clipped to one horizontal band of the
+ * output, then copy the band to the hardware buffer. Runs on a render
+ * thread. Pixman images are not safe to share between threads, so every
+ * image used here is a private wrapper around the shared pixels; bands
+ * never overlap, so neither do the writes.
+ */
+static void
+render_band(struct pixman_renderer *pr, struct weston_output *output,
+	    int band, int n_bands)
+{
+	struct pixman_render_pool *pool = pr->pool;
+	struct pixman_output_state *po = get_output_state(output);
+	struct pixman_draw_op *op;
+	pixman_image_t *dest, *src, *mask_image, *hw;
+	pixman_color_t mask = { 0, };
+	pixman_region32_t clip;
+	int width, height, y1, y2;
+
+	width = pixman_image_get_width(po->shadow_image);
+	height = pixman_image_get_height(po->shadow_image);
+	y1 = height * band / n_bands;
+	y2 = height * (band + 1) / n_bands;
+
+	dest = pixman_image_create_bits(pixman_image_get_format(po->shadow_image),
+					width, height, po->shadow_buffer,
+					pixman_image_get_stride(po->shadow_image));
+	if (!dest)
+		return;
+
+	pixman_region32_init(&clip);
+
+	wl_array_for_each(op, &pool->ops) {
+		pixman_region32_intersect_rect(&clip, &op->region,
+					       0, y1, width, y2 - y1);
+		if (!pixman_region32_not_empty(&clip))
+			continue;
+
+		src = draw_op_create_source(op);
+		if (!src)
+			continue;
+
+		if (op->alpha < 1.0) {
+			mask.alpha = 0xffff * op->alpha;
+			mask_image = pixman_image_create_solid_fill(&mask);
+		} else {
+			mask_image = NULL;
+		}
+
+		pixman_image_set_clip_region32(dest, &clip);
+
+		/* SIGBUS protection is per thread, and the pool
+		 * bookkeeping is not thread safe. */
+		if (op->shm_buffer) {
+			pthread_mutex_lock(&pool->mutex);
+			wl_shm_buffer_begin_access(op->shm_buffer);
+			pthread_mutex_unlock(&pool->mutex);
+		}
+
+		pixman_image_composite32(op->op, src, mask_image, dest,
+					 0, 0, 0, 0, 0, 0, width, height);
+
+		if (op->shm_buffer) {
+			pthread_mutex_lock(&pool->mutex);
+			wl_shm_buffer_end_access(op->shm_buffer);
+			pthread_mutex_unlock(&pool->mutex);
+		}
+
+		if (pr->repaint_debug) {
+			pixman_image_t *debug;
+
+			debug = pixman_image_create_solid_fill(&debug_red);
+			pixman_image_composite32(PIXMAN_OP_OVER, debug, NULL,
+						 dest, 0, 0, 0, 0, 0, 0,
+						 width, height);
+			pixman_image_unref(debug);
+		}
+
+		if (mask_image)
+			pixman_image_unref(mask_image);
+		pixman_image_unref(src);
+	}
+
+	pixman_image_set_clip_region32(dest, NULL);
+
+	pixman_region32_intersect_rect(&clip, &pool->hw_damage,
+				       0, y1, width, y2 - y1);
+	hw = pixman_image_create_bits(pixman_image_get_format(po->hw_buffer),
+				      pixman_image_get_width(po->hw_buffer),
+				      pixman_image_get_height(po->hw_buffer),
+				      pixman_image_get_data(po->hw_buffer),
+				      pixman_image_get_stride(po->hw_buffer));
+	if (hw && pixman_region32_not_empty(&clip)) {
+		pixman_image_set_clip_region32(hw, &clip);
+		pixman_image_composite32(PIXMAN_OP_SRC, dest, NULL, hw,
+					 0, 0, 0, 0, 0, 0,
+					 pixman_image_get_width(hw),
+					 pixman_image_get_height(hw));
+	}
+	if (hw)
+		pixman_image_unref(hw);
+
+	pixman_region32_fini(&clip);
+	pixman_image_unref(dest);
+}
+
+static void *
+render_thread_main(void *data)
+{
+	struct pixman_renderer *pr = data;
+	struct pixman_render_pool *pool = pr->pool;
+	struct weston_output *output;
+	int band, n_bands;
+
+	pthread_mutex_lock(&pool->mutex);
+	for (;;) {
+		while (!pool->quit && pool->next_band >= pool->n_bands)
+			pthread_cond_wait(&pool->job_cond, &pool->mutex);
+		if (pool->quit)
+			break;
+
+		band = pool->next_band++;
+		n_bands = pool->n_bands;
+		output = pool->output;
+		pthread_mutex_unlock(&pool->mutex);
+
+		render_band(pr, output, band, n_bands);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (++pool->bands_done == n_bands)
+			pthread_cond_signal(&pool->done_cond);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+static void
+repaint_output_threaded(struct pixman_renderer *pr,
+			struct weston_output *output,
+			pixman_region32_t *output_damage)
+{
+	struct pixman_render_pool *pool = pr->pool;
+	struct pixman_draw_op *op;
+
+	/* Snapshot the scene into the op list on this thread... */
+	pool->ops.size = 0;
+	repaint_surfaces(output, output_damage);
+
+	pixman_region32_copy(&pool->hw_damage, output_damage);
+	region_global_to_output(output, &pool->hw_damage);
+
+	/* ...and let the render threads replay it, one band each. */
+	pthread_mutex_lock(&pool->mutex);
+	pool->output = output;
+	pool->n_bands = pool->n_threads;
+	pool->next_band = 0;
+	pool->bands_done = 0;
+	pthread_cond_broadcast(&pool->job_cond);
+	while (pool->bands_done < pool->n_bands)
+		pthread_cond_wait(&pool->done_cond, &pool->mutex);
+	pool->n_bands = 0;
+	pool->next_band = 0;
+	pool->output = NULL;
+	pthread_mutex_unlock(&pool->mutex);
+
+	wl_array_for_each(op, &pool->ops)
+		pixman_region32_fini(&op->region);
+}
+
+static void
+render_pool_destroy(struct pixman_render_pool *pool)
+{
+	int i;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->job_cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (i = 0; i < pool->n_threads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->job_cond);
+	pthread_mutex_destroy(&pool->mutex);
+	pixman_region32_fini(&pool->hw_damage);
+	wl_array_release(&pool->ops);
+	free(pool->threads);
+	free(pool);
+}
+
+static int
+render_pool_create(struct pixman_renderer *pr, int n_threads)
+{
+	struct pixman_render_pool *pool;
+
+	pool = zalloc(sizeof *pool);
+	if (!pool)
+		return -1;
+
+	pool->threads = calloc(n_threads, sizeof *pool->threads);
+	if (!pool->threads) {
+		free(pool);
+		return -1;
+	}
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->job_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+	pixman_region32_init(&pool->hw_damage);
+	wl_array_init(&pool->ops);
+
+	pr->pool = pool;
+
+	for (pool->n_threads = 0; pool->n_threads < n_threads;
+	     pool->n_threads++) {
+		if (pthread_create(&pool->threads[pool->n_threads], NULL,
+				   render_thread_main, pr) != 0)
+			break;
+	}
+
+	if (pool->n_threads == 0) {
+		pr->pool = NULL;
+		render_pool_destroy(pool);
+		return -1;
+	}
+
+	return 0;
+}
+
 static void
 pixman_renderer_repaint_output(struct weston_output *output,
 			     pixman_region32_t *output_damage)
 {
 	struct pixman_output_state *po = get_output_state(output);
+	struct pixman_renderer *pr = get_renderer(output->compositor);
 
 	if (!po->hw_buffer)
 		return;
 
-	repaint_surfaces(output, output_damage);
-	copy_to_hw_buffer(output, output_damage);
+	if (pr->pool) {
+		repaint_output_threaded(pr, output, output_damage);
+	} else {
+		repaint_surfaces(output, output_damage);
+		copy_to_hw_buffer(output, output_damage);
+	}
 
 	pixman_region32_copy(&output->previous_damage, output_damage);
 	wl_signal_emit(&output->frame_signal, output);
@@ -655,7 +1095,8 @@ pixman_renderer_surface_set_color(struct weston_surface *es,
 	color.green = green * 0xffff;
 	color.blue = blue * 0xffff;
 	color.alpha = alpha * 0xffff;
-	
+	ps->color = color;
+
 	if (ps->image) {
 		pixman_image_unref(ps->image);
 		ps->image = NULL;
@@ -671,6 +1112,8 @@ pixman_renderer_destroy(struct weston_compositor *ec)
 
 	wl_signal_emit(&pr->destroy_signal, pr);
 	weston_binding_destroy(pr->debug_binding);
+	if (pr->pool)
+		render_pool_destroy(pr->pool);
 	free(pr);
 
 	ec->renderer = NULL;
@@ -733,11 +1176,7 @@ debug_binding(struct weston_seat *seat, uint32_t time, uint32_t key,
 	pr->repaint_debug ^= 1;
 
 	if (pr->repaint_debug) {
-		pixman_color_t red = {
-			0x3fff, 0x0000, 0x0000, 0x3fff
-		};
-
-		pr->debug_color = pixman_image_create_solid_fill(&red);
+		pr->debug_color = pixman_image_create_solid_fill(&debug_red);
 	} else {
 		pixman_image_unref(pr->debug_color);
 		weston_compositor_damage_all(ec);
@@ -748,6 +1187,8 @@ WL_EXPORT int
 pixman_renderer_init(struct weston_compositor *ec)
 {
 	struct pixman_renderer *renderer;
+	struct weston_config_section *section;
+	int32_t threads;
 
 	renderer = zalloc(sizeof *renderer);
 	if (renderer == NULL)
@@ -765,6 +1206,7 @@ pixman_renderer_init(struct weston_compositor *ec)
 		pixman_renderer_surface_get_content_size;
 	renderer->base.surface_copy_content =
 		pixman_renderer_surface_copy_content;
+	renderer->base.view_cache_render = pixman_renderer_view_cache_render;
 	ec->renderer = &renderer->base;
 	ec->capabilities |= WESTON_CAP_ROTATION_ANY;
 	ec->capabilities |= WESTON_CAP_CAPTURE_YFLIP;
@@ -777,6 +1219,17 @@ pixman_renderer_init(struct weston_compositor *ec)
 
 	wl_signal_init(&renderer->destroy_signal);
 
+	section = weston_config_get_section(ec->config, "core", NULL, NULL);
+	weston_config_section_get_int(section, "pixman-threads", &threads, 0);
+	if (threads > 0) {
+		if (render_pool_create(renderer, threads) < 0)
+			weston_log("pixman renderer: failed to start render "
+				   "threads, compositing on the main thread\n");
+		else
+			weston_log("pixman renderer: compositing with %d "
+				   "render threads\n", renderer->pool->n_threads);
+	}
+
 	return 0;
 }
 
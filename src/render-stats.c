@@ -0,0 +1,180 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <wayland-server.h>
+
+#include "compositor.h"
+#include "render-stats.h"
+
+/* Per-frame accounting of the work handed to the renderer.
+ *
+ * The numbers are derived from the scene graph rather than from inside a
+ * renderer: for every view on the primary plane, the part of the output
+ * damage it covers and that is not occluded is what both the GL and the
+ * pixman renderer draw, split into an opaque part drawn with the source
+ * operator and a blended part. That keeps the statistics identical for
+ * every renderer, the noop one included, so tests can assert on them.
+ */
+
+int weston_render_stats_enabled_;
+
+/* Uploads happen while accumulating damage, before the output that
+ * triggered them is repainted; they are charged to that repaint. */
+static uint64_t pending_upload_bytes;
+
+static uint64_t
+region_area(pixman_region32_t *region)
+{
+	pixman_box32_t *rects;
+	uint64_t area = 0;
+	int i, n;
+
+	rects = pixman_region32_rectangles(region, &n);
+	for (i = 0; i < n; i++)
+		area += (uint64_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+
+	return area;
+}
+
+static void
+add_region(pixman_region32_t *region, uint32_t *rects, uint64_t *pixels)
+{
+	int n;
+
+	pixman_region32_rectangles(region, &n);
+	*rects += n;
+	*pixels += region_area(region);
+}
+
+/* Counts the shm data the renderer is asked to upload for the surface
+ * damage. Renderers that sample shm buffers directly, like pixman,
+ * copy nothing, but the number still tells how much changed. */
+void
+weston_render_stats_record_upload(struct weston_surface *surface)
+{
+	struct wl_shm_buffer *shm_buffer;
+	pixman_region32_t damage;
+	int32_t scale = surface->buffer_viewport.buffer.scale;
+	int bpp = 4;
+
+	shm_buffer = wl_shm_buffer_get(surface->buffer_ref.buffer->resource);
+	if (!shm_buffer)
+		return;
+
+	if (wl_shm_buffer_get_format(shm_buffer) == WL_SHM_FORMAT_RGB565)
+		bpp = 2;
+
+	pixman_region32_init_rect(&damage, 0, 0,
+				  surface->width, surface->height);
+	pixman_region32_intersect(&damage, &damage, &surface->damage);
+	pending_upload_bytes += region_area(&damage) * scale * scale * bpp;
+	pixman_region32_fini(&damage);
+}
+
+/* The part of the view the renderers draw without blending, in global
+ * coordinates: the surface opaque region, as long as the view has full
+ * alpha and at most a translation. This matches draw_view() in the
+ * pixman and GL renderers, not view->transform.opaque, which is empty
+ * for every view with transform.enabled. */
+static void
+view_drawn_opaque(struct weston_view *view, pixman_region32_t *opaque)
+{
+	float x, y;
+
+	pixman_region32_clear(opaque);
+
+	if (view->alpha != 1.0 ||
+	    (view->transform.enabled &&
+	     view->transform.matrix.type != WESTON_MATRIX_TRANSFORM_TRANSLATE))
+		return;
+
+	pixman_region32_copy(opaque, &view->surface->opaque);
+	if (!view->transform.enabled) {
+		pixman_region32_translate(opaque,
+					  view->geometry.x, view->geometry.y);
+	} else {
+		weston_view_to_global_float(view, 0, 0, &x, &y);
+		pixman_region32_translate(opaque, (int)x, (int)y);
+	}
+}
+
+void
+weston_render_stats_record_repaint(struct weston_output *output,
+				   pixman_region32_t *damage)
+{
+	struct weston_compositor *ec = output->compositor;
+	struct weston_render_stats *stats = &output->render_stats;
+	pixman_region32_t repaint, part, opaque;
+	struct weston_view *view;
+
+	stats->frames++;
+	stats->views = 0;
+	stats->opaque_rects = 0;
+	stats->blended_rects = 0;
+	stats->opaque_pixels = 0;
+	stats->blended_pixels = 0;
+	stats->damage_pixels = region_area(damage);
+	stats->upload_bytes = pending_upload_bytes;
+	pending_upload_bytes = 0;
+
+	pixman_region32_init(&repaint);
+	pixman_region32_init(&part);
+	pixman_region32_init(&opaque);
+
+	wl_list_for_each(view, &ec->view_list, link) {
+		if (view->plane != &ec->primary_plane || view->cache.owner)
+			continue;
+
+		/* Nothing is drawn for views without a buffer. */
+		if (!view->surface->buffer_ref.buffer)
+			continue;
+
+		pixman_region32_intersect(&repaint,
+					  &view->transform.boundingbox, damage);
+		pixman_region32_subtract(&repaint, &repaint, &view->clip);
+		if (!pixman_region32_not_empty(&repaint))
+			continue;
+
+		stats->views++;
+
+		view_drawn_opaque(view, &opaque);
+		pixman_region32_intersect(&part, &repaint, &opaque);
+		add_region(&part, &stats->opaque_rects, &stats->opaque_pixels);
+
+		pixman_region32_subtract(&part, &repaint, &opaque);
+		add_region(&part, &stats->blended_rects,
+			   &stats->blended_pixels);
+	}
+
+	pixman_region32_fini(&opaque);
+	pixman_region32_fini(&part);
+	pixman_region32_fini(&repaint);
+}
+
+WL_EXPORT void
+weston_render_stats_enable(struct weston_compositor *compositor)
+{
+	weston_render_stats_enabled_ = 1;
+}
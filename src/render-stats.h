@@ -0,0 +1,50 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WESTON_RENDER_STATS_H
+#define WESTON_RENDER_STATS_H
+
+#include <pixman.h>
+
+extern int weston_render_stats_enabled_;
+
+struct weston_output;
+struct weston_surface;
+
+void
+weston_render_stats_record_upload(struct weston_surface *surface);
+
+void
+weston_render_stats_record_repaint(struct weston_output *output,
+				   pixman_region32_t *damage);
+
+#define RENDER_STATS_UPLOAD(surface) do { \
+	if (weston_render_stats_enabled_) \
+		weston_render_stats_record_upload(surface); \
+} while (0)
+
+#define RENDER_STATS_REPAINT(output, damage) do { \
+	if (weston_render_stats_enabled_) \
+		weston_render_stats_record_repaint(output, damage); \
+} while (0)
+
+#endif /* WESTON_RENDER_STATS_H */
@@ -0,0 +1,228 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "compositor.h"
+#include "startup-profile.h"
+
+/* Startup profiling.
+ *
+ * Every phase of bring-up, from the start of main() until the first
+ * frame of a client has been repainted, is recorded as a span of
+ * CLOCK_MONOTONIC time: parsing the config, loading and initializing the
+ * backend and each module, compiling keymaps and shaders. The first
+ * repaint and the first client frame are recorded as instants. The
+ * profile is written to the log once the first client frame has been
+ * repainted, or at shutdown if that never happens, and to the start of
+ * every timeline log. Helper clients the compositor launches itself,
+ * like the shell's panel and background, do not count as clients here.
+ *
+ * Recording stops with the report, so the hooks in the repaint and
+ * commit paths cost a single flag test afterwards.
+ */
+
+#define STARTUP_MAX_SPANS 128
+
+struct startup_span {
+	const char *phase;
+	char detail[64];
+	struct timespec begin;
+	struct timespec end;
+};
+
+struct startup_profile {
+	struct timespec start;
+	struct startup_span spans[STARTUP_MAX_SPANS];
+	int count;
+	int client_committed;
+	int repainted;
+};
+
+int weston_startup_profiling_;
+static struct startup_profile profile_;
+
+static double
+timespec_ms(const struct timespec *a, const struct timespec *b)
+{
+	return (a->tv_sec - b->tv_sec) * 1000.0 +
+	       (a->tv_nsec - b->tv_nsec) / 1000000.0;
+}
+
+static void
+add_span(const char *phase, const char *detail,
+	 const struct timespec *begin, const struct timespec *end)
+{
+	struct startup_span *span;
+
+	if (profile_.count == STARTUP_MAX_SPANS)
+		return;
+
+	span = &profile_.spans[profile_.count++];
+	span->phase = phase;
+	snprintf(span->detail, sizeof span->detail, "%s", detail ? detail : "");
+	span->begin = *begin;
+	span->end = *end;
+}
+
+void
+weston_startup_init(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &profile_.start);
+	weston_startup_profiling_ = 1;
+}
+
+WL_EXPORT uint64_t
+weston_startup_begin(void)
+{
+	struct timespec ts;
+
+	if (!weston_startup_profiling_)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+WL_EXPORT void
+weston_startup_end(const char *phase, const char *detail, uint64_t begin)
+{
+	struct timespec b, e;
+
+	if (!weston_startup_profiling_ || begin == 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &e);
+	b.tv_sec = begin / 1000000000;
+	b.tv_nsec = begin % 1000000000;
+	add_span(phase, detail, &b, &e);
+}
+
+void
+weston_startup_mark(const char *event)
+{
+	struct timespec ts;
+
+	if (!weston_startup_profiling_)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	add_span(event, NULL, &ts, &ts);
+}
+
+static void
+helper_client_destroyed(struct wl_listener *listener, void *data)
+{
+	wl_list_remove(&listener->link);
+	free(listener);
+}
+
+void
+weston_startup_helper_client(struct wl_client *client)
+{
+	struct wl_listener *listener;
+
+	listener = zalloc(sizeof *listener);
+	if (!listener)
+		return;
+
+	listener->notify = helper_client_destroyed;
+	wl_client_add_destroy_listener(client, listener);
+}
+
+void
+weston_startup_client_commit(struct weston_surface *surface)
+{
+	struct wl_client *client;
+
+	if (profile_.client_committed || !surface->pending.buffer ||
+	    !surface->resource)
+		return;
+
+	client = wl_resource_get_client(surface->resource);
+	if (wl_client_get_destroy_listener(client, helper_client_destroyed))
+		return;
+
+	profile_.client_committed = 1;
+	weston_startup_mark("first client commit");
+}
+
+void
+weston_startup_repaint(struct weston_output *output)
+{
+	if (!profile_.repainted) {
+		profile_.repainted = 1;
+		weston_startup_mark("first repaint");
+	}
+
+	/* Commits are only handled between repaints, so this repaint
+	 * showed the first client frame. */
+	if (profile_.client_committed) {
+		weston_startup_mark("first client frame");
+		weston_startup_report();
+	}
+}
+
+void
+weston_startup_for_each(weston_startup_span_func_t func, void *data)
+{
+	int i;
+
+	for (i = 0; i < profile_.count; i++)
+		func(profile_.spans[i].phase, profile_.spans[i].detail,
+		     &profile_.spans[i].begin, &profile_.spans[i].end, data);
+}
+
+void
+weston_startup_report(void)
+{
+	struct startup_span *span;
+	int i;
+
+	if (!weston_startup_profiling_)
+		return;
+
+	weston_startup_profiling_ = 0;
+
+	weston_log("Startup profile, in ms since the start of main():\n");
+	for (i = 0; i < profile_.count; i++) {
+		span = &profile_.spans[i];
+		if (timespec_ms(&span->end, &span->begin) == 0.0)
+			weston_log_continue(STAMP_SPACE "%9.2f            %s\n",
+					    timespec_ms(&span->begin,
+							&profile_.start),
+					    span->phase);
+		else
+			weston_log_continue(STAMP_SPACE "%9.2f %9.2f  %s%s%s\n",
+					    timespec_ms(&span->begin,
+							&profile_.start),
+					    timespec_ms(&span->end,
+							&span->begin),
+					    span->phase,
+					    span->detail[0] ? " " : "",
+					    span->detail);
+	}
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WESTON_STARTUP_PROFILE_H
+#define WESTON_STARTUP_PROFILE_H
+
+#include <time.h>
+
+/* Set until the first client frame has been repainted. */
+extern int weston_startup_profiling_;
+
+struct weston_output;
+struct weston_surface;
+struct wl_client;
+
+void
+weston_startup_init(void);
+
+void
+weston_startup_mark(const char *event);
+
+void
+weston_startup_helper_client(struct wl_client *client);
+
+void
+weston_startup_client_commit(struct weston_surface *surface);
+
+void
+weston_startup_repaint(struct weston_output *output);
+
+void
+weston_startup_report(void);
+
+typedef void (*weston_startup_span_func_t)(const char *phase,
+					   const char *detail,
+					   const struct timespec *begin,
+					   const struct timespec *end,
+					   void *data);
+
+void
+weston_startup_for_each(weston_startup_span_func_t func, void *data);
+
+#define STARTUP_CLIENT_COMMIT(surface) do { \
+	if (weston_startup_profiling_) \
+		weston_startup_client_commit(surface); \
+} while (0)
+
+#define STARTUP_HELPER_CLIENT(client) do { \
+	if (weston_startup_profiling_) \
+		weston_startup_helper_client(client); \
+} while (0)
+
+#define STARTUP_REPAINT(output) do { \
+	if (weston_startup_profiling_) \
+		weston_startup_repaint(output); \
+} while (0)
+
+#endif /* WESTON_STARTUP_PROFILE_H */
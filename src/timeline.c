@@ -32,6 +32,7 @@
 #include "timeline.h"
 #include "compositor.h"
 #include "file-util.h"
+#include "startup-profile.h"
 
 struct timeline_log {
 	clock_t clk_id;
@@ -40,8 +41,32 @@ struct timeline_log {
 	struct wl_listener compositor_destroy_listener;
 };
 
+/* The most recent timeline points are also kept in memory when asked
+ * to, independently of the log file, so that they can be dumped after
+ * the fact, e.g. when the watchdog notices a stall.
+ */
+#define TIMELINE_HISTORY_SIZE 256
+
+struct timeline_history_entry {
+	struct timespec ts;
+	const char *name;
+	enum timeline_type otype;
+	union {
+		uint32_t output_id;
+		void *surface;
+		struct timespec vblank;
+	} obj;
+};
+
+struct timeline_history {
+	struct timeline_history_entry entries[TIMELINE_HISTORY_SIZE];
+	unsigned count;
+};
+
 WL_EXPORT int weston_timeline_enabled_;
+WL_EXPORT int weston_timeline_history_enabled_;
 static struct timeline_log timeline_ = { CLOCK_MONOTONIC, NULL, 0 };
+static struct timeline_history *history_;
 
 static int
 weston_timeline_do_open(void)
@@ -73,6 +98,21 @@ weston_timeline_do_open(void)
 	return 0;
 }
 
+static void
+timeline_emit_startup_span(const char *phase, const char *detail,
+			   const struct timespec *begin,
+			   const struct timespec *end, void *data)
+{
+	FILE *fp = data;
+
+	fprintf(fp, "{ \"T\":[%" PRId64 ", %ld], \"N\":\"startup_begin\", "
+		"\"phase\":\"%s\", \"detail\":\"%s\" }\n",
+		(int64_t)begin->tv_sec, begin->tv_nsec, phase, detail);
+	fprintf(fp, "{ \"T\":[%" PRId64 ", %ld], \"N\":\"startup_end\", "
+		"\"phase\":\"%s\", \"detail\":\"%s\" }\n",
+		(int64_t)end->tv_sec, end->tv_nsec, phase, detail);
+}
+
 static void
 timeline_notify_destroy(struct wl_listener *listener, void *data)
 {
@@ -95,6 +135,9 @@ weston_timeline_open(struct weston_compositor *compositor)
 	if (++timeline_.series == 0)
 		++timeline_.series;
 
+	/* Every log starts with how the compositor came up. */
+	weston_startup_for_each(timeline_emit_startup_span, timeline_.file);
+
 	weston_timeline_enabled_ = 1;
 }
 
@@ -237,6 +280,111 @@ static const type_func type_dispatch[] = {
 	[TLT_VBLANK] = emit_vblank_timestamp,
 };
 
+void
+weston_timeline_history_enable(void)
+{
+	if (weston_timeline_history_enabled_)
+		return;
+
+	history_ = zalloc(sizeof *history_);
+	if (!history_) {
+		weston_log("Timeline history: out of memory.\n");
+		return;
+	}
+
+	weston_timeline_history_enabled_ = 1;
+}
+
+static void
+history_record(const struct timespec *ts, const char *name, va_list argp)
+{
+	struct timeline_history_entry *e;
+	void *obj;
+
+	e = &history_->entries[history_->count++ % TIMELINE_HISTORY_SIZE];
+	e->ts = *ts;
+	e->name = name;
+
+	/* Only the first object of a point is kept; objects may be gone
+	 * by the time the history is dumped, so nothing is dereferenced
+	 * later. */
+	e->otype = va_arg(argp, enum timeline_type);
+	if (e->otype == TLT_END)
+		return;
+
+	obj = va_arg(argp, void *);
+	switch (e->otype) {
+	case TLT_OUTPUT:
+		e->obj.output_id = ((struct weston_output *)obj)->id;
+		break;
+	case TLT_SURFACE:
+		e->obj.surface = obj;
+		break;
+	case TLT_VBLANK:
+		e->obj.vblank = *(struct timespec *)obj;
+		break;
+	default:
+		e->otype = TLT_END;
+		break;
+	}
+}
+
+static int64_t
+timespec_diff_us(const struct timespec *a, const struct timespec *b)
+{
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000 +
+	       (a->tv_nsec - b->tv_nsec) / 1000;
+}
+
+/** Log the in-memory timeline history
+ *
+ * Points are printed oldest first, with their age relative to now.
+ */
+void
+weston_timeline_history_dump(void)
+{
+	struct timeline_history_entry *e;
+	struct timespec now;
+	unsigned i, first;
+	int64_t age;
+
+	if (!weston_timeline_history_enabled_)
+		return;
+
+	clock_gettime(timeline_.clk_id, &now);
+
+	first = 0;
+	if (history_->count > TIMELINE_HISTORY_SIZE)
+		first = history_->count - TIMELINE_HISTORY_SIZE;
+
+	weston_log("Last %u timeline points:\n", history_->count - first);
+	for (i = first; i != history_->count; i++) {
+		e = &history_->entries[i % TIMELINE_HISTORY_SIZE];
+		age = timespec_diff_us(&now, &e->ts);
+
+		weston_log_continue(STAMP_SPACE "-%" PRId64 ".%03d ms %s",
+				    age / 1000, (int)(age % 1000), e->name);
+		switch (e->otype) {
+		case TLT_OUTPUT:
+			weston_log_continue(" output %u\n",
+					    e->obj.output_id);
+			break;
+		case TLT_SURFACE:
+			weston_log_continue(" surface %p\n",
+					    e->obj.surface);
+			break;
+		case TLT_VBLANK:
+			weston_log_continue(" vblank -%" PRId64 " us\n",
+					    timespec_diff_us(&now,
+							     &e->obj.vblank));
+			break;
+		default:
+			weston_log_continue("\n");
+			break;
+		}
+	}
+}
+
 WL_EXPORT void
 weston_timeline_point(const char *name, ...)
 {
@@ -249,6 +397,15 @@ weston_timeline_point(const char *name, ...)
 
 	clock_gettime(timeline_.clk_id, &ts);
 
+	if (weston_timeline_history_enabled_) {
+		va_start(argp, name);
+		history_record(&ts, name, argp);
+		va_end(argp);
+	}
+
+	if (!weston_timeline_enabled_)
+		return;
+
 	ctx.out = timeline_.file;
 	ctx.cur = fmemopen(buf, sizeof(buf), "w");
 	ctx.series = timeline_.series;
@@ -25,6 +25,7 @@
 #define WESTON_TIMELINE_H
 
 extern int weston_timeline_enabled_;
+extern int weston_timeline_history_enabled_;
 
 struct weston_compositor;
 
@@ -34,6 +35,12 @@ weston_timeline_open(struct weston_compositor *compositor);
 void
 weston_timeline_close(void);
 
+void
+weston_timeline_history_enable(void);
+
+void
+weston_timeline_history_dump(void);
+
 enum timeline_type {
 	TLT_END = 0,
 	TLT_OUTPUT,
@@ -52,7 +59,7 @@ enum timeline_type {
 #define TLP_VBLANK(t) TLT_VBLANK, TYPEVERIFY(const struct timespec *, (t))
 
 #define TL_POINT(...) do { \
-	if (weston_timeline_enabled_) \
+	if (weston_timeline_enabled_ || weston_timeline_history_enabled_) \
 		weston_timeline_point(__VA_ARGS__); \
 } while (0)
 
@@ -0,0 +1,295 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compositor.h"
+#include "../shared/zalloc.h"
+
+WL_EXPORT struct weston_view_cache *
+weston_view_cache_create(struct weston_compositor *compositor)
+{
+	struct weston_view_cache *cache;
+	pixman_region32_t input;
+
+	if (!compositor->renderer->view_cache_render)
+		return NULL;
+
+	cache = zalloc(sizeof *cache);
+	if (cache == NULL)
+		return NULL;
+
+	cache->surface = weston_surface_create(compositor);
+	if (cache->surface == NULL)
+		goto err_cache;
+
+	cache->view = weston_view_create(cache->surface);
+	if (cache->view == NULL)
+		goto err_surface;
+
+	/* The members take the input, the image only shows them. */
+	pixman_region32_init(&input);
+	weston_surface_set_input_region(cache->surface, &input);
+	pixman_region32_fini(&input);
+
+	cache->compositor = compositor;
+	wl_list_init(&cache->view_list);
+	wl_list_insert(&compositor->view_cache_list, &cache->link);
+
+	return cache;
+
+err_surface:
+	weston_surface_destroy(cache->surface);
+err_cache:
+	free(cache);
+	return NULL;
+}
+
+WL_EXPORT void
+weston_view_cache_destroy(struct weston_view_cache *cache)
+{
+	struct weston_view *view, *next;
+
+	wl_list_for_each_safe(view, next, &cache->view_list, cache.link)
+		weston_view_cache_remove_view(view);
+
+	wl_list_remove(&cache->link);
+	weston_surface_destroy(cache->surface);
+	free(cache);
+}
+
+WL_EXPORT void
+weston_view_cache_remove_view(struct weston_view *view)
+{
+	view->cache.owner->dirty = 1;
+	view->cache.owner = NULL;
+	wl_list_remove(&view->cache.link);
+	wl_list_init(&view->cache.link);
+
+	/* Brings back its opaque region */
+	weston_view_geometry_dirty(view);
+}
+
+/* The image would be stacked above the subsurfaces of a member, which
+ * are not in it, so such a view cannot be cached. */
+static int
+view_has_subsurfaces(struct weston_view *view)
+{
+	return !wl_list_empty(&view->surface->subsurface_list);
+}
+
+/** Set the members of a cache, bottom first
+ *
+ * A view leaves any other cache it was in. Setting the same views in the
+ * same order again keeps the image. If any of the views has subsurfaces,
+ * the cache is left without members and they are drawn as usual.
+ */
+WL_EXPORT void
+weston_view_cache_set_views(struct weston_view_cache *cache,
+			    struct weston_view **views, int count)
+{
+	struct weston_view *view, *next;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (view_has_subsurfaces(views[i])) {
+			count = 0;
+			break;
+		}
+	}
+
+	i = 0;
+	wl_list_for_each(view, &cache->view_list, cache.link) {
+		if (i == count || views[i] != view)
+			break;
+		i++;
+	}
+	if (i == count && i == wl_list_length(&cache->view_list))
+		return;
+
+	wl_list_for_each_safe(view, next, &cache->view_list, cache.link)
+		weston_view_cache_remove_view(view);
+
+	for (i = 0; i < count; i++) {
+		view = views[i];
+		if (view->cache.owner)
+			weston_view_cache_remove_view(view);
+
+		view->cache.owner = cache;
+		wl_list_insert(cache->view_list.prev, &view->cache.link);
+		weston_view_geometry_dirty(view);
+	}
+
+	cache->dirty = 1;
+}
+
+/** Set where the cached content is anchored, in global coordinates
+ *
+ * Members that move along with the cache position keep the image; the
+ * cache view is moved instead.
+ */
+WL_EXPORT void
+weston_view_cache_set_position(struct weston_view_cache *cache,
+			       int32_t x, int32_t y)
+{
+	if (cache->x == x && cache->y == y)
+		return;
+
+	cache->x = x;
+	cache->y = y;
+	weston_view_set_position(cache->view,
+				 x + cache->image_x, y + cache->image_y);
+}
+
+/** Set the alpha the image is composited with
+ *
+ * This is applied on top of the alpha of each member, so an owner
+ * fading the whole set changes this rather than the members.
+ */
+WL_EXPORT void
+weston_view_cache_set_alpha(struct weston_view_cache *cache, float alpha)
+{
+	if (cache->view->alpha == alpha)
+		return;
+
+	cache->view->alpha = alpha;
+	weston_view_geometry_dirty(cache->view);
+}
+
+/* Records each member's transformation relative to the cache position
+ * and alpha, returns whether any of them differs from the last time. */
+static int
+view_cache_members_changed(struct weston_view_cache *cache)
+{
+	struct weston_view *view;
+	struct weston_matrix matrix;
+	int changed = 0;
+
+	wl_list_for_each(view, &cache->view_list, cache.link) {
+		matrix = view->transform.matrix;
+		weston_matrix_translate(&matrix, -cache->x, -cache->y, 0);
+
+		if (memcmp(matrix.d, view->cache.matrix.d,
+			   sizeof matrix.d) != 0 ||
+		    view->alpha != view->cache.alpha)
+			changed = 1;
+
+		view->cache.matrix = matrix;
+		view->cache.alpha = view->alpha;
+	}
+
+	return changed;
+}
+
+/* Hands the members back to the renderer once one of them gained a
+ * subsurface, see weston_view_cache_set_views(). */
+static void
+view_cache_drop_subsurface_members(struct weston_view_cache *cache)
+{
+	struct weston_compositor *ec = cache->compositor;
+	struct weston_view *view, *next;
+
+	wl_list_for_each(view, &cache->view_list, cache.link) {
+		if (view_has_subsurfaces(view))
+			break;
+	}
+	if (&view->cache.link == &cache->view_list)
+		return;
+
+	wl_list_for_each_safe(view, next, &cache->view_list, cache.link) {
+		pixman_region32_union(&ec->primary_plane.damage,
+				      &ec->primary_plane.damage,
+				      &view->transform.boundingbox);
+		weston_view_cache_remove_view(view);
+	}
+}
+
+static void
+view_cache_update(struct weston_view_cache *cache,
+		  struct weston_output *output)
+{
+	struct weston_compositor *ec = cache->compositor;
+	struct weston_view *view;
+	pixman_region32_t region;
+	pixman_box32_t *extents;
+	int32_t width, height;
+
+	view_cache_drop_subsurface_members(cache);
+
+	if (!view_cache_members_changed(cache) && !cache->dirty) {
+		if (!wl_list_empty(&cache->view_list))
+			cache->hits++;
+		return;
+	}
+
+	cache->dirty = 0;
+	cache->misses++;
+
+	/* The image covers the members' bounding boxes. */
+	pixman_region32_init(&region);
+	wl_list_for_each(view, &cache->view_list, cache.link)
+		pixman_region32_union(&region, &region,
+				      &view->transform.boundingbox);
+	extents = pixman_region32_extents(&region);
+	width = extents->x2 - extents->x1;
+	height = extents->y2 - extents->y1;
+	cache->image_x = extents->x1 - cache->x;
+	cache->image_y = extents->y1 - cache->y;
+	pixman_region32_fini(&region);
+
+	weston_surface_set_size(cache->surface, width, height);
+	weston_view_set_position(cache->view, cache->x + cache->image_x,
+				 cache->y + cache->image_y);
+	weston_view_update_transform(cache->view);
+	cache->bytes = (size_t) width * height * 4;
+
+	if (width == 0 || height == 0)
+		return;
+
+	if (ec->renderer->view_cache_render(cache, output) < 0)
+		weston_log("failed to render a view cache of %dx%d\n",
+			   width, height);
+
+	/* Damage was accumulated before the image changed, so redraw all
+	 * of it. */
+	pixman_region32_union(&ec->primary_plane.damage,
+			      &ec->primary_plane.damage,
+			      &cache->view->transform.boundingbox);
+}
+
+/* Called while repainting output, after damage was accumulated and the
+ * members' buffers were flushed to the renderer. */
+void
+weston_compositor_update_view_caches(struct weston_compositor *compositor,
+				     struct weston_output *output)
+{
+	struct weston_view_cache *cache;
+
+	if (!compositor->renderer->view_cache_render)
+		return;
+
+	wl_list_for_each(cache, &compositor->view_cache_list, link)
+		view_cache_update(cache, output);
+}
@@ -0,0 +1,342 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "compositor.h"
+#include "timeline.h"
+#include "watchdog.h"
+
+/* Main loop stall watchdog.
+ *
+ * libwayland offers no hook around a single event loop dispatch, so the
+ * main loop is probed from the outside: a helper thread posts a ping on
+ * an eventfd every half threshold, and the main loop answers it from an
+ * ordinary fd source. The time a ping waits for its answer is the time
+ * the loop was stuck in whatever it was dispatching. When a ping stays
+ * unanswered past the threshold, the helper thread signals the main
+ * thread, which records its own stack from the signal handler. Symbols
+ * are resolved and everything is logged, together with the recent
+ * timeline points, only once the main loop is responsive again.
+ *
+ * Output repaints are timed directly in weston_output_repaint().
+ */
+
+#define WATCHDOG_BACKTRACE_SIZE 32
+
+struct watchdog {
+	struct weston_compositor *compositor;
+	uint64_t threshold_ns;
+	uint32_t stalls;
+	int history_dumped;
+
+	pthread_t thread;
+	pthread_t main_thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	/* Protected by mutex. */
+	int running;
+	uint32_t ping_seq;
+	uint32_t pong_seq;
+	uint64_t ping_time;
+	int backtrace_requested;
+
+	int ping_fd;
+	struct wl_event_source *ping_source;
+
+	/* backtrace is filled in by the signal handler, for the ping
+	 * backtrace_seq. */
+	int signo;
+	volatile sig_atomic_t backtrace_seq;
+	volatile sig_atomic_t backtrace_count;
+	void *backtrace[WATCHDOG_BACKTRACE_SIZE];
+
+	struct wl_listener compositor_destroy_listener;
+};
+
+WL_EXPORT int weston_watchdog_armed_;
+static struct watchdog *watchdog_;
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+watchdog_signal_handler(int signo)
+{
+	struct watchdog *wd = watchdog_;
+	int saved_errno = errno;
+
+	if (wd && wd->backtrace_count == 0)
+		wd->backtrace_count =
+			weston_backtrace_capture(wd->backtrace,
+						 WATCHDOG_BACKTRACE_SIZE);
+
+	errno = saved_errno;
+}
+
+static void *
+watchdog_thread_main(void *data)
+{
+	struct watchdog *wd = data;
+	struct timespec deadline;
+	uint64_t one = 1;
+	uint64_t now, wake;
+	sigset_t set;
+
+	/* All signals are for the main thread to handle. */
+	sigfillset(&set);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	pthread_mutex_lock(&wd->mutex);
+	while (wd->running) {
+		now = now_ns();
+
+		if (wd->pong_seq == wd->ping_seq) {
+			wd->ping_seq++;
+			wd->ping_time = now;
+			wd->backtrace_requested = 0;
+			if (write(wd->ping_fd, &one, sizeof one) < 0)
+				wd->pong_seq = wd->ping_seq;
+		} else if (!wd->backtrace_requested &&
+			   now - wd->ping_time >= wd->threshold_ns) {
+			wd->backtrace_requested = 1;
+			wd->backtrace_seq = wd->ping_seq;
+			pthread_kill(wd->main_thread, wd->signo);
+		}
+
+		wake = now + wd->threshold_ns / 2;
+		deadline.tv_sec = wake / 1000000000;
+		deadline.tv_nsec = wake % 1000000000;
+		pthread_cond_timedwait(&wd->cond, &wd->mutex, &deadline);
+	}
+	pthread_mutex_unlock(&wd->mutex);
+
+	return NULL;
+}
+
+static void
+watchdog_log_duration(struct watchdog *wd, const char *what,
+		      uint64_t duration)
+{
+	wd->stalls++;
+	weston_log("watchdog: %s took %" PRIu64 ".%03u ms "
+		   "(threshold %" PRIu64 " ms, stall %u)\n", what,
+		   duration / 1000000, (unsigned)(duration / 1000 % 1000),
+		   wd->threshold_ns / 1000000, wd->stalls);
+}
+
+static int
+watchdog_handle_ping(int fd, uint32_t mask, void *data)
+{
+	struct watchdog *wd = data;
+	uint64_t value, latency;
+	uint32_t seq;
+
+	if (read(fd, &value, sizeof value) != sizeof value)
+		return 0;
+
+	pthread_mutex_lock(&wd->mutex);
+	seq = wd->ping_seq;
+	latency = now_ns() - wd->ping_time;
+	wd->pong_seq = seq;
+	pthread_mutex_unlock(&wd->mutex);
+
+	if (latency >= wd->threshold_ns) {
+		watchdog_log_duration(wd, "main loop dispatch", latency);
+		if (!wd->history_dumped)
+			weston_timeline_history_dump();
+
+		if (wd->backtrace_count > 0 &&
+		    (uint32_t)wd->backtrace_seq == seq) {
+			weston_log_continue(STAMP_SPACE
+					    "main thread while stalled:\n");
+			weston_backtrace_print(wd->backtrace,
+					       wd->backtrace_count);
+		}
+	}
+
+	wd->history_dumped = 0;
+	wd->backtrace_count = 0;
+
+	return 1;
+}
+
+void
+weston_watchdog_check_repaint(struct weston_output *output,
+			      uint64_t duration)
+{
+	struct watchdog *wd = watchdog_;
+	char what[64];
+
+	if (!wd || duration < wd->threshold_ns)
+		return;
+
+	snprintf(what, sizeof what, "repaint of output %s",
+		 output->name ? output->name : "(unnamed)");
+	watchdog_log_duration(wd, what, duration);
+
+	/* The dispatch this repaint ran in is reported as well, but the
+	 * history only needs to be printed once. */
+	weston_timeline_history_dump();
+	wd->history_dumped = 1;
+}
+
+static void
+watchdog_destroy(struct watchdog *wd)
+{
+	pthread_mutex_lock(&wd->mutex);
+	wd->running = 0;
+	pthread_cond_signal(&wd->cond);
+	pthread_mutex_unlock(&wd->mutex);
+	pthread_join(wd->thread, NULL);
+
+	signal(wd->signo, SIG_IGN);
+	weston_watchdog_armed_ = 0;
+	watchdog_ = NULL;
+
+	wl_list_remove(&wd->compositor_destroy_listener.link);
+	wl_event_source_remove(wd->ping_source);
+	close(wd->ping_fd);
+	pthread_cond_destroy(&wd->cond);
+	pthread_mutex_destroy(&wd->mutex);
+	free(wd);
+}
+
+static void
+watchdog_handle_compositor_destroy(struct wl_listener *listener,
+				   void *data)
+{
+	struct watchdog *wd =
+		container_of(listener, struct watchdog,
+			     compositor_destroy_listener);
+
+	watchdog_destroy(wd);
+}
+
+/** Arm the main loop watchdog
+ *
+ * Enabled by setting watchdog-threshold, in milliseconds, in the [core]
+ * section of weston.ini. Any event loop dispatch or output repaint
+ * taking longer than that is logged along with the last timeline
+ * points, and for stuck dispatches, the main thread's stack as it was
+ * while stuck.
+ */
+void
+weston_watchdog_init(struct weston_compositor *compositor)
+{
+	struct weston_config_section *section;
+	struct wl_event_loop *loop;
+	struct watchdog *wd;
+	struct sigaction action;
+	pthread_condattr_t attr;
+	int32_t threshold;
+
+	section = weston_config_get_section(compositor->config,
+					    "core", NULL, NULL);
+	weston_config_section_get_int(section, "watchdog-threshold",
+				      &threshold, 0);
+	if (threshold <= 0)
+		return;
+
+	wd = zalloc(sizeof *wd);
+	if (!wd)
+		return;
+
+	wd->compositor = compositor;
+	wd->threshold_ns = (uint64_t)threshold * 1000000;
+	wd->main_thread = pthread_self();
+	wd->signo = SIGRTMIN;
+
+	wd->ping_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (wd->ping_fd < 0) {
+		weston_log("watchdog: eventfd failed: %m\n");
+		free(wd);
+		return;
+	}
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+	wd->ping_source = wl_event_loop_add_fd(loop, wd->ping_fd,
+					       WL_EVENT_READABLE,
+					       watchdog_handle_ping, wd);
+	if (!wd->ping_source) {
+		close(wd->ping_fd);
+		free(wd);
+		return;
+	}
+
+	pthread_mutex_init(&wd->mutex, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&wd->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	/* Have the unwinder load and set itself up now rather than in
+	 * signal context. */
+	weston_backtrace_capture(wd->backtrace, WATCHDOG_BACKTRACE_SIZE);
+
+	memset(&action, 0, sizeof action);
+	action.sa_handler = watchdog_signal_handler;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(wd->signo, &action, NULL);
+
+	weston_timeline_history_enable();
+	watchdog_ = wd;
+	weston_watchdog_armed_ = 1;
+
+	wd->running = 1;
+	if (pthread_create(&wd->thread, NULL, watchdog_thread_main, wd) != 0) {
+		weston_log("watchdog: failed to start thread\n");
+		signal(wd->signo, SIG_IGN);
+		weston_watchdog_armed_ = 0;
+		watchdog_ = NULL;
+		wl_event_source_remove(wd->ping_source);
+		close(wd->ping_fd);
+		pthread_cond_destroy(&wd->cond);
+		pthread_mutex_destroy(&wd->mutex);
+		free(wd);
+		return;
+	}
+
+	wd->compositor_destroy_listener.notify =
+		watchdog_handle_compositor_destroy;
+	wl_signal_add(&compositor->destroy_signal,
+		      &wd->compositor_destroy_listener);
+
+	weston_log("Main loop watchdog armed, threshold %d ms\n", threshold);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WESTON_WATCHDOG_H
+#define WESTON_WATCHDOG_H
+
+#include <stdint.h>
+
+extern int weston_watchdog_armed_;
+
+struct weston_compositor;
+struct weston_output;
+
+void
+weston_watchdog_init(struct weston_compositor *compositor);
+
+void
+weston_watchdog_check_repaint(struct weston_output *output,
+			      uint64_t duration);
+
+/* Implemented next to print_backtrace() in compositor.c. */
+int
+weston_backtrace_capture(void **ips, int max);
+
+void
+weston_backtrace_print(void *const *ips, int count);
+
+#define WATCHDOG_CHECK_REPAINT(output, duration) do { \
+	if (weston_watchdog_armed_) \
+		weston_watchdog_check_repaint(output, duration); \
+} while (0)
+
+#endif /* WESTON_WATCHDOG_H */
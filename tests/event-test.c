@@ -281,6 +281,32 @@ TEST(test_pointer_surface_move)
 	check_pointer(client, 50, 50);
 }
 
+TEST(test_pointer_surface_move_exposes)
+{
+	struct client *below, *above;
+
+	below = client_create(100, 100, 100, 100);
+	assert(below);
+	above = client_create(100, 100, 100, 100);
+	assert(above);
+
+	/* the pointer rests where the upper surface covers the lower one */
+	check_pointer_move(above, 150, 150);
+	client_roundtrip(below);
+	assert(below->input->pointer->focus == NULL);
+
+	/* moving the upper surface away exposes the lower one, which must
+	 * get the pointer without the pointer moving */
+	move_client(above, 300, 300);
+	assert(!surface_contains(above->surface, 150, 150));
+	check_pointer(above, 150, 150);
+
+	client_roundtrip(below);
+	assert(below->input->pointer->focus == below->surface);
+	assert(below->input->pointer->x == 50);
+	assert(below->input->pointer->y == 50);
+}
+
 static int
 output_contains_client(struct client *client)
 {
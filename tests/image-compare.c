@@ -0,0 +1,273 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <cairo.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "image-compare.h"
+
+/* Pixels are compared as bytes in memory order, which for ARGB8888 on a
+ * little-endian machine is B, G, R, A. */
+static void
+tolerance_bytes(const struct image_tolerance *tolerance, uint8_t bytes[16])
+{
+	int i;
+
+	for (i = 0; i < 16; i += 4) {
+		bytes[i + 0] = tolerance->b;
+		bytes[i + 1] = tolerance->g;
+		bytes[i + 2] = tolerance->r;
+		bytes[i + 3] = tolerance->a;
+	}
+}
+
+static inline uint8_t
+abs_diff(uint8_t x, uint8_t y)
+{
+	return x > y ? x - y : y - x;
+}
+
+/* The fast path: tells whether every byte of the row is within the
+ * tolerance, without looking at individual pixels. */
+static int
+row_matches(const uint8_t *a, const uint8_t *b, int bytes,
+	    const uint8_t tolerance[16])
+{
+	uint8_t excess = 0;
+	int i = 0;
+
+#ifdef __SSE2__
+	__m128i tol = _mm_loadu_si128((const __m128i *)tolerance);
+	__m128i acc = _mm_setzero_si128();
+	__m128i va, vb, d;
+
+	for (; i + 16 <= bytes; i += 16) {
+		va = _mm_loadu_si128((const __m128i *)(a + i));
+		vb = _mm_loadu_si128((const __m128i *)(b + i));
+		d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+		acc = _mm_or_si128(acc, _mm_subs_epu8(d, tol));
+	}
+
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) !=
+	    0xffff)
+		return 0;
+#endif
+
+	for (; i < bytes; i++)
+		excess |= abs_diff(a[i], b[i]) > tolerance[i % 4];
+
+	return !excess;
+}
+
+static void
+diff_row(const uint8_t *a, const uint8_t *b, int width,
+	 const uint8_t tolerance[16], struct image_diff *diff,
+	 uint32_t *out)
+{
+	uint8_t d[4];
+	uint32_t grey;
+	int i, c, bad;
+
+	for (i = 0; i < width; i++, a += 4, b += 4) {
+		bad = 0;
+		for (c = 0; c < 4; c++) {
+			d[c] = abs_diff(a[c], b[c]);
+			bad |= d[c] > tolerance[c];
+		}
+
+		if (d[0] > diff->max_b)
+			diff->max_b = d[0];
+		if (d[1] > diff->max_g)
+			diff->max_g = d[1];
+		if (d[2] > diff->max_r)
+			diff->max_r = d[2];
+		if (d[3] > diff->max_a)
+			diff->max_a = d[3];
+
+		if (bad)
+			diff->pixels++;
+
+		if (!out)
+			continue;
+
+		if (bad) {
+			out[i] = 0xffff0000;
+		} else {
+			grey = (b[0] + b[1] + b[2]) / 12;
+			out[i] = 0xff000000 | grey << 16 | grey << 8 | grey;
+		}
+	}
+}
+
+int
+image_compare(const void *a, int stride_a, const void *b, int stride_b,
+	      int width, int height, const struct image_tolerance *tolerance,
+	      struct image_diff *diff, void *diff_image, int diff_stride)
+{
+	const uint8_t *pa = a, *pb = b;
+	struct image_diff local;
+	uint8_t tol[16];
+	uint32_t *out;
+	int y;
+
+	tolerance_bytes(tolerance, tol);
+
+	if (!diff)
+		diff = &local;
+	memset(diff, 0, sizeof *diff);
+
+	for (y = 0; y < height; y++) {
+		if (!row_matches(pa + y * stride_a, pb + y * stride_b,
+				 width * 4, tol))
+			break;
+	}
+
+	if (y == height)
+		return 0;
+
+	/* Only a mismatch pays for the per-pixel pass. */
+	for (y = 0; y < height; y++) {
+		out = diff_image ?
+			(uint32_t *)((uint8_t *)diff_image + y * diff_stride) :
+			NULL;
+		diff_row(pa + y * stride_a, pb + y * stride_b, width,
+			 tol, diff, out);
+	}
+
+	return diff->pixels;
+}
+
+static char *
+output_filename(const char *name, const char *suffix)
+{
+	const char *dir = getenv("WESTON_TEST_OUTPUT_PATH");
+	char *path;
+
+	if (!dir)
+		dir = ".";
+
+	assert(asprintf(&path, "%s/%s%s.png", dir, name, suffix) >= 0);
+
+	return path;
+}
+
+static void
+write_png(const char *path, void *data, int width, int height, int stride)
+{
+	cairo_surface_t *surface;
+	cairo_status_t status;
+
+	surface = cairo_image_surface_create_for_data(data,
+						      CAIRO_FORMAT_ARGB32,
+						      width, height, stride);
+	status = cairo_surface_write_to_png(surface, path);
+	cairo_surface_destroy(surface);
+
+	if (status != CAIRO_STATUS_SUCCESS)
+		fprintf(stderr, "writing %s failed: %s\n",
+			path, cairo_status_to_string(status));
+	else
+		fprintf(stderr, "wrote %s\n", path);
+}
+
+int
+check_reference_image(struct client *client, const char *name,
+		      int x, int y, int width, int height,
+		      const struct image_tolerance *tolerance)
+{
+	const char *dir = getenv("WESTON_TEST_REFERENCE_PATH");
+	int out_width = client->output->width;
+	int out_height = client->output->height;
+	cairo_surface_t *reference;
+	struct wl_buffer *buffer;
+	struct image_diff diff;
+	uint8_t *pixels, *shot;
+	void *diff_image;
+	char *path;
+	int match = 0;
+
+	assert(x >= 0 && y >= 0);
+	assert(x + width <= out_width && y + height <= out_height);
+
+	buffer = create_shm_buffer(client, out_width, out_height,
+				   (void **)&pixels);
+	capture_screenshot(client, buffer);
+	shot = pixels + y * out_width * 4 + x * 4;
+
+	assert(asprintf(&path, "%s/%s.png", dir ? dir : ".", name) >= 0);
+	reference = cairo_image_surface_create_from_png(path);
+
+	if (cairo_surface_status(reference) != CAIRO_STATUS_SUCCESS) {
+		fprintf(stderr, "%s: cannot load reference %s: %s\n", name,
+			path, cairo_status_to_string(
+				cairo_surface_status(reference)));
+	} else if (cairo_image_surface_get_width(reference) != width ||
+		   cairo_image_surface_get_height(reference) != height) {
+		fprintf(stderr, "%s: reference is %dx%d, expected %dx%d\n",
+			name, cairo_image_surface_get_width(reference),
+			cairo_image_surface_get_height(reference),
+			width, height);
+	} else {
+		cairo_surface_flush(reference);
+		diff_image = xzalloc(width * height * 4);
+
+		match = image_compare(shot, out_width * 4,
+				      cairo_image_surface_get_data(reference),
+				      cairo_image_surface_get_stride(reference),
+				      width, height, tolerance,
+				      &diff, diff_image, width * 4) == 0;
+
+		if (!match) {
+			fprintf(stderr, "%s: %d pixels differ, largest "
+				"difference a %u r %u g %u b %u\n", name,
+				diff.pixels, diff.max_a, diff.max_r,
+				diff.max_g, diff.max_b);
+			free(path);
+			path = output_filename(name, "-diff");
+			write_png(path, diff_image, width, height, width * 4);
+		}
+
+		free(diff_image);
+	}
+
+	if (!match) {
+		free(path);
+		path = output_filename(name, "-actual");
+		write_png(path, shot, width, height, out_width * 4);
+	}
+
+	free(path);
+	cairo_surface_destroy(reference);
+	wl_buffer_destroy(buffer);
+	munmap(pixels, out_width * out_height * 4);
+
+	return match;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _IMAGE_COMPARE_H_
+#define _IMAGE_COMPARE_H_
+
+#include <stdint.h>
+
+#include "weston-test-client-helper.h"
+
+/* Largest accepted difference per channel, 0 for an exact match. */
+struct image_tolerance {
+	uint8_t a, r, g, b;
+};
+
+struct image_diff {
+	/* Number of pixels with a channel outside the tolerance. */
+	int pixels;
+	/* Largest difference seen per channel. */
+	uint8_t max_a, max_r, max_g, max_b;
+};
+
+/* Compares two ARGB8888 images of width x height pixels. Returns the
+ * number of pixels outside the tolerance and fills in diff when it is not
+ * NULL. When the images differ and diff_image is not NULL, it receives an
+ * ARGB8888 image showing the mismatching pixels in red over a dimmed copy
+ * of the reference b. */
+int
+image_compare(const void *a, int stride_a, const void *b, int stride_b,
+	      int width, int height, const struct image_tolerance *tolerance,
+	      struct image_diff *diff, void *diff_image, int diff_stride);
+
+/* Captures the output and compares the given rectangle with the
+ * reference image <name>.png in $WESTON_TEST_REFERENCE_PATH. On a
+ * mismatch, or when there is no reference, the captured and diff images
+ * are written to $WESTON_TEST_OUTPUT_PATH. Returns 1 on a match. */
+int
+check_reference_image(struct client *client, const char *name,
+		      int x, int y, int width, int height,
+		      const struct image_tolerance *tolerance);
+
+#endif
@@ -0,0 +1,651 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/input.h>
+
+#include "weston-test-client-helper.h"
+
+/* Input dispatch benchmarks.
+ *
+ * Floods the compositor with pointer motion, button, key or touch
+ * events injected through the weston-test extension, while a number of
+ * client surfaces with input regions are mapped. Each run writes one
+ * line of JSON with the events per second delivered to the client, the
+ * latency from flushing an injection request to receiving the matching
+ * event, and the compositor's heap allocations per event when weston
+ * runs with alloc-counter.so preloaded. Results go to the file named by
+ * WESTON_BENCH_RESULTS, or to stdout. Run through "make bench".
+ *
+ * With COALESCE_MOTION=true weston runs with [core] coalesce-motion, and
+ * motion arrives once per repaint rather than once per injection. Each
+ * window of motion injections then counts as delivered when a frame
+ * callback requested after it is done, and the motion events, client
+ * wakeups and compositor repaints are reported to compare both modes.
+ */
+
+char *server_parameters = "--use-pixman --width=1024 --height=768";
+
+enum scene_kind {
+	/* Surfaces side by side, each accepting input on its inner part. */
+	SCENE_GRID,
+	/* Surfaces stacked on top of each other, each accepting input on a
+	 * different cell only, so picking walks down the stack. */
+	SCENE_STACK,
+};
+
+enum event_kind {
+	EVENT_MOTION,
+	EVENT_BUTTON,
+	EVENT_KEY,
+	EVENT_TOUCH,
+};
+
+static const char * const scene_name[] = {
+	[SCENE_GRID] = "grid",
+	[SCENE_STACK] = "stack",
+};
+
+static const char * const event_name[] = {
+	[EVENT_MOTION] = "motion",
+	[EVENT_BUTTON] = "button",
+	[EVENT_KEY] = "key",
+	[EVENT_TOUCH] = "touch",
+};
+
+struct bench_scene {
+	enum scene_kind kind;
+	int count;
+	enum event_kind event;
+};
+
+static const struct bench_scene scenes[] = {
+	{ SCENE_GRID, 16, EVENT_MOTION },
+	{ SCENE_GRID, 256, EVENT_MOTION },
+	{ SCENE_STACK, 256, EVENT_MOTION },
+	{ SCENE_GRID, 256, EVENT_BUTTON },
+	{ SCENE_GRID, 256, EVENT_KEY },
+	{ SCENE_GRID, 256, EVENT_TOUCH },
+	{ SCENE_STACK, 256, EVENT_TOUCH },
+};
+
+#define BENCH_STACK_SIZE 256
+#define BENCH_WINDOW 64
+
+struct bench {
+	struct client *client;
+	struct weston_test *weston_test;
+	const struct bench_scene *scene;
+	struct wl_surface **surfaces;
+	struct wl_pointer *wl_pointer;
+	struct wl_keyboard *wl_keyboard;
+	struct wl_touch *wl_touch;
+
+	/* Centre of the input area of each surface, in global coordinates. */
+	int *target_x, *target_y;
+
+	int total;
+	int sent;
+	int received;
+	uint64_t *sent_ns;
+	uint64_t *latency_ns;
+
+	int coalesce;
+	struct wl_callback *frame;
+	int frame_sent;
+	int motion_events;
+	int wakeups;
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+bench_receive(struct bench *bench)
+{
+	assert(bench->received < bench->sent);
+
+	bench->latency_ns[bench->received] =
+		now_ns() - bench->sent_ns[bench->received];
+	bench->received++;
+}
+
+static void
+pointer_handle_enter(void *data, struct wl_pointer *wl_pointer,
+		     uint32_t serial, struct wl_surface *wl_surface,
+		     wl_fixed_t x, wl_fixed_t y)
+{
+}
+
+static void
+pointer_handle_leave(void *data, struct wl_pointer *wl_pointer,
+		     uint32_t serial, struct wl_surface *wl_surface)
+{
+}
+
+static void
+pointer_handle_motion(void *data, struct wl_pointer *wl_pointer,
+		      uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+	struct bench *bench = data;
+
+	if (bench->scene->event != EVENT_MOTION)
+		return;
+
+	bench->motion_events++;
+	if (!bench->coalesce)
+		bench_receive(bench);
+}
+
+static void
+pointer_handle_button(void *data, struct wl_pointer *wl_pointer,
+		      uint32_t serial, uint32_t time, uint32_t button,
+		      uint32_t state)
+{
+	struct bench *bench = data;
+
+	if (bench->scene->event == EVENT_BUTTON)
+		bench_receive(bench);
+}
+
+static void
+pointer_handle_axis(void *data, struct wl_pointer *wl_pointer,
+		    uint32_t time, uint32_t axis, wl_fixed_t value)
+{
+}
+
+static const struct wl_pointer_listener pointer_listener = {
+	pointer_handle_enter,
+	pointer_handle_leave,
+	pointer_handle_motion,
+	pointer_handle_button,
+	pointer_handle_axis,
+};
+
+static void
+keyboard_handle_keymap(void *data, struct wl_keyboard *wl_keyboard,
+		       uint32_t format, int fd, uint32_t size)
+{
+	close(fd);
+}
+
+static void
+keyboard_handle_enter(void *data, struct wl_keyboard *wl_keyboard,
+		      uint32_t serial, struct wl_surface *wl_surface,
+		      struct wl_array *keys)
+{
+}
+
+static void
+keyboard_handle_leave(void *data, struct wl_keyboard *wl_keyboard,
+		      uint32_t serial, struct wl_surface *wl_surface)
+{
+}
+
+static void
+keyboard_handle_key(void *data, struct wl_keyboard *wl_keyboard,
+		    uint32_t serial, uint32_t time, uint32_t key,
+		    uint32_t state)
+{
+	struct bench *bench = data;
+
+	if (bench->scene->event == EVENT_KEY)
+		bench_receive(bench);
+}
+
+static void
+keyboard_handle_modifiers(void *data, struct wl_keyboard *wl_keyboard,
+			  uint32_t serial, uint32_t mods_depressed,
+			  uint32_t mods_latched, uint32_t mods_locked,
+			  uint32_t group)
+{
+}
+
+static const struct wl_keyboard_listener keyboard_listener = {
+	keyboard_handle_keymap,
+	keyboard_handle_enter,
+	keyboard_handle_leave,
+	keyboard_handle_key,
+	keyboard_handle_modifiers,
+};
+
+static void
+touch_handle_down(void *data, struct wl_touch *wl_touch,
+		  uint32_t serial, uint32_t time, struct wl_surface *surface,
+		  int32_t id, wl_fixed_t x, wl_fixed_t y)
+{
+	bench_receive(data);
+}
+
+static void
+touch_handle_up(void *data, struct wl_touch *wl_touch,
+		uint32_t serial, uint32_t time, int32_t id)
+{
+	bench_receive(data);
+}
+
+static void
+touch_handle_motion(void *data, struct wl_touch *wl_touch,
+		    uint32_t time, int32_t id, wl_fixed_t x, wl_fixed_t y)
+{
+}
+
+static void
+touch_handle_frame(void *data, struct wl_touch *wl_touch)
+{
+}
+
+static void
+touch_handle_cancel(void *data, struct wl_touch *wl_touch)
+{
+}
+
+static const struct wl_touch_listener touch_listener = {
+	touch_handle_down,
+	touch_handle_up,
+	touch_handle_motion,
+	touch_handle_frame,
+	touch_handle_cancel,
+};
+
+static void
+test_handle_pointer_position(void *data, struct weston_test *weston_test,
+			     wl_fixed_t x, wl_fixed_t y)
+{
+}
+
+static void
+test_handle_n_egl_buffers(void *data, struct weston_test *weston_test,
+			  uint32_t n)
+{
+}
+
+static void
+test_handle_repaint_stats(void *data, struct weston_test *weston_test,
+			  uint32_t frames, uint32_t time_usec,
+			  uint32_t max_usec, int32_t allocations)
+{
+}
+
+static void
+test_handle_output_repaint_stats(void *data, struct weston_test *weston_test,
+				 int32_t x, int32_t y, uint32_t frames,
+				 uint32_t time_usec, uint32_t max_usec)
+{
+}
+
+static void
+test_handle_capture_screenshot_done(void *data, struct weston_test *weston_test)
+{
+}
+
+static void
+test_handle_render_stats(void *data, struct weston_test *weston_test,
+			 uint32_t frames, uint32_t views,
+			 uint32_t opaque_rects, uint32_t blended_rects,
+			 uint32_t opaque_pixels, uint32_t blended_pixels,
+			 uint32_t damage_pixels, uint32_t upload_bytes)
+{
+}
+
+static const struct weston_test_listener test_listener = {
+	test_handle_pointer_position,
+	test_handle_n_egl_buffers,
+	test_handle_repaint_stats,
+	test_handle_capture_screenshot_done,
+	test_handle_render_stats,
+	test_handle_output_repaint_stats,
+};
+
+static void *
+bind_global(struct client *client, const struct wl_interface *interface)
+{
+	struct global *g;
+
+	wl_list_for_each(g, &client->global_list, link) {
+		if (strcmp(g->interface, interface->name) == 0)
+			return wl_registry_bind(client->wl_registry, g->name,
+						interface, 1);
+	}
+
+	assert(0 && "global not found");
+	return NULL;
+}
+
+/* The helper logs every input event it gets, which would dominate the
+ * measurement. Take the seat over with quiet listeners instead; events
+ * for the destroyed proxies are dropped by libwayland. */
+static void
+bench_take_input(struct bench *bench)
+{
+	struct input *input = bench->client->input;
+
+	bench->weston_test = bind_global(bench->client,
+					 &weston_test_interface);
+	weston_test_add_listener(bench->weston_test, &test_listener, bench);
+
+	wl_pointer_destroy(input->pointer->wl_pointer);
+	input->pointer->wl_pointer = NULL;
+	wl_keyboard_destroy(input->keyboard->wl_keyboard);
+	input->keyboard->wl_keyboard = NULL;
+
+	bench->wl_pointer = wl_seat_get_pointer(input->wl_seat);
+	wl_pointer_add_listener(bench->wl_pointer, &pointer_listener, bench);
+	bench->wl_keyboard = wl_seat_get_keyboard(input->wl_seat);
+	wl_keyboard_add_listener(bench->wl_keyboard,
+				 &keyboard_listener, bench);
+
+	if (bench->scene->event == EVENT_TOUCH) {
+		/* A touch motion without a touch point does nothing but
+		 * makes the seat grow a touch device. */
+		weston_test_send_touch(bench->weston_test, 0, 0, 0,
+				       WL_TOUCH_MOTION);
+		client_roundtrip(bench->client);
+
+		bench->wl_touch = wl_seat_get_touch(input->wl_seat);
+		wl_touch_add_listener(bench->wl_touch, &touch_listener, bench);
+	}
+
+	client_roundtrip(bench->client);
+}
+
+static void
+bench_map_surface(struct bench *bench, struct wl_surface *surface,
+		  struct wl_buffer *buffer, int x, int y,
+		  int input_x, int input_y, int input_width, int input_height)
+{
+	struct client *client = bench->client;
+	struct wl_region *region;
+
+	region = wl_compositor_create_region(client->wl_compositor);
+	wl_region_add(region, input_x, input_y, input_width, input_height);
+	wl_surface_set_input_region(surface, region);
+	wl_region_destroy(region);
+
+	wl_surface_attach(surface, buffer, 0, 0);
+	wl_surface_damage(surface, 0, 0, 0x7fffffff, 0x7fffffff);
+	weston_test_move_surface(bench->weston_test, surface, x, y);
+	wl_surface_commit(surface);
+}
+
+static void
+bench_create_scene(struct bench *bench)
+{
+	const struct bench_scene *scene = bench->scene;
+	struct client *client = bench->client;
+	struct wl_buffer *buffer;
+	int i, cols, rows, width, height, cell;
+	void *pixels;
+
+	bench->surfaces = xzalloc(scene->count * sizeof bench->surfaces[0]);
+	bench->target_x = xzalloc(scene->count * sizeof bench->target_x[0]);
+	bench->target_y = xzalloc(scene->count * sizeof bench->target_y[0]);
+
+	for (cols = 1; cols * cols < scene->count; cols++)
+		;
+	rows = (scene->count + cols - 1) / cols;
+
+	switch (scene->kind) {
+	case SCENE_GRID:
+		width = 1024 / cols;
+		height = 768 / rows;
+		buffer = create_shm_buffer(client, width, height, &pixels);
+		memset(pixels, 0x80, width * height * 4);
+
+		for (i = 0; i < scene->count; i++) {
+			bench->surfaces[i] =
+				wl_compositor_create_surface(client->wl_compositor);
+			bench_map_surface(bench, bench->surfaces[i], buffer,
+					  (i % cols) * width,
+					  (i / cols) * height,
+					  2, 2, width - 4, height - 4);
+			bench->target_x[i] = (i % cols) * width + width / 2;
+			bench->target_y[i] = (i / cols) * height + height / 2;
+		}
+		break;
+	case SCENE_STACK:
+		width = height = BENCH_STACK_SIZE;
+		cell = BENCH_STACK_SIZE / cols;
+		buffer = create_shm_buffer(client, width, height, &pixels);
+		memset(pixels, 0x80, width * height * 4);
+
+		for (i = 0; i < scene->count; i++) {
+			bench->surfaces[i] =
+				wl_compositor_create_surface(client->wl_compositor);
+			bench_map_surface(bench, bench->surfaces[i], buffer,
+					  0, 0,
+					  (i % cols) * cell, (i / cols) * cell,
+					  cell, cell);
+			bench->target_x[i] = (i % cols) * cell + cell / 2;
+			bench->target_y[i] = (i / cols) * cell + cell / 2;
+		}
+		break;
+	}
+
+	client_roundtrip(client);
+
+	/* Park the pointer and keyboard focus on the first surface. */
+	weston_test_move_pointer(bench->weston_test,
+				 bench->target_x[0], bench->target_y[0]);
+	weston_test_activate_surface(bench->weston_test, bench->surfaces[0]);
+	client_roundtrip(client);
+}
+
+/* Queues the injection of event number i. Motion and touch events visit
+ * the surfaces in turn, so every one of them changes the focus. */
+static void
+bench_inject(struct bench *bench, int i)
+{
+	int n = bench->scene->count;
+	int k = (i / 2) % n;
+	uint32_t state = i % 2 ? 0 : 1;
+
+	switch (bench->scene->event) {
+	case EVENT_MOTION:
+		weston_test_move_pointer(bench->weston_test,
+					 bench->target_x[(i + 1) % n],
+					 bench->target_y[(i + 1) % n]);
+		break;
+	case EVENT_BUTTON:
+		weston_test_send_button(bench->weston_test, BTN_LEFT, state);
+		break;
+	case EVENT_KEY:
+		weston_test_send_key(bench->weston_test, KEY_A, state);
+		break;
+	case EVENT_TOUCH:
+		weston_test_send_touch(bench->weston_test, 0,
+				       wl_fixed_from_int(bench->target_x[k]),
+				       wl_fixed_from_int(bench->target_y[k]),
+				       state ? WL_TOUCH_DOWN : WL_TOUCH_UP);
+		break;
+	}
+}
+
+static void
+frame_handle_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct bench *bench = data;
+
+	wl_callback_destroy(callback);
+	bench->frame = NULL;
+
+	while (bench->received < bench->frame_sent)
+		bench_receive(bench);
+}
+
+static const struct wl_callback_listener frame_listener = {
+	frame_handle_done,
+};
+
+/* Coalesced motion is delivered when the next repaint starts, before
+ * the frame callbacks of that repaint are sent. */
+static void
+bench_request_frame(struct bench *bench)
+{
+	struct wl_surface *surface = bench->surfaces[0];
+
+	bench->frame = wl_surface_frame(surface);
+	wl_callback_add_listener(bench->frame, &frame_listener, bench);
+	wl_surface_commit(surface);
+	bench->frame_sent = bench->sent;
+}
+
+/* Keeps up to BENCH_WINDOW injections in flight until all events are
+ * received. */
+static void
+bench_run(struct bench *bench)
+{
+	struct wl_display *display = bench->client->wl_display;
+	int first, i;
+	uint64_t t;
+
+	while (bench->received < bench->total) {
+		first = bench->sent;
+		while (bench->sent < bench->total &&
+		       bench->sent - bench->received < BENCH_WINDOW)
+			bench_inject(bench, bench->sent++);
+
+		if (bench->coalesce && bench->scene->event == EVENT_MOTION &&
+		    !bench->frame && bench->sent > bench->received)
+			bench_request_frame(bench);
+
+		assert(wl_display_flush(display) >= 0);
+		t = now_ns();
+		for (i = first; i < bench->sent; i++)
+			bench->sent_ns[i] = t;
+
+		assert(wl_display_dispatch(display) >= 0);
+		bench->wakeups++;
+	}
+}
+
+static int
+compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static double
+percentile_usec(uint64_t *sorted, int count, int percent)
+{
+	return sorted[(count - 1) * percent / 100] / 1000.0;
+}
+
+static void
+bench_report(struct bench *bench, double seconds,
+	     const struct repaint_stats *stats)
+{
+	const char *path = getenv("WESTON_BENCH_RESULTS");
+	int n = bench->total;
+	double allocs = -1.0;
+	FILE *out = stdout;
+
+	if (stats->allocations >= 0)
+		allocs = (double)stats->allocations / n;
+
+	qsort(bench->latency_ns, n, sizeof bench->latency_ns[0], compare_u64);
+
+	if (path) {
+		out = fopen(path, "a");
+		assert(out);
+	}
+
+	fprintf(out, "{ \"input\":\"%s\", \"scene\":\"%s\", \"count\":%d, "
+		"\"coalesce\":%s, "
+		"\"events\":%d, \"events_per_sec\":%.0f, "
+		"\"latency_usec\":{ \"p50\":%.1f, \"p90\":%.1f, "
+		"\"p99\":%.1f, \"max\":%.1f }, \"allocs_per_event\":%.1f, "
+		"\"motion_events\":%d, \"client_wakeups\":%d, "
+		"\"repaints\":%u }\n",
+		event_name[bench->scene->event],
+		scene_name[bench->scene->kind], bench->scene->count,
+		bench->coalesce ? "true" : "false",
+		n, n / seconds,
+		percentile_usec(bench->latency_ns, n, 50),
+		percentile_usec(bench->latency_ns, n, 90),
+		percentile_usec(bench->latency_ns, n, 99),
+		percentile_usec(bench->latency_ns, n, 100),
+		allocs, bench->motion_events, bench->wakeups,
+		stats->frames);
+
+	if (path)
+		fclose(out);
+	else
+		fflush(out);
+}
+
+TEST_P(input_bench, scenes)
+{
+	struct repaint_stats stats;
+	struct bench bench;
+	uint64_t start, end;
+	const char *env;
+
+	memset(&bench, 0, sizeof bench);
+	bench.scene = data;
+	bench.total = 20000;
+
+	env = getenv("COALESCE_MOTION");
+	bench.coalesce = env && strcmp(env, "true") == 0;
+
+	env = getenv("WESTON_BENCH_EVENTS");
+	if (env && atoi(env) > 0)
+		bench.total = atoi(env);
+
+	/* Presses and releases come in pairs. */
+	bench.total &= ~1;
+	bench.sent_ns = xzalloc(bench.total * sizeof bench.sent_ns[0]);
+	bench.latency_ns = xzalloc(bench.total * sizeof bench.latency_ns[0]);
+
+	bench.client = client_create(0, 0, 1, 1);
+	assert(bench.client);
+
+	bench_take_input(&bench);
+	bench_create_scene(&bench);
+
+	/* Each request reports what happened since the previous one. */
+	get_repaint_stats(bench.client, &stats);
+	start = now_ns();
+
+	bench_run(&bench);
+
+	end = now_ns();
+	get_repaint_stats(bench.client, &stats);
+
+	bench_report(&bench, (end - start) / 1e9, &stats);
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "../src/compositor.h"
+#include "../ivi-shell/ivi-layout-export.h"
+#include "ivi-test-client.h"
+
+/* hmi-controller benchmarks.
+ *
+ * Loaded by ivi-shell as the ivi-module listed before hmi-controller, so
+ * that its notification handlers run first and last around those of
+ * hmi-controller, and the time between them is what hmi-controller spent
+ * on the event. Once the hmi user interface is up, an in-process client
+ * creates, configures and destroys scenes of increasing size. Each scene
+ * writes one line of JSON to the file named by WESTON_BENCH_RESULTS, or
+ * to stdout. Run through "make bench".
+ */
+
+int
+controller_module_init(struct weston_compositor *compositor,
+		       int *argc, char *argv[],
+		       const struct ivi_controller_interface *interface,
+		       size_t interface_version);
+
+#define BENCH_SURFACE_BASE 5000
+
+static const int scene_surfaces[] = { 1, 4, 16, 64, 256 };
+
+struct event_timer {
+	uint64_t start;
+	uint64_t total;
+	int count;
+};
+
+struct bench {
+	struct weston_compositor *compositor;
+	const struct ivi_controller_interface *ivi;
+	FILE *out;
+	uint32_t base_layer_id;
+	int started;
+
+	struct event_timer create, configure, remove;
+
+	struct ivi_test_client *client;
+	struct wl_event_source *client_source;
+	struct ivi_test_surface **surfaces;
+	unsigned int scene;
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+timer_start(struct event_timer *timer)
+{
+	timer->start = now_ns();
+}
+
+static void
+timer_stop(struct event_timer *timer)
+{
+	timer->total += now_ns() - timer->start;
+	timer->count++;
+}
+
+static double
+timer_usec(const struct event_timer *timer)
+{
+	return timer->count ? timer->total / 1000.0 / timer->count : 0.0;
+}
+
+static void
+created_begin(struct ivi_layout_surface *ivisurf, void *data)
+{
+	struct bench *bench = data;
+
+	timer_start(&bench->create);
+}
+
+static void
+created_end(struct ivi_layout_surface *ivisurf, void *data)
+{
+	struct bench *bench = data;
+
+	timer_stop(&bench->create);
+}
+
+static void
+configured_begin(struct ivi_layout_surface *ivisurf, void *data)
+{
+	struct bench *bench = data;
+
+	timer_start(&bench->configure);
+}
+
+static void
+configured_end(struct ivi_layout_surface *ivisurf, void *data)
+{
+	struct bench *bench = data;
+
+	timer_stop(&bench->configure);
+}
+
+static void
+removed_begin(struct ivi_layout_surface *ivisurf, void *data)
+{
+	struct bench *bench = data;
+
+	timer_start(&bench->remove);
+}
+
+static void
+removed_end(struct ivi_layout_surface *ivisurf, void *data)
+{
+	struct bench *bench = data;
+
+	timer_stop(&bench->remove);
+}
+
+static void bench_scene(struct bench *bench);
+
+static void
+bench_finish(void *data)
+{
+	struct bench *bench = data;
+	const struct ivi_controller_interface *ivi = bench->ivi;
+
+	ivi->remove_notification_create_surface(created_begin, bench);
+	ivi->remove_notification_create_surface(created_end, bench);
+	ivi->remove_notification_configure_surface(configured_begin, bench);
+	ivi->remove_notification_configure_surface(configured_end, bench);
+	ivi->remove_notification_remove_surface(removed_begin, bench);
+	ivi->remove_notification_remove_surface(removed_end, bench);
+
+	wl_event_source_remove(bench->client_source);
+	ivi_test_client_destroy(bench->client);
+
+	if (bench->out != stdout)
+		fclose(bench->out);
+	else
+		fflush(bench->out);
+
+	wl_display_terminate(bench->compositor->wl_display);
+	free(bench);
+}
+
+static void
+scene_removed(void *data)
+{
+	struct bench *bench = data;
+	int n = scene_surfaces[bench->scene];
+	struct wl_event_loop *loop;
+
+	assert(bench->remove.count == n);
+
+	fprintf(bench->out, "{ \"ivi_hmi\":\"surfaces\", \"surfaces\":%d, "
+		"\"create_usec\":%.2f, \"configure_usec\":%.2f, "
+		"\"remove_usec\":%.2f }\n",
+		n, timer_usec(&bench->create), timer_usec(&bench->configure),
+		timer_usec(&bench->remove));
+
+	free(bench->surfaces);
+	bench->surfaces = NULL;
+
+	if (++bench->scene < ARRAY_LENGTH(scene_surfaces)) {
+		bench_scene(bench);
+		return;
+	}
+
+	/* Not from within the client's own dispatch. */
+	loop = wl_display_get_event_loop(bench->compositor->wl_display);
+	wl_event_loop_add_idle(loop, bench_finish, bench);
+}
+
+static void
+scene_configured(void *data)
+{
+	struct bench *bench = data;
+	int i, n = scene_surfaces[bench->scene];
+
+	assert(bench->create.count == n);
+	assert(bench->configure.count == n);
+
+	for (i = 0; i < n; i++)
+		ivi_test_surface_destroy(bench->surfaces[i]);
+	ivi_test_client_sync(bench->client, scene_removed, bench);
+}
+
+/* Creates n application surfaces, each configured by its first
+ * buffer, as an ivi_application starting up does. */
+static void
+bench_scene(struct bench *bench)
+{
+	int i, n = scene_surfaces[bench->scene];
+
+	memset(&bench->create, 0, sizeof bench->create);
+	memset(&bench->configure, 0, sizeof bench->configure);
+	memset(&bench->remove, 0, sizeof bench->remove);
+
+	bench->surfaces = calloc(n, sizeof bench->surfaces[0]);
+	assert(bench->surfaces);
+
+	for (i = 0; i < n; i++) {
+		bench->surfaces[i] =
+			ivi_test_surface_create(bench->client,
+						BENCH_SURFACE_BASE + i);
+		ivi_test_surface_commit(bench->surfaces[i], 64, 64,
+					0xff808080, NULL, NULL);
+	}
+	ivi_test_client_sync(bench->client, scene_configured, bench);
+}
+
+static int
+client_readable(int fd, uint32_t mask, void *data)
+{
+	struct bench *bench = data;
+
+	assert(ivi_test_client_dispatch(bench->client) == 0);
+
+	return 0;
+}
+
+static void
+client_ready(void *data)
+{
+	struct bench *bench = data;
+
+	bench_scene(bench);
+}
+
+static void
+bench_run(void *data)
+{
+	struct bench *bench = data;
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	const char *path = getenv("WESTON_BENCH_RESULTS");
+	struct wl_event_loop *loop;
+	int sv[2];
+
+	bench->out = stdout;
+	if (path) {
+		bench->out = fopen(path, "a");
+		assert(bench->out);
+	}
+
+	/* hmi-controller registered its handlers since ours ran first. */
+	ivi->add_notification_create_surface(created_end, bench);
+	ivi->add_notification_configure_surface(configured_end, bench);
+	ivi->add_notification_remove_surface(removed_end, bench);
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == 0);
+	assert(wl_client_create(bench->compositor->wl_display, sv[0]));
+
+	bench->client = ivi_test_client_create(sv[1]);
+	assert(bench->client);
+
+	loop = wl_display_get_event_loop(bench->compositor->wl_display);
+	bench->client_source = wl_event_loop_add_fd(loop, sv[1],
+						    WL_EVENT_READABLE,
+						    client_readable, bench);
+	assert(bench->client_source);
+
+	ivi_test_client_sync(bench->client, client_ready, bench);
+}
+
+/* hmi-controller lays out application surfaces only after its user
+ * interface put its widgets on the base layer. */
+static void
+ui_committed(const struct ivi_layout_commit_summary *summary, void *data)
+{
+	struct bench *bench = data;
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	struct ivi_layout_layer *base_layer;
+	struct wl_event_loop *loop;
+
+	base_layer = ivi->get_layer_from_id(bench->base_layer_id);
+	if (bench->started || base_layer == NULL ||
+	    ivi->get_surfaces_on_layer_into(base_layer, NULL, 0) <= 0)
+		return;
+
+	bench->started = 1;
+	ivi->remove_notification_commit(ui_committed, bench);
+
+	/* The user interface is ready once its request returns. */
+	loop = wl_display_get_event_loop(bench->compositor->wl_display);
+	wl_event_loop_add_idle(loop, bench_run, bench);
+}
+
+WL_EXPORT int
+controller_module_init(struct weston_compositor *compositor,
+		       int *argc, char *argv[],
+		       const struct ivi_controller_interface *interface,
+		       size_t interface_version)
+{
+	struct weston_config_section *section;
+	struct bench *bench;
+
+	if (interface_version < sizeof(struct ivi_controller_interface)) {
+		weston_log("ivi-hmi-bench: version mismatch of controller interface\n");
+		return -1;
+	}
+
+	bench = zalloc(sizeof *bench);
+	if (bench == NULL)
+		return -1;
+
+	bench->compositor = compositor;
+	bench->ivi = interface;
+
+	section = weston_config_get_section(compositor->config, "ivi-shell",
+					    NULL, NULL);
+	weston_config_section_get_uint(section, "base-layer-id",
+				       &bench->base_layer_id, 1000);
+
+	interface->add_notification_create_surface(created_begin, bench);
+	interface->add_notification_configure_surface(configured_begin, bench);
+	interface->add_notification_remove_surface(removed_begin, bench);
+	interface->add_notification_commit(ui_committed, bench);
+
+	return 0;
+}
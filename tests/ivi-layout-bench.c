@@ -0,0 +1,596 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/compositor.h"
+#include "../ivi-shell/ivi-layout-export.h"
+
+/* ivi-layout benchmarks.
+ *
+ * Loaded by ivi-shell as its ivi-module, this drives the ivi controller
+ * interface directly with scenes of increasing size. Transition scenes
+ * run last, from the event loop, as their frames come from the
+ * transition timer. Each scene writes one line of JSON to the file named
+ * by WESTON_BENCH_RESULTS, or to stdout. Run through "make bench".
+ */
+
+int
+controller_module_init(struct weston_compositor *compositor,
+		       int *argc, char *argv[],
+		       const struct ivi_controller_interface *interface,
+		       size_t interface_version);
+
+#define BENCH_LOOKUPS 200000
+#define BENCH_ID_BASE 1000
+#define BENCH_ID_STEP 37
+#define BENCH_COMMITS 1000
+#define BENCH_QUERIES 2000
+#define BENCH_TRANSITION_MSEC 500
+#define BENCH_TRANSITION_SETTLE_MSEC 200
+
+static const int scene_layers[] = { 16, 64, 256, 1024, 4096 };
+static const int transition_layers[] = { 1, 4, 16, 64, 256 };
+
+enum transition_kind {
+	TRANSITION_MOVE,
+	TRANSITION_FADE,
+	TRANSITION_KIND_COUNT
+};
+
+static const char * const transition_kind_name[] = { "move", "fade" };
+
+struct bench {
+	struct weston_compositor *compositor;
+	const struct ivi_controller_interface *ivi;
+	FILE *out;
+
+	unsigned int transition_scene;
+	struct ivi_layout_layer **layers;
+	struct wl_event_source *settle_timer;
+	int frames;
+	uint64_t cpu_first, cpu_last;
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* CPU time of the compositor thread, which leaves out the time spent
+ * waiting for the next transition frame. */
+static uint64_t
+cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t
+layer_id(int i)
+{
+	return BENCH_ID_BASE + i * BENCH_ID_STEP;
+}
+
+/* Creates, resolves by ID, orders on the screen and removes n layers. */
+static void
+bench_layers(struct bench *bench, int n)
+{
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	struct ivi_layout_layer **layers;
+	struct ivi_layout_layer *ivilayer;
+	struct ivi_layout_screen *iviscrn;
+	uint64_t t0, t1, t2, t3, t4;
+	uint32_t seed = 1;
+	int i, k;
+
+	layers = calloc(n, sizeof layers[0]);
+	assert(layers);
+
+	iviscrn = ivi->get_screen_from_id(0);
+	assert(iviscrn);
+
+	t0 = now_ns();
+	for (i = 0; i < n; i++) {
+		layers[i] = ivi->layer_create_with_dimension(layer_id(i),
+							     64, 64);
+		assert(layers[i]);
+	}
+
+	t1 = now_ns();
+	for (i = 0; i < BENCH_LOOKUPS; i++) {
+		seed = seed * 1103515245 + 12345;
+		k = (seed >> 8) % n;
+		ivilayer = ivi->get_layer_from_id(layer_id(k));
+		assert(ivilayer == layers[k]);
+	}
+
+	t2 = now_ns();
+	ivi->screen_set_render_order(iviscrn, layers, n);
+	ivi->screen_set_render_order(iviscrn, NULL, 0);
+
+	t3 = now_ns();
+	for (i = 0; i < n; i++)
+		ivi->layer_remove(layers[i]);
+	t4 = now_ns();
+
+	assert(ivi->get_layer_from_id(layer_id(0)) == NULL);
+
+	fprintf(bench->out, "{ \"ivi_layout\":\"layers\", \"layers\":%d, "
+		"\"create_usec\":%.1f, \"lookup_nsec\":%.1f, "
+		"\"render_order_usec\":%.1f, \"remove_usec\":%.1f }\n",
+		n, (t1 - t0) / 1000.0, (double)(t2 - t1) / BENCH_LOOKUPS,
+		(t3 - t2) / 1000.0, (t4 - t3) / 1000.0);
+
+	free(layers);
+}
+
+/* Commits with one, then all, of n on-screen layers changed. */
+static void
+bench_commit(struct bench *bench, int n)
+{
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	struct ivi_layout_layer **layers;
+	struct ivi_layout_screen *iviscrn;
+	uint64_t t0, t1, t2;
+	int i, k;
+
+	layers = calloc(n, sizeof layers[0]);
+	assert(layers);
+
+	iviscrn = ivi->get_screen_from_id(0);
+	assert(iviscrn);
+
+	for (i = 0; i < n; i++) {
+		layers[i] = ivi->layer_create_with_dimension(layer_id(i),
+							     64, 64);
+		assert(layers[i]);
+		ivi->layer_set_visibility(layers[i], true);
+	}
+	ivi->screen_set_render_order(iviscrn, layers, n);
+	ivi->commit_changes();
+
+	t0 = now_ns();
+	for (k = 0; k < BENCH_COMMITS; k++) {
+		ivi->layer_set_position(layers[k % n], k & 63, 0);
+		ivi->commit_changes();
+	}
+
+	t1 = now_ns();
+	for (k = 0; k < BENCH_COMMITS / 10; k++) {
+		for (i = 0; i < n; i++)
+			ivi->layer_set_position(layers[i], k & 63, 0);
+		ivi->commit_changes();
+	}
+	t2 = now_ns();
+
+	ivi->screen_set_render_order(iviscrn, NULL, 0);
+	ivi->commit_changes();
+	for (i = 0; i < n; i++)
+		ivi->layer_remove(layers[i]);
+
+	fprintf(bench->out, "{ \"ivi_layout\":\"commit\", \"layers\":%d, "
+		"\"commit_one_usec\":%.2f, \"commit_all_usec\":%.2f }\n",
+		n, (double)(t1 - t0) / BENCH_COMMITS / 1000.0,
+		(double)(t2 - t1) / (BENCH_COMMITS / 10) / 1000.0);
+
+	free(layers);
+}
+
+static int32_t
+count_layer(struct ivi_layout_layer *ivilayer, void *data)
+{
+	int *count = data;
+
+	(*count)++;
+
+	return 0;
+}
+
+/* Lists n on-screen layers through the allocating, caller-buffer and
+ * visitor queries, as a controller does on every notification. */
+static void
+bench_queries(struct bench *bench, int n)
+{
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	struct ivi_layout_layer **layers;
+	struct ivi_layout_layer **array;
+	struct ivi_layout_screen *iviscrn;
+	uint64_t t0, t1, t2, t3;
+	int32_t length;
+	int i, k, count = 0;
+
+	layers = calloc(n, sizeof layers[0]);
+	assert(layers);
+
+	iviscrn = ivi->get_screen_from_id(0);
+	assert(iviscrn);
+
+	for (i = 0; i < n; i++) {
+		layers[i] = ivi->layer_create_with_dimension(layer_id(i),
+							     64, 64);
+		assert(layers[i]);
+	}
+	ivi->screen_set_render_order(iviscrn, layers, n);
+	ivi->commit_changes();
+
+	t0 = now_ns();
+	for (k = 0; k < BENCH_QUERIES; k++) {
+		ivi->get_layers_on_screen(iviscrn, &length, &array);
+		assert(length == n);
+		free(array);
+	}
+
+	t1 = now_ns();
+	for (k = 0; k < BENCH_QUERIES; k++) {
+		length = ivi->get_layers_on_screen_into(iviscrn, layers, n);
+		assert(length == n);
+	}
+
+	t2 = now_ns();
+	for (k = 0; k < BENCH_QUERIES; k++)
+		ivi->for_each_layer_on_screen(iviscrn, count_layer, &count);
+	t3 = now_ns();
+
+	assert(count == n * BENCH_QUERIES);
+
+	ivi->screen_set_render_order(iviscrn, NULL, 0);
+	ivi->commit_changes();
+	for (i = 0; i < n; i++)
+		ivi->layer_remove(layers[i]);
+
+	fprintf(bench->out, "{ \"ivi_layout\":\"queries\", \"layers\":%d, "
+		"\"get_nsec\":%.1f, \"get_into_nsec\":%.1f, "
+		"\"for_each_nsec\":%.1f }\n",
+		n, (double)(t1 - t0) / BENCH_QUERIES,
+		(double)(t2 - t1) / BENCH_QUERIES,
+		(double)(t3 - t2) / BENCH_QUERIES);
+
+	free(layers);
+}
+
+static void
+layer_changed(struct ivi_layout_layer *ivilayer,
+	      const struct ivi_layout_layer_properties *prop,
+	      enum ivi_layout_notification_mask mask,
+	      void *data)
+{
+	int *count = data;
+
+	(*count)++;
+}
+
+static void
+commit_notified(const struct ivi_layout_commit_summary *summary, void *data)
+{
+	int *count = data;
+
+	*count += summary->layer_count;
+}
+
+/* Commits n changed layers observed through per-layer property
+ * notifications, then through one commit notification. */
+static void
+bench_notify(struct bench *bench, int n)
+{
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	struct ivi_layout_layer **layers;
+	uint64_t t0, t1, t2, t3;
+	int i, k, count = 0;
+
+	layers = calloc(n, sizeof layers[0]);
+	assert(layers);
+
+	for (i = 0; i < n; i++) {
+		layers[i] = ivi->layer_create_with_dimension(layer_id(i),
+							     64, 64);
+		assert(layers[i]);
+	}
+	ivi->commit_changes();
+
+	for (i = 0; i < n; i++)
+		ivi->layer_add_notification(layers[i], layer_changed, &count);
+
+	t0 = now_ns();
+	for (k = 0; k < BENCH_COMMITS / 10; k++) {
+		for (i = 0; i < n; i++)
+			ivi->layer_set_position(layers[i], k & 63, 0);
+		ivi->commit_changes();
+	}
+	t1 = now_ns();
+
+	assert(count == n * (BENCH_COMMITS / 10));
+
+	for (i = 0; i < n; i++)
+		ivi->layer_remove_notification(layers[i]);
+	ivi->add_notification_commit(commit_notified, &count);
+
+	count = 0;
+	t2 = now_ns();
+	for (k = 0; k < BENCH_COMMITS / 10; k++) {
+		for (i = 0; i < n; i++)
+			ivi->layer_set_position(layers[i], k & 63, 0);
+		ivi->commit_changes();
+	}
+	t3 = now_ns();
+
+	assert(count == n * (BENCH_COMMITS / 10));
+
+	ivi->remove_notification_commit(commit_notified, &count);
+	for (i = 0; i < n; i++)
+		ivi->layer_remove(layers[i]);
+
+	fprintf(bench->out, "{ \"ivi_layout\":\"notify\", \"layers\":%d, "
+		"\"per_object_usec\":%.2f, \"batched_usec\":%.2f }\n",
+		n, (double)(t1 - t0) / (BENCH_COMMITS / 10) / 1000.0,
+		(double)(t3 - t2) / (BENCH_COMMITS / 10) / 1000.0);
+
+	free(layers);
+}
+
+/* Saves a scene of n on-screen layers, then restores it from scratch. */
+static void
+bench_scene(struct bench *bench, int n)
+{
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	struct ivi_layout_layer **layers;
+	struct ivi_layout_screen *iviscrn;
+	const char *dir = getenv("XDG_RUNTIME_DIR");
+	char path[256];
+	uint64_t t0, t1, t2;
+	int i;
+
+	snprintf(path, sizeof path, "%s/ivi-layout-bench.scene",
+		 dir ? dir : "/tmp");
+
+	layers = calloc(n, sizeof layers[0]);
+	assert(layers);
+
+	iviscrn = ivi->get_screen_from_id(0);
+	assert(iviscrn);
+
+	for (i = 0; i < n; i++) {
+		layers[i] = ivi->layer_create_with_dimension(layer_id(i),
+							     64, 64);
+		assert(layers[i]);
+		ivi->layer_set_visibility(layers[i], true);
+		ivi->layer_set_position(layers[i], i & 63, 0);
+	}
+	ivi->screen_set_render_order(iviscrn, layers, n);
+	ivi->commit_changes();
+
+	t0 = now_ns();
+	assert(ivi->scene_save(path) == IVI_SUCCEEDED);
+	t1 = now_ns();
+
+	ivi->screen_set_render_order(iviscrn, NULL, 0);
+	ivi->commit_changes();
+	for (i = 0; i < n; i++)
+		ivi->layer_remove(layers[i]);
+
+	t2 = now_ns();
+	assert(ivi->scene_restore(path) == IVI_SUCCEEDED);
+	t2 = now_ns() - t2;
+
+	assert(ivi->get_layers_on_screen_into(iviscrn, layers, n) == n);
+
+	ivi->screen_set_render_order(iviscrn, NULL, 0);
+	ivi->commit_changes();
+	for (i = 0; i < n; i++)
+		ivi->layer_remove(layers[i]);
+	unlink(path);
+
+	fprintf(bench->out, "{ \"ivi_layout\":\"scene\", \"layers\":%d, "
+		"\"save_usec\":%.2f, \"restore_usec\":%.2f }\n",
+		n, (t1 - t0) / 1000.0, t2 / 1000.0);
+
+	free(layers);
+}
+
+static void
+bench_finish(struct bench *bench)
+{
+	wl_event_source_remove(bench->settle_timer);
+
+	if (bench->out != stdout)
+		fclose(bench->out);
+	else
+		fflush(bench->out);
+
+	wl_display_terminate(bench->compositor->wl_display);
+	free(bench);
+}
+
+/* Each transition frame ends in a commit. The work of a frame is the
+ * CPU time from the commit of the previous one. */
+static void
+transition_frame_committed(const struct ivi_layout_commit_summary *summary,
+			   void *data)
+{
+	struct bench *bench = data;
+
+	bench->cpu_last = cpu_ns();
+	if (bench->frames++ == 0)
+		bench->cpu_first = bench->cpu_last;
+
+	wl_event_source_timer_update(bench->settle_timer,
+				     BENCH_TRANSITION_SETTLE_MSEC);
+}
+
+/* Starts n concurrent move or fade transitions of off-screen layers,
+ * so that no repaint adds to the time of a frame. */
+static void
+bench_transitions(struct bench *bench)
+{
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	unsigned int scene = bench->transition_scene;
+	int kind = scene / ARRAY_LENGTH(transition_layers);
+	int i, n = transition_layers[scene % ARRAY_LENGTH(transition_layers)];
+
+	bench->layers = calloc(n, sizeof bench->layers[0]);
+	assert(bench->layers);
+
+	for (i = 0; i < n; i++) {
+		bench->layers[i] = ivi->layer_create_with_dimension(layer_id(i),
+								    64, 64);
+		assert(bench->layers[i]);
+	}
+	ivi->commit_changes();
+
+	for (i = 0; i < n; i++) {
+		if (kind == TRANSITION_MOVE) {
+			ivi->layer_set_transition(bench->layers[i],
+					IVI_LAYOUT_TRANSITION_LAYER_MOVE,
+					BENCH_TRANSITION_MSEC);
+			ivi->layer_set_position(bench->layers[i], 100, 100);
+		} else {
+			ivi->layer_set_fade_info(bench->layers[i], 1,
+						 0.0, 1.0);
+			ivi->layer_set_transition(bench->layers[i],
+					IVI_LAYOUT_TRANSITION_LAYER_FADE,
+					BENCH_TRANSITION_MSEC);
+		}
+	}
+	ivi->commit_changes();
+
+	bench->frames = 0;
+	ivi->add_notification_commit(transition_frame_committed, bench);
+	wl_event_source_timer_update(bench->settle_timer,
+				     BENCH_TRANSITION_SETTLE_MSEC);
+}
+
+/* The transitions are over once no frame followed for a while. */
+static int
+transitions_settled(void *data)
+{
+	struct bench *bench = data;
+	const struct ivi_controller_interface *ivi = bench->ivi;
+	unsigned int scene = bench->transition_scene;
+	int kind = scene / ARRAY_LENGTH(transition_layers);
+	int i, n = transition_layers[scene % ARRAY_LENGTH(transition_layers)];
+	double frame_usec;
+
+	ivi->remove_notification_commit(transition_frame_committed, bench);
+
+	for (i = 0; i < n; i++)
+		ivi->layer_remove(bench->layers[i]);
+	ivi->commit_changes();
+	free(bench->layers);
+	bench->layers = NULL;
+
+	assert(bench->frames > 1);
+	frame_usec = (double)(bench->cpu_last - bench->cpu_first) /
+		     (bench->frames - 1) / 1000.0;
+
+	fprintf(bench->out, "{ \"ivi_layout\":\"transitions\", "
+		"\"kind\":\"%s\", \"transitions\":%d, \"frames\":%d, "
+		"\"frame_usec\":%.2f }\n",
+		transition_kind_name[kind], n, bench->frames, frame_usec);
+
+	if (++bench->transition_scene <
+	    TRANSITION_KIND_COUNT * ARRAY_LENGTH(transition_layers))
+		bench_transitions(bench);
+	else
+		bench_finish(bench);
+
+	return 0;
+}
+
+static void
+bench_run(void *data)
+{
+	struct bench *bench = data;
+	const char *path = getenv("WESTON_BENCH_RESULTS");
+	struct wl_event_loop *loop;
+	unsigned int i;
+
+	bench->out = stdout;
+	if (path) {
+		bench->out = fopen(path, "a");
+		assert(bench->out);
+	}
+
+	for (i = 0; i < ARRAY_LENGTH(scene_layers); i++)
+		bench_layers(bench, scene_layers[i]);
+
+	for (i = 0; i < ARRAY_LENGTH(scene_layers); i++)
+		bench_commit(bench, scene_layers[i]);
+
+	for (i = 0; i < ARRAY_LENGTH(scene_layers); i++)
+		bench_queries(bench, scene_layers[i]);
+
+	for (i = 0; i < ARRAY_LENGTH(scene_layers); i++)
+		bench_notify(bench, scene_layers[i]);
+
+	for (i = 0; i < ARRAY_LENGTH(scene_layers); i++)
+		bench_scene(bench, scene_layers[i]);
+
+	loop = wl_display_get_event_loop(bench->compositor->wl_display);
+	bench->settle_timer = wl_event_loop_add_timer(loop,
+						      transitions_settled,
+						      bench);
+	assert(bench->settle_timer);
+
+	bench->transition_scene = 0;
+	bench_transitions(bench);
+}
+
+WL_EXPORT int
+controller_module_init(struct weston_compositor *compositor,
+		       int *argc, char *argv[],
+		       const struct ivi_controller_interface *interface,
+		       size_t interface_version)
+{
+	struct wl_event_loop *loop;
+	struct bench *bench;
+
+	if (interface_version < sizeof(struct ivi_controller_interface)) {
+		weston_log("ivi-layout-bench: version mismatch of controller interface\n");
+		return -1;
+	}
+
+	bench = zalloc(sizeof *bench);
+	if (bench == NULL)
+		return -1;
+
+	bench->compositor = compositor;
+	bench->ivi = interface;
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+	wl_event_loop_add_idle(loop, bench_run, bench);
+
+	return 0;
+}
@@ -0,0 +1,963 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../src/compositor.h"
+#include "../ivi-shell/ivi-layout-export.h"
+#include "ivi-test-client.h"
+
+/* ivi-layout tests.
+ *
+ * Loaded by ivi-shell as its ivi-module, this checks the ivi controller
+ * interface from the controller's side. A failed assertion fails the
+ * test. Tests which need ivi_surfaces run after the synchronous ones,
+ * one step per round trip of an in-process client. Transitions are
+ * checked last, as they advance on their own timer.
+ */
+
+int
+controller_module_init(struct weston_compositor *compositor,
+		       int *argc, char *argv[],
+		       const struct ivi_controller_interface *interface,
+		       size_t interface_version);
+
+#define SCENE_SURFACE 500
+#define SCENE_LAYER 600
+#define CACHE_SURFACE 700
+#define CACHE_LAYER 800
+#define TRANSITION_LAYER 900
+#define REPAINT_SURFACE 1000
+#define REPAINT_LAYER 1100
+
+/* Concurrent layer moves, started by one commit. The short ones, listed
+ * around the longer one, finish in the same frame. */
+struct transition_move {
+	uint32_t duration;
+	int32_t x, y;
+
+	struct ivi_layout_layer *layer;
+	int moving;		/* seen away from its destination */
+	int arrived;		/* commit that brought it back there */
+};
+
+static const struct transition_move transition_moves[] = {
+	{ 200, 100, 0 },
+	{ 200, 0, 100 },
+	{ 400, 100, 100 },
+	{ 200, 50, 0 },
+	{ 200, 0, 50 },
+};
+
+struct test_context {
+	struct weston_compositor *compositor;
+	const struct ivi_controller_interface *ivi;
+
+	struct ivi_layout_layer *layers[2];
+	int notified;
+
+	struct ivi_test_client *client;
+	struct wl_event_source *client_source;
+	struct ivi_test_surface *surface;
+	int configured;
+	char scene_path[256];
+
+	struct wl_listener frame_listener;
+	void (*frame_done)(struct test_context *ctx);
+	struct ivi_layout_layer_cache_stats cache_stats;
+
+	struct transition_move moves[ARRAY_LENGTH(transition_moves)];
+	int commits;
+	struct wl_event_source *settle_timer;
+
+	struct weston_output *outputs[2];
+	struct wl_event_source *idle_timer;
+	void (*idle_done)(struct test_context *ctx);
+};
+
+/* Moves the other layer and commits from the first layer's listener. */
+static void
+layer_moved(struct ivi_layout_layer *ivilayer,
+	    const struct ivi_layout_layer_properties *prop,
+	    enum ivi_layout_notification_mask mask,
+	    void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+
+	if (ctx->notified++ > 0)
+		return;
+
+	assert(mask & IVI_NOTIFICATION_POSITION);
+	ivi->layer_set_position(ctx->layers[1], 30, 40);
+	ivi->commit_changes();
+}
+
+/* A change made from a property notification to another object of the
+ * same commit is applied by the commit made from the notification. */
+static void
+test_commit_from_property_notification(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	int32_t x, y;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		ctx->layers[i] = ivi->layer_create_with_dimension(100 + i,
+								  64, 64);
+		assert(ctx->layers[i]);
+	}
+	ivi->commit_changes();
+
+	ctx->notified = 0;
+	ivi->layer_add_notification(ctx->layers[0], layer_moved, ctx);
+
+	ivi->layer_set_position(ctx->layers[0], 10, 20);
+	ivi->layer_set_position(ctx->layers[1], 10, 20);
+	ivi->commit_changes();
+
+	assert(ctx->notified == 1);
+	assert(ivi->layer_get_position(ctx->layers[1], &x, &y) ==
+	       IVI_SUCCEEDED);
+	assert(x == 30 && y == 40);
+
+	ivi->layer_remove_notification(ctx->layers[0]);
+	for (i = 0; i < 2; i++)
+		ivi->layer_remove(ctx->layers[i]);
+}
+
+/* Moves the last listed layer and commits from the commit
+ * notification. */
+static void
+commit_notified(const struct ivi_layout_commit_summary *summary, void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+
+	if (ctx->notified++ > 0)
+		return;
+
+	assert(summary->layer_count == 2);
+	ivi->layer_set_position(summary->layers[1].ivilayer, 50, 60);
+	ivi->commit_changes();
+}
+
+/* A change made from the commit notification to a listed object is
+ * applied by the commit made from the notification. */
+static void
+test_commit_from_commit_notification(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	int32_t x, y;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		ctx->layers[i] = ivi->layer_create_with_dimension(200 + i,
+								  64, 64);
+		assert(ctx->layers[i]);
+	}
+	ivi->commit_changes();
+
+	ctx->notified = 0;
+	ivi->add_notification_commit(commit_notified, ctx);
+
+	ivi->layer_set_position(ctx->layers[0], 10, 20);
+	ivi->layer_set_position(ctx->layers[1], 10, 20);
+	ivi->commit_changes();
+
+	/* the nested commit notifies too */
+	assert(ctx->notified == 2);
+	assert(ivi->layer_get_position(ctx->layers[1], &x, &y) ==
+	       IVI_SUCCEEDED);
+	assert(x == 50 && y == 60);
+
+	ivi->remove_notification_commit(commit_notified, ctx);
+	for (i = 0; i < 2; i++)
+		ivi->layer_remove(ctx->layers[i]);
+}
+
+static void
+write_scene(struct test_context *ctx, const char *scene)
+{
+	FILE *fp;
+
+	fp = fopen(ctx->scene_path, "w");
+	assert(fp);
+	fputs(scene, fp);
+	fclose(fp);
+}
+
+/* A file which does not parse is rejected without changing the scene,
+ * even where its first lines are valid. */
+static void
+test_scene_malformed(struct test_context *ctx)
+{
+	static const char *scenes[] = {
+		"ivi-scene 0\n",
+		"ivi-scene 1\n"
+		"layer 401 1 256 0 0 64 64 0 0 64 64 0 0\n"
+		"layer 400 1 256 0 0 64 64 7 8 64 64 0 3 1\n",
+		"ivi-scene 1\n"
+		"layer 401 1 256 0 0 64 64 0 0 64 64 0 0\n"
+		"window 400\n",
+	};
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct ivi_layout_layer *ivilayer;
+	unsigned int i;
+	int32_t x, y;
+
+	ivilayer = ivi->layer_create_with_dimension(400, 64, 64);
+	assert(ivilayer);
+	ivi->layer_set_position(ivilayer, 5, 6);
+	ivi->commit_changes();
+
+	for (i = 0; i < ARRAY_LENGTH(scenes); i++) {
+		write_scene(ctx, scenes[i]);
+		assert(ivi->scene_restore(ctx->scene_path) == IVI_FAILED);
+
+		assert(ivi->get_layer_from_id(401) == NULL);
+		assert(ivi->layer_get_position(ivilayer, &x, &y) ==
+		       IVI_SUCCEEDED);
+		assert(x == 5 && y == 6);
+	}
+
+	ivi->layer_remove(ivilayer);
+}
+
+static void
+surface_configured(struct ivi_layout_surface *ivisurf, void *data)
+{
+	struct test_context *ctx = data;
+
+	if (ctx->ivi->get_id_of_surface(ivisurf) == SCENE_SURFACE)
+		ctx->configured++;
+}
+
+/* Saves a scene, changes every part of it, and restores it. */
+static void
+test_scene_round_trip(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct ivi_layout_surface_properties sprop;
+	struct ivi_layout_layer_properties lprop;
+	const struct ivi_layout_surface_properties *sp;
+	const struct ivi_layout_layer_properties *lp;
+	struct ivi_layout_surface *ivisurf;
+	struct ivi_layout_surface **surfaces;
+	struct ivi_layout_layer *bottom, *top;
+	struct ivi_layout_layer *order[2];
+	struct ivi_layout_layer **layers;
+	struct ivi_layout_screen *iviscrn;
+	int32_t length;
+
+	ivisurf = ivi->get_surface_from_id(SCENE_SURFACE);
+	bottom = ivi->get_layer_from_id(SCENE_LAYER);
+	top = ivi->layer_create_with_dimension(SCENE_LAYER + 1, 100, 100);
+	iviscrn = ivi->get_screen_from_id(0);
+	assert(ivisurf && bottom && top && iviscrn);
+
+	ivi->surface_set_opacity(ivisurf, wl_fixed_from_double(0.75));
+	ivi->surface_set_destination_rectangle(ivisurf, 1, 2, 3, 4);
+	ivi->surface_set_orientation(ivisurf, WL_OUTPUT_TRANSFORM_90);
+	ivi->layer_set_visibility(top, true);
+	ivi->layer_set_opacity(top, wl_fixed_from_double(0.5));
+	ivi->layer_set_destination_rectangle(top, 5, 6, 70, 80);
+	ivi->layer_set_render_order(top, &ivisurf, 1);
+	order[0] = bottom;
+	order[1] = top;
+	ivi->screen_set_render_order(iviscrn, order, 2);
+	ivi->commit_changes();
+
+	sprop = *ivi->get_properties_of_surface(ivisurf);
+	lprop = *ivi->get_properties_of_layer(top);
+	assert(ivi->scene_save(ctx->scene_path) == IVI_SUCCEEDED);
+
+	ivi->surface_set_opacity(ivisurf, wl_fixed_from_int(1));
+	ivi->surface_set_destination_rectangle(ivisurf, 9, 9, 9, 9);
+	ivi->surface_set_orientation(ivisurf, WL_OUTPUT_TRANSFORM_NORMAL);
+	ivi->layer_set_render_order(bottom, NULL, 0);
+	ivi->screen_set_render_order(iviscrn, &bottom, 1);
+	ivi->layer_remove(top);
+	ivi->commit_changes();
+
+	assert(ivi->scene_restore(ctx->scene_path) == IVI_SUCCEEDED);
+
+	sp = ivi->get_properties_of_surface(ivisurf);
+	assert(sp->visibility == sprop.visibility);
+	assert(sp->opacity == sprop.opacity);
+	assert(sp->dest_x == 1 && sp->dest_y == 2);
+	assert(sp->dest_width == 3 && sp->dest_height == 4);
+	assert(sp->orientation == WL_OUTPUT_TRANSFORM_90);
+
+	top = ivi->get_layer_from_id(SCENE_LAYER + 1);
+	assert(top);
+	lp = ivi->get_properties_of_layer(top);
+	assert(lp->visibility == lprop.visibility);
+	assert(lp->opacity == lprop.opacity);
+	assert(lp->dest_x == 5 && lp->dest_y == 6);
+	assert(lp->dest_width == 70 && lp->dest_height == 80);
+
+	assert(ivi->get_layers_on_screen(iviscrn, &length, &layers) ==
+	       IVI_SUCCEEDED);
+	assert(length == 2);
+	assert(layers[0] == bottom && layers[1] == top);
+	free(layers);
+
+	assert(ivi->get_surfaces_on_layer(bottom, &length, &surfaces) ==
+	       IVI_SUCCEEDED);
+	assert(length == 1 && surfaces[0] == ivisurf);
+	free(surfaces);
+
+	assert(ivi->get_surfaces_on_layer(top, &length, &surfaces) ==
+	       IVI_SUCCEEDED);
+	assert(length == 1 && surfaces[0] == ivisurf);
+	free(surfaces);
+}
+
+static void scene_surface_created(void *data);
+
+/* Restores a scene with an ivi_surface which does not exist yet, then
+ * creates it. */
+static void
+test_scene_pending_surface(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct ivi_layout_layer *ivilayer;
+	struct ivi_layout_screen *iviscrn;
+	struct ivi_layout_layer **layers;
+	int32_t length;
+
+	write_scene(ctx,
+		    "ivi-scene 1\n"
+		    "surface 500 1 128 0 0 64 64 10 20 30 40 0\n"
+		    "layer 600 1 256 0 0 200 200 0 0 200 200 0 1 500\n"
+		    "screen 0 1 600\n");
+	assert(ivi->scene_restore(ctx->scene_path) == IVI_SUCCEEDED);
+
+	ivilayer = ivi->get_layer_from_id(SCENE_LAYER);
+	assert(ivilayer);
+	assert(ivi->layer_get_visibility(ivilayer));
+
+	iviscrn = ivi->get_screen_from_id(0);
+	assert(iviscrn);
+	assert(ivi->get_layers_on_screen(iviscrn, &length, &layers) ==
+	       IVI_SUCCEEDED);
+	assert(length == 1 && layers[0] == ivilayer);
+	free(layers);
+
+	assert(ivi->get_surface_from_id(SCENE_SURFACE) == NULL);
+
+	ctx->configured = 0;
+	ivi->add_notification_configure_surface(surface_configured, ctx);
+
+	ctx->surface = ivi_test_surface_create(ctx->client, SCENE_SURFACE);
+	ivi_test_surface_commit(ctx->surface, 20, 20, 0xff0000ff, NULL, NULL);
+	ivi_test_client_sync(ctx->client, scene_surface_created, ctx);
+}
+
+static void scene_round_trip_done(void *data);
+static void test_layer_cache(struct test_context *ctx);
+
+/* The ivi_surface is placed as it is created and shows at the
+ * controller's next commit. Its buffer still sets its source
+ * rectangle, and the controller is told about its first configure. */
+static void
+scene_surface_created(void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	const struct ivi_layout_surface_properties *prop;
+	struct ivi_layout_surface *ivisurf;
+	struct ivi_layout_surface **surfaces;
+	struct ivi_layout_layer *ivilayer;
+	int32_t length;
+
+	ivi->remove_notification_configure_surface(surface_configured, ctx);
+
+	ivisurf = ivi->get_surface_from_id(SCENE_SURFACE);
+	assert(ivisurf);
+	assert(ctx->configured == 1);
+
+	ivilayer = ivi->get_layer_from_id(SCENE_LAYER);
+	assert(ivi->get_surfaces_on_layer(ivilayer, &length, &surfaces) ==
+	       IVI_SUCCEEDED);
+	assert(length == 0);
+	free(surfaces);
+
+	ivi->commit_changes();
+
+	assert(ivi->get_surfaces_on_layer(ivilayer, &length, &surfaces) ==
+	       IVI_SUCCEEDED);
+	assert(length == 1 && surfaces[0] == ivisurf);
+	free(surfaces);
+
+	prop = ivi->get_properties_of_surface(ivisurf);
+	assert(prop->visibility);
+	assert(prop->opacity == 128);
+	assert(prop->dest_x == 10 && prop->dest_y == 20);
+	assert(prop->dest_width == 30 && prop->dest_height == 40);
+	assert(prop->source_width == 20 && prop->source_height == 20);
+
+	test_scene_round_trip(ctx);
+
+	ivi_test_surface_destroy(ctx->surface);
+	ivi_test_client_sync(ctx->client, scene_round_trip_done, ctx);
+}
+
+static void
+finish_tests(void *data)
+{
+	struct test_context *ctx = data;
+
+	wl_event_source_remove(ctx->client_source);
+	ivi_test_client_destroy(ctx->client);
+	unlink(ctx->scene_path);
+
+	wl_display_terminate(ctx->compositor->wl_display);
+	free(ctx);
+}
+
+static void
+scene_round_trip_done(void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+
+	assert(ivi->get_surface_from_id(SCENE_SURFACE) == NULL);
+
+	ivi->screen_set_render_order(ivi->get_screen_from_id(0), NULL, 0);
+	ivi->layer_remove(ivi->get_layer_from_id(SCENE_LAYER));
+	ivi->layer_remove(ivi->get_layer_from_id(SCENE_LAYER + 1));
+	ivi->commit_changes();
+
+	test_layer_cache(ctx);
+}
+
+static void
+frame_idle(void *data)
+{
+	struct test_context *ctx = data;
+
+	ctx->frame_done(ctx);
+}
+
+/* The output was repainted; the next step runs once that is over. */
+static void
+frame_notify(struct wl_listener *listener, void *data)
+{
+	struct test_context *ctx =
+		container_of(listener, struct test_context, frame_listener);
+	struct wl_event_loop *loop;
+
+	wl_list_remove(&listener->link);
+
+	loop = wl_display_get_event_loop(ctx->compositor->wl_display);
+	wl_event_loop_add_idle(loop, frame_idle, ctx);
+}
+
+static void
+wait_for_frame(struct test_context *ctx,
+	       void (*done)(struct test_context *ctx))
+{
+	struct weston_output *output;
+
+	output = container_of(ctx->compositor->output_list.next,
+			      struct weston_output, link);
+
+	ctx->frame_done = done;
+	ctx->frame_listener.notify = frame_notify;
+	wl_signal_add(&output->frame_signal, &ctx->frame_listener);
+	weston_output_schedule_repaint(output);
+}
+
+static void
+get_cache_stats(struct test_context *ctx,
+		struct ivi_layout_layer_cache_stats *stats)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+
+	assert(ivi->layer_get_cache_stats(ivi->get_layer_from_id(CACHE_LAYER),
+					  stats) == IVI_SUCCEEDED);
+}
+
+static void test_layer_transitions(void *data);
+
+static void
+cache_layer_removed(void *data)
+{
+	struct test_context *ctx = data;
+	struct wl_event_loop *loop;
+
+	/* Not from within the client's own dispatch. */
+	loop = wl_display_get_event_loop(ctx->compositor->wl_display);
+	wl_event_loop_add_idle(loop, test_layer_transitions, ctx);
+}
+
+/* Damaging a member renders the image again. */
+static void
+cache_member_changed(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct ivi_layout_layer_cache_stats stats;
+
+	get_cache_stats(ctx, &stats);
+	assert(stats.misses == ctx->cache_stats.misses + 1);
+
+	ivi->screen_set_render_order(ivi->get_screen_from_id(0), NULL, 0);
+	ivi->layer_remove(ivi->get_layer_from_id(CACHE_LAYER));
+	ivi->commit_changes();
+
+	ivi_test_surface_destroy(ctx->surface);
+	ivi_test_client_sync(ctx->client, cache_layer_removed, ctx);
+}
+
+static void
+cache_member_committed(void *data)
+{
+	struct test_context *ctx = data;
+
+	wait_for_frame(ctx, cache_member_changed);
+}
+
+/* Moving the layer reuses the image. */
+static void
+cache_layer_moved(struct test_context *ctx)
+{
+	struct ivi_layout_layer_cache_stats stats;
+
+	get_cache_stats(ctx, &stats);
+	assert(stats.misses == ctx->cache_stats.misses);
+	assert(stats.hits > ctx->cache_stats.hits);
+	ctx->cache_stats = stats;
+
+	ivi_test_surface_commit(ctx->surface, 64, 64, 0xffff0000, NULL, NULL);
+	ivi_test_client_sync(ctx->client, cache_member_committed, ctx);
+}
+
+/* The first repaint renders the image of the layer's only member. */
+static void
+cache_first_frame(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+
+	get_cache_stats(ctx, &ctx->cache_stats);
+	assert(ctx->cache_stats.misses == 1);
+	assert(ctx->cache_stats.bytes == 64 * 64 * 4);
+
+	ivi->layer_set_position(ivi->get_layer_from_id(CACHE_LAYER), 10, 10);
+	ivi->commit_changes();
+	wait_for_frame(ctx, cache_layer_moved);
+}
+
+static void
+cache_surface_created(void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct ivi_layout_layer_cache_stats stats;
+	struct ivi_layout_surface *ivisurf;
+	struct ivi_layout_layer *ivilayer;
+
+	ivisurf = ivi->get_surface_from_id(CACHE_SURFACE);
+	ivilayer = ivi->layer_create_with_dimension(CACHE_LAYER, 200, 200);
+	assert(ivisurf && ivilayer);
+
+	ivi->surface_set_visibility(ivisurf, true);
+	ivi->surface_set_destination_rectangle(ivisurf, 0, 0, 64, 64);
+	ivi->layer_set_visibility(ivilayer, true);
+	ivi->layer_set_destination_rectangle(ivilayer, 0, 0, 200, 200);
+	ivi->layer_add_surface(ivilayer, ivisurf);
+	ivi->screen_set_render_order(ivi->get_screen_from_id(0), &ivilayer, 1);
+	assert(ivi->layer_set_cache(ivilayer, true) == IVI_SUCCEEDED);
+
+	/* Nothing is cached before the commit. */
+	get_cache_stats(ctx, &stats);
+	assert(stats.hits == 0 && stats.misses == 0 && stats.bytes == 0);
+
+	ivi->commit_changes();
+	wait_for_frame(ctx, cache_first_frame);
+}
+
+/* Checks when a cached layer renders its image again. */
+static void
+test_layer_cache(struct test_context *ctx)
+{
+	ctx->surface = ivi_test_surface_create(ctx->client, CACHE_SURFACE);
+	ivi_test_surface_commit(ctx->surface, 64, 64, 0xff00ff00, NULL, NULL);
+	ivi_test_client_sync(ctx->client, cache_surface_created, ctx);
+}
+
+static void
+transition_committed(const struct ivi_layout_commit_summary *summary,
+		     void *data);
+static void test_output_repaint(void *data);
+
+static int
+transitions_settled(void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct wl_event_loop *loop;
+	int short_arrived = 0, long_arrived = 0;
+	unsigned int i;
+
+	ivi->remove_notification_commit(transition_committed, ctx);
+
+	for (i = 0; i < ARRAY_LENGTH(ctx->moves); i++) {
+		if (ctx->moves[i].duration > 200) {
+			long_arrived = ctx->moves[i].arrived;
+			continue;
+		}
+
+		if (short_arrived == 0)
+			short_arrived = ctx->moves[i].arrived;
+		assert(ctx->moves[i].arrived == short_arrived);
+	}
+	assert(short_arrived > 0 && long_arrived > short_arrived);
+
+	/* No transition frame after the last one finished. */
+	assert(ctx->commits == long_arrived);
+
+	for (i = 0; i < ARRAY_LENGTH(ctx->moves); i++)
+		ivi->layer_remove(ctx->moves[i].layer);
+	ivi->commit_changes();
+
+	wl_event_source_remove(ctx->settle_timer);
+	ctx->settle_timer = NULL;
+
+	loop = wl_display_get_event_loop(ctx->compositor->wl_display);
+	wl_event_loop_add_idle(loop, test_output_repaint, ctx);
+
+	return 0;
+}
+
+/* Every transition frame ends in a commit. */
+static void
+transition_committed(const struct ivi_layout_commit_summary *summary,
+		     void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct transition_move *move;
+	struct wl_event_loop *loop;
+	unsigned int i, arrived = 0;
+	int32_t x, y;
+
+	ctx->commits++;
+
+	for (i = 0; i < ARRAY_LENGTH(ctx->moves); i++) {
+		move = &ctx->moves[i];
+		ivi->layer_get_position(move->layer, &x, &y);
+
+		if (x != move->x || y != move->y) {
+			move->moving = 1;
+			move->arrived = 0;
+		} else if (move->moving && move->arrived == 0) {
+			move->arrived = ctx->commits;
+		}
+
+		if (move->arrived)
+			arrived++;
+	}
+
+	/* A transition still running would commit again within a few
+	 * frames. */
+	if (arrived == ARRAY_LENGTH(ctx->moves) && !ctx->settle_timer) {
+		loop = wl_display_get_event_loop(ctx->compositor->wl_display);
+		ctx->settle_timer = wl_event_loop_add_timer(loop,
+							    transitions_settled,
+							    ctx);
+		wl_event_source_timer_update(ctx->settle_timer, 200);
+	}
+}
+
+/* Concurrent moves reach their destinations, those of the same duration
+ * in the same frame, and the transitions are gone once all arrived. */
+static void
+test_layer_transitions(void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct transition_move *move;
+	unsigned int i;
+
+	memcpy(ctx->moves, transition_moves, sizeof ctx->moves);
+	ctx->commits = 0;
+
+	for (i = 0; i < ARRAY_LENGTH(ctx->moves); i++) {
+		move = &ctx->moves[i];
+		move->layer = ivi->layer_create_with_dimension(
+					TRANSITION_LAYER + i, 64, 64);
+		assert(move->layer);
+	}
+	ivi->commit_changes();
+
+	ivi->add_notification_commit(transition_committed, ctx);
+
+	for (i = 0; i < ARRAY_LENGTH(ctx->moves); i++) {
+		move = &ctx->moves[i];
+		ivi->layer_set_transition(move->layer,
+					  IVI_LAYOUT_TRANSITION_LAYER_MOVE,
+					  move->duration);
+		ivi->layer_set_position(move->layer, move->x, move->y);
+	}
+	ivi->commit_changes();
+}
+
+static int
+outputs_idle_check(void *data)
+{
+	struct test_context *ctx = data;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_LENGTH(ctx->outputs); i++) {
+		if (ctx->outputs[i]->repaint_scheduled) {
+			wl_event_source_timer_update(ctx->idle_timer, 10);
+			return 0;
+		}
+	}
+
+	ctx->idle_done(ctx);
+
+	return 0;
+}
+
+/* Runs the next step once no output has a repaint scheduled, so that
+ * the step sees which outputs its own commit scheduled. */
+static void
+wait_for_idle_outputs(struct test_context *ctx,
+		      void (*done)(struct test_context *ctx))
+{
+	ctx->idle_done = done;
+	wl_event_source_timer_update(ctx->idle_timer, 10);
+}
+
+static void
+assert_scheduled(struct test_context *ctx, int first, int second)
+{
+	assert(ctx->outputs[0]->repaint_scheduled == first);
+	assert(ctx->outputs[1]->repaint_scheduled == second);
+}
+
+static void
+repaint_layer_removed(void *data)
+{
+	struct test_context *ctx = data;
+	struct wl_event_loop *loop;
+
+	wl_event_source_remove(ctx->idle_timer);
+	ctx->idle_timer = NULL;
+
+	/* Not from within the client's own dispatch. */
+	loop = wl_display_get_event_loop(ctx->compositor->wl_display);
+	wl_event_loop_add_idle(loop, finish_tests, ctx);
+}
+
+/* A commit changing nothing repaints nothing. */
+static void
+repaint_empty_commit(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+
+	ivi->commit_changes();
+	assert_scheduled(ctx, 0, 0);
+
+	ivi->screen_set_render_order(ivi->get_screen_from_id(0), NULL, 0);
+	ivi->layer_remove(ivi->get_layer_from_id(REPAINT_LAYER));
+	ivi->commit_changes();
+
+	ivi_test_surface_destroy(ctx->surface);
+	ivi_test_client_sync(ctx->client, repaint_layer_removed, ctx);
+}
+
+/* Moving the ivi_layer moves its ivi_surface onto the second output,
+ * although the ivi_layer is only on the first ivi_screen. Both outputs
+ * repaint. The ivi_layer is cached, so that nothing damages the
+ * ivi_surface. */
+static void
+repaint_across_outputs(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+
+	ivi->layer_set_position(ivi->get_layer_from_id(REPAINT_LAYER),
+				ctx->outputs[1]->x, 0);
+	ivi->commit_changes();
+	assert_scheduled(ctx, 1, 1);
+
+	wait_for_idle_outputs(ctx, repaint_empty_commit);
+}
+
+/* A change on the first ivi_screen repaints only its output. */
+static void
+repaint_one_screen(struct test_context *ctx)
+{
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct ivi_layout_surface *ivisurf;
+
+	ivisurf = ivi->get_surface_from_id(REPAINT_SURFACE);
+	ivi->surface_set_destination_rectangle(ivisurf, 10, 10, 64, 64);
+	ivi->commit_changes();
+	assert_scheduled(ctx, 1, 0);
+
+	wait_for_idle_outputs(ctx, repaint_across_outputs);
+}
+
+static void
+repaint_surface_created(void *data)
+{
+	struct test_context *ctx = data;
+	const struct ivi_controller_interface *ivi = ctx->ivi;
+	struct ivi_layout_surface *ivisurf;
+	struct ivi_layout_layer *ivilayer;
+	int32_t width;
+
+	width = ctx->outputs[0]->width + ctx->outputs[1]->width;
+	ivisurf = ivi->get_surface_from_id(REPAINT_SURFACE);
+	ivilayer = ivi->layer_create_with_dimension(REPAINT_LAYER, width,
+						    ctx->outputs[0]->height);
+	assert(ivisurf && ivilayer);
+
+	ivi->surface_set_visibility(ivisurf, true);
+	ivi->surface_set_destination_rectangle(ivisurf, 0, 0, 64, 64);
+	ivi->layer_set_visibility(ivilayer, true);
+	ivi->layer_set_destination_rectangle(ivilayer, 0, 0, width,
+					     ctx->outputs[0]->height);
+	ivi->layer_add_surface(ivilayer, ivisurf);
+	ivi->screen_set_render_order(ivi->get_screen_from_id(0), &ivilayer, 1);
+	assert(ivi->layer_set_cache(ivilayer, true) == IVI_SUCCEEDED);
+	ivi->commit_changes();
+
+	wait_for_idle_outputs(ctx, repaint_one_screen);
+}
+
+/* Checks which of two outputs a commit repaints. */
+static void
+test_output_repaint(void *data)
+{
+	struct test_context *ctx = data;
+	struct weston_output *output;
+	struct wl_event_loop *loop;
+	unsigned int i = 0;
+
+	wl_list_for_each(output, &ctx->compositor->output_list, link) {
+		assert(i < ARRAY_LENGTH(ctx->outputs));
+		ctx->outputs[i++] = output;
+	}
+	assert(i == ARRAY_LENGTH(ctx->outputs));
+
+	loop = wl_display_get_event_loop(ctx->compositor->wl_display);
+	ctx->idle_timer = wl_event_loop_add_timer(loop, outputs_idle_check,
+						  ctx);
+	assert(ctx->idle_timer);
+
+	ctx->surface = ivi_test_surface_create(ctx->client, REPAINT_SURFACE);
+	ivi_test_surface_commit(ctx->surface, 64, 64, 0xff0000ff, NULL, NULL);
+	ivi_test_client_sync(ctx->client, repaint_surface_created, ctx);
+}
+
+static int
+client_readable(int fd, uint32_t mask, void *data)
+{
+	struct test_context *ctx = data;
+
+	assert(ivi_test_client_dispatch(ctx->client) == 0);
+
+	return 0;
+}
+
+static void
+client_ready(void *data)
+{
+	struct test_context *ctx = data;
+
+	test_scene_pending_surface(ctx);
+}
+
+static void
+start_client(struct test_context *ctx)
+{
+	struct wl_event_loop *loop;
+	int sv[2];
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == 0);
+	assert(wl_client_create(ctx->compositor->wl_display, sv[0]));
+
+	ctx->client = ivi_test_client_create(sv[1]);
+	assert(ctx->client);
+
+	loop = wl_display_get_event_loop(ctx->compositor->wl_display);
+	ctx->client_source = wl_event_loop_add_fd(loop, sv[1],
+						  WL_EVENT_READABLE,
+						  client_readable, ctx);
+	assert(ctx->client_source);
+
+	ivi_test_client_sync(ctx->client, client_ready, ctx);
+}
+
+static void
+run_tests(void *data)
+{
+	struct test_context *ctx = data;
+
+	test_commit_from_property_notification(ctx);
+	test_commit_from_commit_notification(ctx);
+	test_scene_malformed(ctx);
+
+	start_client(ctx);
+}
+
+WL_EXPORT int
+controller_module_init(struct weston_compositor *compositor,
+		       int *argc, char *argv[],
+		       const struct ivi_controller_interface *interface,
+		       size_t interface_version)
+{
+	struct wl_event_loop *loop;
+	struct test_context *ctx;
+
+	if (interface_version < sizeof(struct ivi_controller_interface)) {
+		weston_log("ivi-layout-test: version mismatch of controller interface\n");
+		return -1;
+	}
+
+	ctx = zalloc(sizeof *ctx);
+	if (ctx == NULL)
+		return -1;
+
+	ctx->compositor = compositor;
+	ctx->ivi = interface;
+	snprintf(ctx->scene_path, sizeof ctx->scene_path,
+		 "%s/ivi-layout-test.scene",
+		 getenv("XDG_RUNTIME_DIR") ? getenv("XDG_RUNTIME_DIR") : "/tmp");
+
+	loop = wl_display_get_event_loop(compositor->wl_display);
+	wl_event_loop_add_idle(loop, run_tests, ctx);
+
+	return 0;
+}
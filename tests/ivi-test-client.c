@@ -0,0 +1,272 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <wayland-client.h>
+
+#include "../shared/os-compatibility.h"
+#include "../shared/zalloc.h"
+#include "ivi-test-client.h"
+#include "ivi-application-client-protocol.h"
+
+struct ivi_test_client {
+	struct wl_display *display;
+	struct wl_registry *registry;
+	struct wl_compositor *compositor;
+	struct wl_shm *shm;
+	struct ivi_application *ivi_application;
+};
+
+struct ivi_test_surface {
+	struct ivi_test_client *client;
+	struct wl_surface *surface;
+	struct ivi_surface *ivi_surface;
+	struct wl_buffer *buffer;
+};
+
+struct done_closure {
+	ivi_test_done_func_t done;
+	void *data;
+};
+
+static void
+registry_handle_global(void *data, struct wl_registry *registry,
+		       uint32_t id, const char *interface, uint32_t version)
+{
+	struct ivi_test_client *client = data;
+
+	if (strcmp(interface, "wl_compositor") == 0) {
+		client->compositor =
+			wl_registry_bind(registry, id,
+					 &wl_compositor_interface, 1);
+	} else if (strcmp(interface, "wl_shm") == 0) {
+		client->shm =
+			wl_registry_bind(registry, id, &wl_shm_interface, 1);
+	} else if (strcmp(interface, "ivi_application") == 0) {
+		client->ivi_application =
+			wl_registry_bind(registry, id,
+					 &ivi_application_interface, 1);
+	}
+}
+
+static void
+registry_handle_global_remove(void *data, struct wl_registry *registry,
+			      uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+	registry_handle_global,
+	registry_handle_global_remove
+};
+
+/* Connects over fd. The globals are bound by the time the first
+ * ivi_test_client_sync() calls back. */
+struct ivi_test_client *
+ivi_test_client_create(int fd)
+{
+	struct ivi_test_client *client;
+
+	client = zalloc(sizeof *client);
+	if (client == NULL)
+		return NULL;
+
+	client->display = wl_display_connect_to_fd(fd);
+	if (client->display == NULL) {
+		free(client);
+		return NULL;
+	}
+
+	client->registry = wl_display_get_registry(client->display);
+	wl_registry_add_listener(client->registry, &registry_listener, client);
+	wl_display_flush(client->display);
+
+	return client;
+}
+
+void
+ivi_test_client_destroy(struct ivi_test_client *client)
+{
+	if (client->ivi_application)
+		ivi_application_destroy(client->ivi_application);
+	if (client->shm)
+		wl_shm_destroy(client->shm);
+	if (client->compositor)
+		wl_compositor_destroy(client->compositor);
+	wl_registry_destroy(client->registry);
+	wl_display_disconnect(client->display);
+	free(client);
+}
+
+int
+ivi_test_client_get_fd(struct ivi_test_client *client)
+{
+	return wl_display_get_fd(client->display);
+}
+
+/* Reads and dispatches what the compositor sent; call when the fd is
+ * readable. */
+int
+ivi_test_client_dispatch(struct ivi_test_client *client)
+{
+	struct wl_display *display = client->display;
+
+	while (wl_display_prepare_read(display) != 0) {
+		if (wl_display_dispatch_pending(display) < 0)
+			return -1;
+	}
+
+	if (wl_display_read_events(display) < 0)
+		return -1;
+
+	if (wl_display_dispatch_pending(display) < 0)
+		return -1;
+
+	return wl_display_flush(client->display) < 0 ? -1 : 0;
+}
+
+static void
+callback_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+	struct done_closure *closure = data;
+
+	wl_callback_destroy(callback);
+	closure->done(closure->data);
+	free(closure);
+}
+
+static const struct wl_callback_listener callback_listener = {
+	callback_done
+};
+
+static void
+add_done_callback(struct wl_callback *callback,
+		  ivi_test_done_func_t done, void *data)
+{
+	struct done_closure *closure;
+
+	closure = zalloc(sizeof *closure);
+	assert(closure);
+	closure->done = done;
+	closure->data = data;
+	wl_callback_add_listener(callback, &callback_listener, closure);
+}
+
+void
+ivi_test_client_sync(struct ivi_test_client *client,
+		     ivi_test_done_func_t done, void *data)
+{
+	add_done_callback(wl_display_sync(client->display), done, data);
+	wl_display_flush(client->display);
+}
+
+/* Gives a new wl_surface the role of ivi_surface ivi_id, without a
+ * buffer yet. */
+struct ivi_test_surface *
+ivi_test_surface_create(struct ivi_test_client *client, uint32_t ivi_id)
+{
+	struct ivi_test_surface *surface;
+
+	assert(client->compositor && client->ivi_application);
+
+	surface = zalloc(sizeof *surface);
+	assert(surface);
+
+	surface->client = client;
+	surface->surface = wl_compositor_create_surface(client->compositor);
+	surface->ivi_surface =
+		ivi_application_surface_create(client->ivi_application,
+					       ivi_id, surface->surface);
+	wl_display_flush(client->display);
+
+	return surface;
+}
+
+void
+ivi_test_surface_destroy(struct ivi_test_surface *surface)
+{
+	ivi_surface_destroy(surface->ivi_surface);
+	wl_surface_destroy(surface->surface);
+	if (surface->buffer)
+		wl_buffer_destroy(surface->buffer);
+	wl_display_flush(surface->client->display);
+	free(surface);
+}
+
+static struct wl_buffer *
+create_buffer(struct ivi_test_client *client,
+	      int width, int height, uint32_t color)
+{
+	struct wl_shm_pool *pool;
+	struct wl_buffer *buffer;
+	int stride = width * 4;
+	int size = stride * height;
+	uint32_t *pixels;
+	int fd, i;
+
+	assert(client->shm);
+
+	fd = os_create_anonymous_file(size);
+	assert(fd >= 0);
+
+	pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	assert(pixels != MAP_FAILED);
+	for (i = 0; i < width * height; i++)
+		pixels[i] = color;
+	munmap(pixels, size);
+
+	pool = wl_shm_create_pool(client->shm, fd, size);
+	buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride,
+					   WL_SHM_FORMAT_ARGB8888);
+	wl_shm_pool_destroy(pool);
+	close(fd);
+
+	return buffer;
+}
+
+/* Attaches a new width x height buffer filled with color (ARGB) and
+ * commits. frame_done, if set, is called once the commit is shown. */
+void
+ivi_test_surface_commit(struct ivi_test_surface *surface,
+			int width, int height, uint32_t color,
+			ivi_test_done_func_t frame_done, void *data)
+{
+	struct ivi_test_client *client = surface->client;
+
+	if (surface->buffer)
+		wl_buffer_destroy(surface->buffer);
+	surface->buffer = create_buffer(client, width, height, color);
+
+	wl_surface_attach(surface->surface, surface->buffer, 0, 0);
+	wl_surface_damage(surface->surface, 0, 0, width, height);
+	if (frame_done)
+		add_done_callback(wl_surface_frame(surface->surface),
+				  frame_done, data);
+	wl_surface_commit(surface->surface);
+	wl_display_flush(client->display);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _IVI_TEST_CLIENT_H_
+#define _IVI_TEST_CLIENT_H_
+
+#include <stdint.h>
+
+/* A wayland client living in the compositor process, for ivi-modules
+ * which need ivi_surfaces to test or measure the controller interface.
+ *
+ * The module connects it to the compositor over a socket pair and
+ * dispatches it from the compositor's event loop whenever its fd is
+ * readable. Nothing here blocks: requests are flushed as they are made,
+ * and ivi_test_client_sync() calls back once the compositor has handled
+ * everything sent before it.
+ */
+
+struct ivi_test_client;
+struct ivi_test_surface;
+
+typedef void (*ivi_test_done_func_t)(void *data);
+
+struct ivi_test_client *
+ivi_test_client_create(int fd);
+
+void
+ivi_test_client_destroy(struct ivi_test_client *client);
+
+int
+ivi_test_client_get_fd(struct ivi_test_client *client);
+
+int
+ivi_test_client_dispatch(struct ivi_test_client *client);
+
+void
+ivi_test_client_sync(struct ivi_test_client *client,
+		     ivi_test_done_func_t done, void *data);
+
+struct ivi_test_surface *
+ivi_test_surface_create(struct ivi_test_client *client, uint32_t ivi_id);
+
+void
+ivi_test_surface_destroy(struct ivi_test_surface *surface);
+
+void
+ivi_test_surface_commit(struct ivi_test_surface *surface,
+			int width, int height, uint32_t color,
+			ivi_test_done_func_t frame_done, void *data);
+
+#endif
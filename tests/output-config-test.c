@@ -0,0 +1,109 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include "weston-test-client-helper.h"
+
+/* Run with the [output] sections written by weston-tests-env. */
+char *server_parameters = "--use-pixman";
+
+struct expected_output {
+	int x, y;
+	int width, height;
+	int refresh;
+	int scale;
+	int transform;
+};
+
+static const struct expected_output expected[] = {
+	{ 0, 0, 640, 480, 60000, 1, WL_OUTPUT_TRANSFORM_NORMAL },
+	{ 640, 0, 800, 600, 60000, 2, WL_OUTPUT_TRANSFORM_90 },
+	/* To the right of the previous output, 600x800 at scale 2. */
+	{ 940, 0, 1024, 768, 30000, 1, WL_OUTPUT_TRANSFORM_FLIPPED_180 },
+};
+
+TEST(headless_output_sections)
+{
+	struct client *client;
+	struct output *output;
+	int i = 0;
+
+	client = client_create(0, 0, 1, 1);
+	assert(client);
+
+	assert(wl_list_length(&client->output_list) ==
+	       ARRAY_LENGTH(expected));
+
+	wl_list_for_each(output, &client->output_list, link) {
+		fprintf(stderr, "output %d: %d,%d %dx%d@%d scale %d "
+			"transform %d\n", i, output->x, output->y,
+			output->width, output->height, output->refresh,
+			output->scale, output->transform);
+
+		assert(output->x == expected[i].x);
+		assert(output->y == expected[i].y);
+		assert(output->width == expected[i].width);
+		assert(output->height == expected[i].height);
+		assert(output->refresh == expected[i].refresh);
+		assert(output->scale == expected[i].scale);
+		assert(output->transform == expected[i].transform);
+		i++;
+	}
+}
+
+TEST(headless_output_sections_repaint)
+{
+	struct client *client;
+	struct output *output;
+	struct repaint_stats stats;
+	struct wl_surface *surface;
+	struct wl_buffer *buffer;
+	void *pixels;
+	int done;
+
+	client = client_create(0, 0, 1, 1);
+	assert(client);
+
+	get_repaint_stats(client, &stats);
+
+	/* A surface on each output is repainted by that output. */
+	wl_list_for_each(output, &client->output_list, link) {
+		surface = wl_compositor_create_surface(client->wl_compositor);
+		buffer = create_shm_buffer(client, 32, 32, &pixels);
+		wl_surface_attach(surface, buffer, 0, 0);
+		wl_surface_damage(surface, 0, 0, 32, 32);
+		weston_test_move_surface(client->test->weston_test, surface,
+					 output->x + 16, output->y + 16);
+		frame_callback_set(surface, &done);
+		wl_surface_commit(surface);
+		frame_callback_wait(client, &done);
+	}
+
+	get_repaint_stats(client, &stats);
+
+	wl_list_for_each(output, &client->output_list, link)
+		assert(output->repaint_stats.frames > 0);
+}
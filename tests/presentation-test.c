@@ -31,6 +31,13 @@
 #include "weston-test-client-helper.h"
 #include "presentation_timing-client-protocol.h"
 
+/* Built twice: as presentation.weston against the real clock of the
+ * headless backend, and with PRESENTATION_VIRTUAL_CLOCK defined as
+ * presentation-virtual.weston, which adds the virtual clock checks. */
+#ifdef PRESENTATION_VIRTUAL_CLOCK
+char *server_parameters = "--frame-mode=virtual";
+#endif
+
 static struct presentation *
 get_presentation(struct client *client)
 {
@@ -236,3 +243,64 @@ TEST(test_presentation_feedback_simple)
 
 	feedback_destroy(fb);
 }
+
+#ifdef PRESENTATION_VIRTUAL_CLOCK
+static int64_t
+timespec_sub_to_nsec(const struct timespec *a, const struct timespec *b)
+{
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000 +
+	       a->tv_nsec - b->tv_nsec;
+}
+
+static struct feedback *
+commit_with_feedback(struct client *client)
+{
+	struct feedback *fb;
+
+	wl_surface_attach(client->surface->wl_surface,
+			  client->surface->wl_buffer, 0, 0);
+	fb = feedback_create(client, client->surface->wl_surface);
+	wl_surface_damage(client->surface->wl_surface, 0, 0, 100, 100);
+	wl_surface_commit(client->surface->wl_surface);
+
+	client_roundtrip(client);
+	feedback_wait(fb);
+	assert(fb->result == FB_PRESENTED);
+
+	return fb;
+}
+
+TEST(test_presentation_virtual_clock)
+{
+	struct client *client;
+	struct feedback *fb[3];
+	int64_t period, delta;
+
+	client = client_create(100, 50, 123, 77);
+	assert(client);
+
+	fb[0] = commit_with_feedback(client);
+	period = fb[0]->refresh_nsec;
+	assert(period > 0);
+
+	/* The virtual clock only moves by whole refresh periods. */
+	fb[1] = commit_with_feedback(client);
+	delta = timespec_sub_to_nsec(&fb[1]->time, &fb[0]->time);
+	assert(delta >= period);
+	assert(delta % period == 0);
+	assert(fb[1]->seq - fb[0]->seq == (uint64_t)(delta / period));
+
+	weston_test_step_clock(client->test->weston_test, 5);
+	fb[2] = commit_with_feedback(client);
+	delta = timespec_sub_to_nsec(&fb[2]->time, &fb[1]->time);
+	assert(delta >= 6 * period);
+	assert(delta % period == 0);
+
+	/* The frame counter steps along with the clock. */
+	assert(fb[2]->seq - fb[1]->seq == (uint64_t)(delta / period));
+
+	feedback_destroy(fb[0]);
+	feedback_destroy(fb[1]);
+	feedback_destroy(fb[2]);
+}
+#endif
@@ -0,0 +1,249 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "weston-test-client-helper.h"
+#include "image-compare.h"
+
+/* Reference image tests.
+ *
+ * Each scene is drawn on the headless backend with the pixman renderer,
+ * captured, and the clip rectangle compared with tests/reference/<name>.png.
+ * All scenes start from an opaque base surface covering the clip, so
+ * whatever the shell draws elsewhere does not matter. To add a scene,
+ * run it once without a reference and review the <name>-actual.png
+ * written to the logs directory before copying it into tests/reference.
+ */
+
+char *server_parameters = "--use-pixman --width=320 --height=240";
+
+#define CLIP_X 16
+#define CLIP_Y 16
+#define CLIP_SIZE 128
+
+enum scene_kind {
+	SCENE_SOLID,
+	SCENE_OVERLAP,
+	SCENE_ALPHA,
+	SCENE_SUBSURFACE,
+	SCENE_TRANSFORM_90,
+};
+
+struct reference_scene {
+	const char *name;
+	enum scene_kind kind;
+	struct image_tolerance tolerance;
+};
+
+static const struct reference_scene scenes[] = {
+	{ "solid", SCENE_SOLID, { 0, 0, 0, 0 } },
+	{ "overlap", SCENE_OVERLAP, { 0, 0, 0, 0 } },
+	/* Blending may round either way. */
+	{ "alpha", SCENE_ALPHA, { 0, 1, 1, 1 } },
+	{ "subsurface", SCENE_SUBSURFACE, { 0, 0, 0, 0 } },
+	{ "transform-90", SCENE_TRANSFORM_90, { 0, 0, 0, 0 } },
+};
+
+static struct wl_subcompositor *
+get_subcompositor(struct client *client)
+{
+	struct global *g;
+
+	wl_list_for_each(g, &client->global_list, link) {
+		if (strcmp(g->interface, "wl_subcompositor") == 0)
+			return wl_registry_bind(client->wl_registry, g->name,
+						&wl_subcompositor_interface, 1);
+	}
+
+	assert(0 && "no wl_subcompositor found");
+	return NULL;
+}
+
+static void
+fill(uint32_t *pixels, int stride, int x, int y, int width, int height,
+     uint32_t color)
+{
+	int i, j;
+
+	for (j = y; j < y + height; j++)
+		for (i = x; i < x + width; i++)
+			pixels[j * stride + i] = color;
+}
+
+/* Creates a surface showing a single premultiplied ARGB color. */
+static struct wl_surface *
+create_color_surface(struct client *client, int width, int height,
+		     uint32_t color)
+{
+	struct wl_surface *surface;
+	struct wl_buffer *buffer;
+	void *pixels;
+
+	buffer = create_shm_buffer(client, width, height, &pixels);
+	fill(pixels, width, 0, 0, width, height, color);
+
+	surface = wl_compositor_create_surface(client->wl_compositor);
+	wl_surface_attach(surface, buffer, 0, 0);
+	wl_surface_damage(surface, 0, 0, width, height);
+
+	return surface;
+}
+
+/* Maps a top-level surface, in clip coordinates. */
+static void
+map_surface(struct client *client, struct wl_surface *surface, int x, int y)
+{
+	weston_test_move_surface(client->test->weston_test, surface,
+				 CLIP_X + x, CLIP_Y + y);
+	wl_surface_commit(surface);
+}
+
+static void
+draw_scene(struct client *client, enum scene_kind kind)
+{
+	struct wl_subcompositor *subco;
+	struct wl_subsurface *sub;
+	struct wl_surface *base, *surface, *child;
+	struct wl_buffer *buffer;
+	void *pixels;
+
+	base = create_color_surface(client, CLIP_SIZE, CLIP_SIZE, 0xff204080);
+
+	switch (kind) {
+	case SCENE_SOLID:
+		map_surface(client, base, 0, 0);
+		break;
+	case SCENE_OVERLAP:
+		map_surface(client, base, 0, 0);
+		surface = create_color_surface(client, 64, 64, 0xffc00000);
+		map_surface(client, surface, 8, 8);
+		surface = create_color_surface(client, 64, 64, 0xff00c000);
+		map_surface(client, surface, 40, 40);
+		break;
+	case SCENE_ALPHA:
+		map_surface(client, base, 0, 0);
+		surface = create_color_surface(client, 64, 64, 0x80400000);
+		map_surface(client, surface, 32, 32);
+		break;
+	case SCENE_SUBSURFACE:
+		subco = get_subcompositor(client);
+		surface = create_color_surface(client, 32, 32, 0xffc0c000);
+		sub = wl_subcompositor_get_subsurface(subco, surface, base);
+		wl_subsurface_set_position(sub, 16, 16);
+		child = create_color_surface(client, 16, 16, 0xffc000c0);
+		sub = wl_subcompositor_get_subsurface(subco, child, surface);
+		wl_subsurface_set_position(sub, 8, 8);
+		wl_surface_commit(child);
+		wl_surface_commit(surface);
+		map_surface(client, base, 0, 0);
+		break;
+	case SCENE_TRANSFORM_90:
+		map_surface(client, base, 0, 0);
+		/* Red on the left, blue on the right of the buffer, which
+		 * puts blue on top and red at the bottom of the surface. */
+		buffer = create_shm_buffer(client, 64, 32, &pixels);
+		fill(pixels, 64, 0, 0, 32, 32, 0xffc00000);
+		fill(pixels, 64, 32, 0, 32, 32, 0xff0000c0);
+		surface = wl_compositor_create_surface(client->wl_compositor);
+		wl_surface_set_buffer_transform(surface,
+						WL_OUTPUT_TRANSFORM_90);
+		wl_surface_attach(surface, buffer, 0, 0);
+		wl_surface_damage(surface, 0, 0, 32, 64);
+		map_surface(client, surface, 32, 16);
+		break;
+	}
+
+	client_roundtrip(client);
+}
+
+TEST_P(reference_image, scenes)
+{
+	const struct reference_scene *scene = data;
+	struct client *client;
+
+	client = client_create(0, 0, 1, 1);
+	assert(client);
+
+	draw_scene(client, scene->kind);
+
+	assert(check_reference_image(client, scene->name, CLIP_X, CLIP_Y,
+				     CLIP_SIZE, CLIP_SIZE,
+				     &scene->tolerance));
+}
+
+/* Captures the whole output into a new buffer, returning its pixels. */
+static uint8_t *
+capture_output(struct client *client, struct wl_buffer **buffer)
+{
+	void *pixels;
+
+	*buffer = create_shm_buffer(client, client->output->width,
+				    client->output->height, &pixels);
+	capture_screenshot(client, *buffer);
+
+	return pixels;
+}
+
+/* Each scene drawn through a view cache must look the same as without
+ * it. The subsurface scene cannot be cached and checks it is drawn as
+ * usual. */
+TEST_P(reference_image_cached, scenes)
+{
+	const struct reference_scene *scene = data;
+	struct client *client;
+	struct wl_buffer *plain_buffer, *cached_buffer;
+	struct image_diff diff;
+	uint8_t *plain, *cached;
+	int stride, offset, size;
+
+	client = client_create(0, 0, 1, 1);
+	assert(client);
+
+	draw_scene(client, scene->kind);
+	plain = capture_output(client, &plain_buffer);
+
+	weston_test_cache_surfaces(client->test->weston_test);
+	cached = capture_output(client, &cached_buffer);
+
+	stride = client->output->width * 4;
+	offset = CLIP_Y * stride + CLIP_X * 4;
+	if (image_compare(cached + offset, stride, plain + offset, stride,
+			  CLIP_SIZE, CLIP_SIZE, &scene->tolerance,
+			  &diff, NULL, 0) != 0) {
+		fprintf(stderr, "%s: %d pixels differ when cached, largest "
+			"difference a %u r %u g %u b %u\n", scene->name,
+			diff.pixels, diff.max_a, diff.max_r, diff.max_g,
+			diff.max_b);
+		assert(0 && "cached scene differs");
+	}
+
+	size = stride * client->output->height;
+	wl_buffer_destroy(plain_buffer);
+	wl_buffer_destroy(cached_buffer);
+	munmap(plain, size);
+	munmap(cached, size);
+}
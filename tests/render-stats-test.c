@@ -0,0 +1,199 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "weston-test-client-helper.h"
+
+struct test_surface {
+	struct wl_surface *wl_surface;
+	struct wl_buffer *wl_buffer;
+	int width, height;
+};
+
+static void
+test_surface_create(struct client *client, struct test_surface *ts,
+		    int x, int y, int width, int height, int opaque)
+{
+	struct wl_region *region;
+	uint32_t *pixels;
+	int i, done;
+
+	ts->width = width;
+	ts->height = height;
+	ts->wl_surface = wl_compositor_create_surface(client->wl_compositor);
+	ts->wl_buffer = create_shm_buffer(client, width, height,
+					  (void **)&pixels);
+
+	for (i = 0; i < width * height; i++)
+		pixels[i] = opaque ? 0xff808080 : 0x80404040;
+
+	if (opaque) {
+		region = wl_compositor_create_region(client->wl_compositor);
+		wl_region_add(region, 0, 0, width, height);
+		wl_surface_set_opaque_region(ts->wl_surface, region);
+		wl_region_destroy(region);
+	}
+
+	wl_surface_attach(ts->wl_surface, ts->wl_buffer, 0, 0);
+	wl_surface_damage(ts->wl_surface, 0, 0, width, height);
+	weston_test_move_surface(client->test->weston_test,
+				 ts->wl_surface, x, y);
+	frame_callback_set(ts->wl_surface, &done);
+	wl_surface_commit(ts->wl_surface);
+	frame_callback_wait(client, &done);
+}
+
+static struct wl_subcompositor *
+get_subcompositor(struct client *client)
+{
+	struct global *g;
+
+	wl_list_for_each(g, &client->global_list, link) {
+		if (strcmp(g->interface, "wl_subcompositor") == 0)
+			return wl_registry_bind(client->wl_registry, g->name,
+						&wl_subcompositor_interface, 1);
+	}
+
+	assert(0 && "no wl_subcompositor found");
+	return NULL;
+}
+
+/* Commits the damage and waits until it has been repainted. */
+static void
+test_surface_damage(struct client *client, struct test_surface *ts,
+		    int x, int y, int width, int height)
+{
+	int done;
+
+	wl_surface_attach(ts->wl_surface, ts->wl_buffer, 0, 0);
+	wl_surface_damage(ts->wl_surface, x, y, width, height);
+	frame_callback_set(ts->wl_surface, &done);
+	wl_surface_commit(ts->wl_surface);
+	frame_callback_wait(client, &done);
+}
+
+TEST(render_stats_partial_damage)
+{
+	struct client *client;
+	struct render_stats stats;
+	struct test_surface ts;
+
+	client = client_create(0, 0, 1, 1);
+	assert(client);
+
+	/* Start recording. */
+	get_render_stats(client, &stats);
+
+	test_surface_create(client, &ts, 100, 100, 200, 200, 1);
+	test_surface_damage(client, &ts, 10, 10, 10, 10);
+
+	get_render_stats(client, &stats);
+	assert(stats.frames >= 2);
+	assert(stats.damage_pixels == 100);
+	assert(stats.views == 1);
+	assert(stats.opaque_rects == 1);
+	assert(stats.opaque_pixels == 100);
+	assert(stats.blended_rects == 0);
+	assert(stats.blended_pixels == 0);
+	assert(stats.upload_bytes == 100 * 4);
+}
+
+TEST(render_stats_blended_overdraw)
+{
+	struct client *client;
+	struct render_stats stats;
+	struct test_surface below, above;
+
+	client = client_create(0, 0, 1, 1);
+	assert(client);
+
+	get_render_stats(client, &stats);
+
+	test_surface_create(client, &below, 100, 100, 100, 100, 1);
+	test_surface_create(client, &above, 125, 125, 50, 50, 0);
+
+	/* The translucent surface does not hide the one below, so its
+	 * damage gets drawn twice. */
+	test_surface_damage(client, &above, 0, 0, 50, 50);
+
+	get_render_stats(client, &stats);
+	assert(stats.damage_pixels == 2500);
+	assert(stats.views == 2);
+	assert(stats.opaque_pixels == 2500);
+	assert(stats.blended_pixels == 2500);
+	assert(stats.upload_bytes == 2500 * 4);
+}
+
+TEST(render_stats_opaque_subsurface)
+{
+	struct client *client;
+	struct render_stats stats;
+	struct wl_subcompositor *subco;
+	struct wl_subsurface *sub;
+	struct wl_region *region;
+	struct test_surface parent, child;
+	uint32_t *pixels;
+	int i;
+
+	client = client_create(0, 0, 1, 1);
+	assert(client);
+	subco = get_subcompositor(client);
+
+	get_render_stats(client, &stats);
+
+	test_surface_create(client, &parent, 100, 100, 100, 100, 1);
+
+	child.width = 50;
+	child.height = 50;
+	child.wl_surface = wl_compositor_create_surface(client->wl_compositor);
+	child.wl_buffer = create_shm_buffer(client, 50, 50, (void **)&pixels);
+	for (i = 0; i < 50 * 50; i++)
+		pixels[i] = 0xff202020;
+
+	region = wl_compositor_create_region(client->wl_compositor);
+	wl_region_add(region, 0, 0, 50, 50);
+	wl_surface_set_opaque_region(child.wl_surface, region);
+	wl_region_destroy(region);
+
+	sub = wl_subcompositor_get_subsurface(subco, child.wl_surface,
+					      parent.wl_surface);
+	wl_subsurface_set_position(sub, 25, 25);
+	wl_subsurface_set_desync(sub);
+	wl_surface_attach(child.wl_surface, child.wl_buffer, 0, 0);
+	wl_surface_commit(child.wl_surface);
+	test_surface_damage(client, &parent, 0, 0, 100, 100);
+
+	/* The sub-surface view is only translated, so the renderers draw
+	 * its opaque region without blending, and so do the stats. Its
+	 * view has no transform.opaque, so the parent below is drawn
+	 * as well. */
+	test_surface_damage(client, &child, 0, 0, 50, 50);
+
+	get_render_stats(client, &stats);
+	assert(stats.damage_pixels == 2500);
+	assert(stats.views == 2);
+	assert(stats.opaque_pixels == 5000);
+	assert(stats.blended_pixels == 0);
+}
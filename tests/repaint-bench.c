@@ -0,0 +1,375 @@
+/*
+ * Copyright © 2015 The Weston contributors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "weston-test-client-helper.h"
+
+/* Repaint benchmarks.
+ *
+ * Every scene is drawn for a number of frames on the headless backend
+ * with the pixman renderer, completing frames as fast as the compositor
+ * can. With several outputs, each gets its own copy of the scene and a
+ * frame, or cycle, ends once all of them repainted. Each scene writes
+ * one line of JSON with the frame rate, the time spent in
+ * weston_output_repaint() overall and on each output and, when weston
+ * runs with alloc-counter.so preloaded, the compositor's heap
+ * allocations per frame. Results go to the file named by
+ * WESTON_BENCH_RESULTS, or to stdout. Run through "make bench".
+ */
+
+char *server_parameters =
+	"--use-pixman --frame-mode=unthrottled --width=1024 --height=768";
+
+enum scene_kind {
+	SCENE_OPAQUE,
+	SCENE_ALPHA,
+	SCENE_SUBSURFACE_TREE,
+	SCENE_ROTATED,
+	SCENE_TINY_DAMAGE,
+};
+
+struct bench_scene {
+	const char *name;
+	enum scene_kind kind;
+	int count;
+};
+
+static const struct bench_scene scenes[] = {
+	{ "opaque", SCENE_OPAQUE, 16 },
+	{ "opaque", SCENE_OPAQUE, 64 },
+	{ "alpha", SCENE_ALPHA, 16 },
+	{ "alpha", SCENE_ALPHA, 64 },
+	{ "subsurface-tree", SCENE_SUBSURFACE_TREE, 32 },
+	{ "rotated", SCENE_ROTATED, 16 },
+	{ "tiny-damage", SCENE_TINY_DAMAGE, 256 },
+};
+
+#define BENCH_SURFACE_SIZE 128
+#define BENCH_TINY_DAMAGE_SIZE 512
+
+struct bench_surface {
+	struct wl_surface *wl_surface;
+	struct wl_subsurface *wl_subsurface;
+	struct wl_buffer *wl_buffer;
+	int width, height;
+};
+
+struct bench {
+	struct client *client;
+	const struct bench_scene *scene;
+	struct wl_subcompositor *subco;
+	struct bench_surface *surfaces;
+	int n_surfaces;		/* on each output */
+	int n_outputs;
+	int *done;
+};
+
+static struct wl_subcompositor *
+get_subcompositor(struct client *client)
+{
+	struct global *g;
+
+	wl_list_for_each(g, &client->global_list, link) {
+		if (strcmp(g->interface, "wl_subcompositor") == 0)
+			return wl_registry_bind(client->wl_registry, g->name,
+						&wl_subcompositor_interface, 1);
+	}
+
+	assert(0 && "no wl_subcompositor found");
+	return NULL;
+}
+
+static void
+fill(void *pixels, int width, int height, uint32_t color)
+{
+	uint32_t *p = pixels;
+	int i;
+
+	for (i = 0; i < width * height; i++)
+		p[i] = color;
+}
+
+static void
+bench_surface_init(struct bench *bench, struct bench_surface *bs,
+		   int width, int height, int opaque)
+{
+	struct client *client = bench->client;
+	struct wl_region *region;
+	void *pixels;
+
+	bs->width = width;
+	bs->height = height;
+	bs->wl_surface = wl_compositor_create_surface(client->wl_compositor);
+	assert(bs->wl_surface);
+	bs->wl_buffer = create_shm_buffer(client, width, height, &pixels);
+
+	if (opaque) {
+		fill(pixels, width, height, 0xff3060c0);
+		region = wl_compositor_create_region(client->wl_compositor);
+		wl_region_add(region, 0, 0, width, height);
+		wl_surface_set_opaque_region(bs->wl_surface, region);
+		wl_region_destroy(region);
+	} else {
+		/* premultiplied, half transparent */
+		fill(pixels, width, height, 0x80183060);
+	}
+
+	wl_surface_attach(bs->wl_surface, bs->wl_buffer, 0, 0);
+	wl_surface_damage(bs->wl_surface, 0, 0, width, height);
+}
+
+/* Maps a top-level surface through the weston-test extension. */
+static void
+bench_surface_map(struct bench *bench, struct bench_surface *bs,
+		  int x, int y)
+{
+	weston_test_move_surface(bench->client->test->weston_test,
+				 bs->wl_surface, x, y);
+	wl_surface_commit(bs->wl_surface);
+}
+
+/* Lays out the scene in the top left square of the output. Its side is
+ * the shorter side of the output in global coordinates, which does not
+ * depend on the output transform. */
+static void
+bench_create_output_scene(struct bench *bench, struct output *output,
+			  struct bench_surface *surfaces)
+{
+	const struct bench_scene *scene = bench->scene;
+	struct bench_surface *bs, *parent;
+	int i, n = bench->n_surfaces, size, step;
+
+	size = output->width < output->height ? output->width : output->height;
+	size /= output->scale;
+
+	switch (scene->kind) {
+	case SCENE_OPAQUE:
+	case SCENE_ALPHA:
+	case SCENE_ROTATED:
+		/* Overlapping windows on a diagonal. */
+		step = (size - BENCH_SURFACE_SIZE) / n;
+		for (i = 0; i < n; i++) {
+			bs = &surfaces[i];
+			bench_surface_init(bench, bs, BENCH_SURFACE_SIZE,
+					   BENCH_SURFACE_SIZE,
+					   scene->kind != SCENE_ALPHA);
+			if (scene->kind == SCENE_ROTATED)
+				wl_surface_set_buffer_transform(bs->wl_surface,
+					WL_OUTPUT_TRANSFORM_90);
+			bench_surface_map(bench, bs, output->x + i * step,
+					  output->y + i * step);
+		}
+		break;
+	case SCENE_SUBSURFACE_TREE:
+		/* A chain of sub-surfaces, each a child of the previous. */
+		parent = &surfaces[0];
+		bench_surface_init(bench, parent, BENCH_SURFACE_SIZE,
+				   BENCH_SURFACE_SIZE, 0);
+		for (i = 1; i < n; i++) {
+			bs = &surfaces[i];
+			bench_surface_init(bench, bs, BENCH_SURFACE_SIZE,
+					   BENCH_SURFACE_SIZE, 0);
+			bs->wl_subsurface =
+				wl_subcompositor_get_subsurface(bench->subco,
+					bs->wl_surface, parent->wl_surface);
+			wl_subsurface_set_position(bs->wl_subsurface, 4, 4);
+			wl_subsurface_set_desync(bs->wl_subsurface);
+			wl_surface_commit(bs->wl_surface);
+			parent = bs;
+		}
+		bench_surface_map(bench, &surfaces[0], output->x, output->y);
+		break;
+	case SCENE_TINY_DAMAGE:
+		bs = &surfaces[0];
+		bench_surface_init(bench, bs, BENCH_TINY_DAMAGE_SIZE,
+				   BENCH_TINY_DAMAGE_SIZE, 1);
+		bench_surface_map(bench, bs, output->x, output->y);
+		break;
+	}
+}
+
+static void
+bench_create_scene(struct bench *bench)
+{
+	const struct bench_scene *scene = bench->scene;
+	struct output *output;
+	int k = 0;
+
+	bench->n_surfaces = scene->kind == SCENE_TINY_DAMAGE ? 1 : scene->count;
+	bench->n_outputs = wl_list_length(&bench->client->output_list);
+	bench->surfaces = xzalloc(bench->n_outputs * bench->n_surfaces *
+				  sizeof bench->surfaces[0]);
+	bench->done = xzalloc(bench->n_outputs * sizeof bench->done[0]);
+
+	if (scene->kind == SCENE_SUBSURFACE_TREE)
+		bench->subco = get_subcompositor(bench->client);
+
+	wl_list_for_each(output, &bench->client->output_list, link)
+		bench_create_output_scene(bench, output,
+			&bench->surfaces[k++ * bench->n_surfaces]);
+
+	client_roundtrip(bench->client);
+}
+
+static void
+bench_surface_draw(struct bench *bench, struct bench_surface *bs, int frame)
+{
+	int k;
+
+	wl_surface_attach(bs->wl_surface, bs->wl_buffer, 0, 0);
+
+	if (bench->scene->kind == SCENE_TINY_DAMAGE) {
+		/* Scattered 1x1 rectangles, moving every frame. */
+		for (k = 0; k < bench->scene->count; k++)
+			wl_surface_damage(bs->wl_surface,
+				(k * 37 + frame * 13) % bs->width,
+				(k * 59 + frame * 7) % bs->height,
+				1, 1);
+	} else {
+		wl_surface_damage(bs->wl_surface, 0, 0,
+				  bs->width, bs->height);
+	}
+}
+
+/* Redraws the scene on every output and waits until all of them
+ * repainted. */
+static void
+bench_draw_frame(struct bench *bench, int frame)
+{
+	struct bench_surface *surfaces;
+	int i, j;
+
+	for (j = 0; j < bench->n_outputs; j++) {
+		surfaces = &bench->surfaces[j * bench->n_surfaces];
+
+		for (i = bench->n_surfaces - 1; i >= 0; i--) {
+			bench_surface_draw(bench, &surfaces[i], frame);
+			if (i == 0)
+				frame_callback_set(surfaces[i].wl_surface,
+						   &bench->done[j]);
+			wl_surface_commit(surfaces[i].wl_surface);
+		}
+	}
+
+	for (j = 0; j < bench->n_outputs; j++)
+		frame_callback_wait(bench->client, &bench->done[j]);
+}
+
+static double
+timespec_to_sec(const struct timespec *ts)
+{
+	return ts->tv_sec + ts->tv_nsec / 1e9;
+}
+
+static void
+bench_report(struct bench *bench, int frames, double seconds,
+	     const struct repaint_stats *stats)
+{
+	const char *path = getenv("WESTON_BENCH_RESULTS");
+	const char *threads = getenv("PIXMAN_THREADS");
+	uint32_t repaints = stats->frames;
+	double repaint_usec = 0.0, allocs = -1.0;
+	struct output *output;
+	const char *sep = "";
+	FILE *out = stdout;
+
+	if (repaints > 0) {
+		repaint_usec = (double)stats->time_usec / repaints;
+		if (stats->allocations >= 0)
+			allocs = (double)stats->allocations / repaints;
+	}
+
+	if (path) {
+		out = fopen(path, "a");
+		assert(out);
+	}
+
+	fprintf(out, "{ \"scene\":\"%s\", \"count\":%d, \"outputs\":%d, "
+		"\"pixman_threads\":%d, \"frames\":%d, \"repaints\":%u, "
+		"\"fps\":%.1f, \"cycle_usec\":%.1f, \"repaint_usec\":%.1f, "
+		"\"repaint_max_usec\":%u, \"allocs_per_frame\":%.1f, "
+		"\"output_repaint_usec\":[",
+		bench->scene->name, bench->scene->count, bench->n_outputs,
+		threads ? atoi(threads) : 0, frames, repaints,
+		frames / seconds, seconds * 1e6 / frames, repaint_usec,
+		stats->max_usec, allocs);
+
+	wl_list_for_each(output, &bench->client->output_list, link) {
+		repaints = output->repaint_stats.frames;
+		fprintf(out, "%s%.1f", sep, repaints ?
+			(double)output->repaint_stats.time_usec / repaints :
+			0.0);
+		sep = ", ";
+	}
+	fprintf(out, "] }\n");
+
+	if (path)
+		fclose(out);
+	else
+		fflush(out);
+}
+
+TEST_P(repaint_bench, scenes)
+{
+	const struct bench_scene *scene = data;
+	struct repaint_stats stats;
+	struct timespec start, end;
+	struct bench bench;
+	const char *env;
+	int frames = 300;
+	int i;
+
+	env = getenv("WESTON_BENCH_FRAMES");
+	if (env && atoi(env) > 0)
+		frames = atoi(env);
+
+	memset(&bench, 0, sizeof bench);
+	bench.scene = scene;
+	bench.client = client_create(0, 0, 1, 1);
+	assert(bench.client);
+
+	bench_create_scene(&bench);
+
+	/* Warm up caches and let the scene settle. */
+	for (i = 0; i < 10; i++)
+		bench_draw_frame(&bench, i);
+
+	/* Each request reports what happened since the previous one. */
+	get_repaint_stats(bench.client, &stats);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < frames; i++)
+		bench_draw_frame(&bench, i);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	get_repaint_stats(bench.client, &stats);
+
+	bench_report(&bench, frames,
+		     timespec_to_sec(&end) - timespec_to_sec(&start),
+		     &stats);
+}
@@ -31,9 +31,10 @@ static void
 surface_transform(void *data)
 {
 	struct weston_compositor *compositor = data;
-	struct weston_surface *surface;
-	struct weston_view *view;
+	struct weston_surface *surface, *child_surface;
+	struct weston_view *view, *child;
 	float x, y;
+	uint32_t generation;
 
 	surface = weston_surface_create(compositor);
 	assert(surface);
@@ -53,6 +54,37 @@ surface_transform(void *data)
 	weston_view_to_global_float(view, 50, 40, &x, &y);
 	assert(x == 200 && y == 340);
 
+	child_surface = weston_surface_create(compositor);
+	assert(child_surface);
+	child = weston_view_create(child_surface);
+	assert(child);
+	child_surface->width = 20;
+	child_surface->height = 20;
+	weston_view_set_transform_parent(child, view);
+	weston_view_set_position(child, 10, 10);
+	weston_view_update_transform(child);
+	weston_view_to_global_float(child, 5, 5, &x, &y);
+	assert(x == 165 && y == 315);
+	weston_view_from_global_float(child, 165, 315, &x, &y);
+	assert(x == 5 && y == 5);
+
+	/* moving the parent must carry the child along */
+	weston_view_set_position(view, 50, 60);
+	weston_view_update_transform(child);
+	weston_view_to_global_float(child, 0, 0, &x, &y);
+	assert(x == 60 && y == 70);
+
+	/* dirtying the parent without a real change keeps the
+	 * inherited state, and the child stays untouched */
+	generation = view->transform.generation;
+	weston_view_geometry_dirty(view);
+	assert(child->transform.dirty);
+	weston_view_update_transform(child);
+	assert(view->transform.generation == generation);
+	assert(!child->transform.dirty);
+	weston_view_to_global_float(child, 0, 0, &x, &y);
+	assert(x == 60 && y == 70);
+
 	wl_display_terminate(compositor->wl_display);
 }
 
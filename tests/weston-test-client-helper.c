@@ -115,6 +115,34 @@ get_n_egl_buffers(struct client *client)
 	return client->test->n_egl_buffers;
 }
 
+void
+get_repaint_stats(struct client *client, struct repaint_stats *stats)
+{
+	weston_test_get_repaint_stats(client->test->weston_test);
+	client_roundtrip(client);
+
+	*stats = client->test->repaint_stats;
+}
+
+void
+get_render_stats(struct client *client, struct render_stats *stats)
+{
+	weston_test_get_render_stats(client->test->weston_test);
+	client_roundtrip(client);
+
+	*stats = client->test->render_stats;
+}
+
+void
+capture_screenshot(struct client *client, struct wl_buffer *buffer)
+{
+	client->test->capture_done = 0;
+	weston_test_capture_screenshot(client->test->weston_test, buffer);
+
+	while (!client->test->capture_done)
+		assert(wl_display_dispatch(client->wl_display) >= 0);
+}
+
 static void
 pointer_handle_enter(void *data, struct wl_pointer *wl_pointer,
 		     uint32_t serial, struct wl_surface *wl_surface,
@@ -352,9 +380,72 @@ test_handle_n_egl_buffers(void *data, struct weston_test *weston_test, uint32_t
 	test->n_egl_buffers = n;
 }
 
+static void
+test_handle_repaint_stats(void *data, struct weston_test *weston_test,
+			  uint32_t frames, uint32_t time_usec,
+			  uint32_t max_usec, int32_t allocations)
+{
+	struct test *test = data;
+
+	test->repaint_stats.frames = frames;
+	test->repaint_stats.time_usec = time_usec;
+	test->repaint_stats.max_usec = max_usec;
+	test->repaint_stats.allocations = allocations;
+}
+
+static void
+test_handle_output_repaint_stats(void *data, struct weston_test *weston_test,
+				 int32_t x, int32_t y, uint32_t frames,
+				 uint32_t time_usec, uint32_t max_usec)
+{
+	struct test *test = data;
+	struct output *output;
+
+	wl_list_for_each(output, test->output_list, link) {
+		if (output->x != x || output->y != y)
+			continue;
+
+		output->repaint_stats.frames = frames;
+		output->repaint_stats.time_usec = time_usec;
+		output->repaint_stats.max_usec = max_usec;
+		output->repaint_stats.allocations = -1;
+	}
+}
+
+static void
+test_handle_capture_screenshot_done(void *data, struct weston_test *weston_test)
+{
+	struct test *test = data;
+
+	test->capture_done = 1;
+}
+
+static void
+test_handle_render_stats(void *data, struct weston_test *weston_test,
+			 uint32_t frames, uint32_t views,
+			 uint32_t opaque_rects, uint32_t blended_rects,
+			 uint32_t opaque_pixels, uint32_t blended_pixels,
+			 uint32_t damage_pixels, uint32_t upload_bytes)
+{
+	struct test *test = data;
+
+	test->render_stats.frames = frames;
+	test->render_stats.views = views;
+	test->render_stats.opaque_rects = opaque_rects;
+	test->render_stats.blended_rects = blended_rects;
+	test->render_stats.opaque_pixels = opaque_pixels;
+	test->render_stats.blended_pixels = blended_pixels;
+	test->render_stats.damage_pixels = damage_pixels;
+	test->render_stats.upload_bytes = upload_bytes;
+}
+
 static const struct weston_test_listener test_listener = {
 	test_handle_pointer_position,
 	test_handle_n_egl_buffers,
+	test_handle_repaint_stats,
+	test_handle_capture_screenshot_done,
+	test_handle_render_stats,
+	test_handle_output_repaint_stats,
 };
 
 static void
@@ -411,6 +502,7 @@ output_handle_geometry(void *data,
 
 	output->x = x;
 	output->y = y;
+	output->transform = transform;
 }
 
 static void
@@ -426,12 +518,31 @@ output_handle_mode(void *data,
 	if (flags & WL_OUTPUT_MODE_CURRENT) {
 		output->width = width;
 		output->height = height;
+		output->refresh = refresh;
 	}
 }
 
+static void
+output_handle_done(void *data,
+		   struct wl_output *wl_output)
+{
+}
+
+static void
+output_handle_scale(void *data,
+		    struct wl_output *wl_output,
+		    int32_t scale)
+{
+	struct output *output = data;
+
+	output->scale = scale;
+}
+
 static const struct wl_output_listener output_listener = {
 	output_handle_geometry,
-	output_handle_mode
+	output_handle_mode,
+	output_handle_done,
+	output_handle_scale
 };
 
 static void
@@ -469,14 +580,17 @@ handle_global(void *data, struct wl_registry *registry,
 		wl_shm_add_listener(client->wl_shm, &shm_listener, client);
 	} else if (strcmp(interface, "wl_output") == 0) {
 		output = xzalloc(sizeof *output);
+		output->scale = 1;
 		output->wl_output =
-			wl_registry_bind(registry, id,
-					 &wl_output_interface, 1);
+			wl_registry_bind(registry, id, &wl_output_interface,
+					 version < 2 ? version : 2);
 		wl_output_add_listener(output->wl_output,
 				       &output_listener, output);
+		wl_list_insert(client->output_list.prev, &output->link);
 		client->output = output;
 	} else if (strcmp(interface, "weston_test") == 0) {
 		test = xzalloc(sizeof *test);
+		test->output_list = &client->output_list;
 		test->weston_test =
 			wl_registry_bind(registry, id,
 					 &weston_test_interface, 1);
@@ -574,6 +688,7 @@ client_create(int x, int y, int width, int height)
 	client->wl_display = wl_display_connect(NULL);
 	assert(client->wl_display);
 	wl_list_init(&client->global_list);
+	wl_list_init(&client->output_list);
 
 	/* setup registry so we can bind to interfaces */
 	client->wl_registry = wl_display_get_registry(client->wl_display);
@@ -38,6 +38,7 @@ struct client {
 	struct test *test;
 	struct input *input;
 	struct output *output;
+	struct wl_list output_list;
 	struct surface *surface;
 	int has_argb;
 	struct wl_list global_list;
@@ -51,11 +52,33 @@ struct global {
 	struct wl_list link;
 };
 
+struct repaint_stats {
+	uint32_t frames;
+	uint32_t time_usec;
+	uint32_t max_usec;
+	int32_t allocations;
+};
+
+struct render_stats {
+	uint32_t frames;
+	uint32_t views;
+	uint32_t opaque_rects;
+	uint32_t blended_rects;
+	uint32_t opaque_pixels;
+	uint32_t blended_pixels;
+	uint32_t damage_pixels;
+	uint32_t upload_bytes;
+};
+
 struct test {
 	struct weston_test *weston_test;
 	int pointer_x;
 	int pointer_y;
 	uint32_t n_egl_buffers;
+	struct repaint_stats repaint_stats;
+	int capture_done;
+	struct render_stats render_stats;
+	struct wl_list *output_list;
 };
 
 struct input {
@@ -90,6 +113,11 @@ struct output {
 	int y;
 	int width;
 	int height;
+	int refresh;
+	int scale;
+	int transform;
+	struct repaint_stats repaint_stats;
+	struct wl_list link;
 };
 
 struct surface {
@@ -141,6 +169,15 @@ frame_callback_wait_nofail(struct client *client, int *done);
 int
 get_n_egl_buffers(struct client *client);
 
+void
+get_repaint_stats(struct client *client, struct repaint_stats *stats);
+
+void
+capture_screenshot(struct client *client, struct wl_buffer *buffer);
+
+void
+get_render_stats(struct client *client, struct render_stats *stats);
+
 void
 skip(const char *fmt, ...);
 
@@ -23,9 +23,11 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <signal.h>
 #include <unistd.h>
+#include <dlfcn.h>
 
 #include "../src/compositor.h"
 #include "weston-test-server-protocol.h"
@@ -40,6 +42,8 @@ struct weston_test {
 	struct weston_compositor *compositor;
 	struct weston_layer layer;
 	struct weston_process process;
+	struct weston_view_cache *cache;
+	uint64_t allocations;	/* at the last get_repaint_stats */
 };
 
 struct weston_test_surface {
@@ -144,11 +148,13 @@ move_pointer(struct wl_client *client, struct wl_resource *resource,
 {
 	struct weston_test *test = wl_resource_get_user_data(resource);
 	struct weston_seat *seat = get_seat(test);
-	struct weston_pointer *pointer = seat->pointer;
 
-	notify_motion(seat, 100,
-		      wl_fixed_from_int(x) - pointer->x,
-		      wl_fixed_from_int(y) - pointer->y);
+	notify_motion_absolute(seat, 100,
+			       wl_fixed_from_int(x), wl_fixed_from_int(y));
+
+	/* With coalesce-motion the motion above is only queued; deliver
+	 * it so the position reported back is the one just set. */
+	weston_compositor_flush_motion(test->compositor);
 
 	notify_pointer_position(test, resource);
 }
@@ -236,6 +242,171 @@ get_n_buffers(struct wl_client *client, struct wl_resource *resource)
 	weston_test_send_n_egl_buffers(resource, n_buffers);
 }
 
+static void
+step_clock(struct wl_client *client, struct wl_resource *resource,
+	   uint32_t frames)
+{
+	struct weston_test *test = wl_resource_get_user_data(resource);
+
+	if (test->compositor->step_clock)
+		test->compositor->step_clock(test->compositor, frames);
+}
+
+static void
+get_repaint_stats(struct wl_client *client, struct wl_resource *resource)
+{
+	struct weston_test *test = wl_resource_get_user_data(resource);
+	struct weston_output *output;
+	uint64_t (*alloc_count)(void);
+	uint32_t frames = 0;
+	uint64_t time_ns = 0, max_ns = 0, count;
+	int32_t allocations = -1;
+
+	wl_list_for_each(output, &test->compositor->output_list, link) {
+		weston_test_send_output_repaint_stats(resource,
+			output->x, output->y, output->repaint_stats.count,
+			output->repaint_stats.time_ns / 1000,
+			output->repaint_stats.max_ns / 1000);
+
+		frames += output->repaint_stats.count;
+		time_ns += output->repaint_stats.time_ns;
+		if (output->repaint_stats.max_ns > max_ns)
+			max_ns = output->repaint_stats.max_ns;
+		memset(&output->repaint_stats, 0,
+		       sizeof output->repaint_stats);
+	}
+
+	/* Provided by alloc-counter.so when it is preloaded. */
+	alloc_count = dlsym(RTLD_DEFAULT, "weston_test_alloc_count");
+	if (alloc_count) {
+		count = alloc_count();
+		allocations = count - test->allocations;
+		test->allocations = count;
+	}
+
+	weston_test_send_repaint_stats(resource, frames, time_ns / 1000,
+				       max_ns / 1000, allocations);
+}
+
+static void
+send_touch(struct wl_client *client, struct wl_resource *resource,
+	   int32_t touch_id, wl_fixed_t x, wl_fixed_t y, uint32_t touch_type)
+{
+	struct weston_test *test = wl_resource_get_user_data(resource);
+	struct weston_seat *seat = get_seat(test);
+
+	if (!seat->touch)
+		weston_seat_init_touch(seat);
+
+	notify_touch(seat, 100, touch_id, x, y, touch_type);
+	notify_touch_frame(seat);
+}
+
+static void
+capture_screenshot_done(void *data, enum weston_screenshooter_outcome outcome)
+{
+	struct wl_resource *resource = data;
+
+	switch (outcome) {
+	case WESTON_SCREENSHOOTER_SUCCESS:
+		weston_test_send_capture_screenshot_done(resource);
+		break;
+	case WESTON_SCREENSHOOTER_NO_MEMORY:
+		wl_resource_post_no_memory(resource);
+		break;
+	case WESTON_SCREENSHOOTER_BAD_BUFFER:
+		wl_resource_post_error(resource,
+				       WL_DISPLAY_ERROR_INVALID_OBJECT,
+				       "screenshot needs an shm buffer "
+				       "at least as large as the output");
+		break;
+	}
+}
+
+static void
+capture_screenshot(struct wl_client *client, struct wl_resource *resource,
+		   struct wl_resource *buffer_resource)
+{
+	struct weston_test *test = wl_resource_get_user_data(resource);
+	struct weston_output *output;
+	struct weston_buffer *buffer;
+
+	buffer = weston_buffer_from_resource(buffer_resource);
+	if (!buffer) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	output = container_of(test->compositor->output_list.next,
+			      struct weston_output, link);
+
+	weston_screenshooter_shoot(output, buffer,
+				   capture_screenshot_done, resource);
+}
+
+static void
+get_render_stats(struct wl_client *client, struct wl_resource *resource)
+{
+	struct weston_test *test = wl_resource_get_user_data(resource);
+	struct weston_output *output;
+	struct weston_render_stats *stats;
+
+	/* Recording costs time in every repaint, which would skew the
+	 * benchmarks; only start it once some test asks. */
+	weston_render_stats_enable(test->compositor);
+
+	output = container_of(test->compositor->output_list.next,
+			      struct weston_output, link);
+	stats = &output->render_stats;
+
+	weston_test_send_render_stats(resource, stats->frames, stats->views,
+				      stats->opaque_rects,
+				      stats->blended_rects,
+				      stats->opaque_pixels,
+				      stats->blended_pixels,
+				      stats->damage_pixels,
+				      stats->upload_bytes);
+}
+
+static void
+cache_surfaces(struct wl_client *client, struct wl_resource *resource)
+{
+	struct weston_test *test = wl_resource_get_user_data(resource);
+	struct weston_view **views;
+	struct weston_view *view;
+	int count = 0;
+
+	if (!test->cache) {
+		test->cache = weston_view_cache_create(test->compositor);
+		if (!test->cache) {
+			wl_resource_post_error(resource,
+					       WL_DISPLAY_ERROR_INVALID_METHOD,
+					       "the renderer cannot cache views");
+			return;
+		}
+	} else {
+		weston_layer_entry_remove(&test->cache->view->layer_link);
+	}
+
+	views = malloc((wl_list_length(&test->layer.view_list.link) + 1) *
+		       sizeof *views);
+	if (!views) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	wl_list_for_each_reverse(view, &test->layer.view_list.link,
+				 layer_link.link)
+		views[count++] = view;
+
+	weston_view_cache_set_views(test->cache, views, count);
+	free(views);
+
+	weston_layer_entry_insert(&test->layer.view_list,
+				  &test->cache->view->layer_link);
+	weston_compositor_schedule_repaint(test->compositor);
+}
+
 static const struct weston_test_interface test_implementation = {
 	move_surface,
 	move_pointer,
@@ -243,6 +414,12 @@ static const struct weston_test_interface test_implementation = {
 	activate_surface,
 	send_key,
 	get_n_buffers,
+	step_clock,
+	get_repaint_stats,
+	send_touch,
+	capture_screenshot,
+	get_render_stats,
+	cache_surfaces,
 };
 
 static void
@@ -303,6 +480,7 @@ module_init(struct weston_compositor *ec,
 
 	test->compositor = ec;
 	weston_layer_init(&test->layer, &ec->cursor_layer.link);
+	weston_repaint_stats_enable(ec);
 
 	if (wl_global_create(ec->wl_display, &weston_test_interface, 1,
 			     test, bind_test) == NULL)